@@ -49,6 +49,9 @@ int main(int argc, char*argv[])
     Dscalar v0 = 0.1;
     Dscalar KA = 1.0;
     Dscalar thresh = 1e-12;
+    //if positive, the number of lowest modes to find with the sparse solver instead of a dense diagonalization
+    int sparseModes = 0;
+    int nThreads = 1;
 
     //This example is a bit more ragged than the others, and program_switch has been abused for testing features that have not been cleaned up yet
     int program_switch = 0;
@@ -67,6 +70,8 @@ int main(int argc, char*argv[])
             case 'a': a0 = atof(optarg); break;
             case 'v': v0 = atof(optarg); break;
             case 'r': thresh = atof(optarg); break;
+            case 's': sparseModes = atoi(optarg); break;
+            case 'x': nThreads = atoi(optarg); break;
             case '?':
                     if(optopt=='c')
                         std::cerr<<"Option -" << optopt << "requires an argument.\n";
@@ -175,20 +180,37 @@ int main(int argc, char*argv[])
     vector<Dscalar> entries;
     spv->getDynMatEntries(rowCols,entries,1.0,1.0);
     printf("Number of partial entries: %lu\n",rowCols.size());
-    EigMat D(2*numpts);
-    for (int ii = 0; ii < rowCols.size(); ++ii)
-        {
-        int2 ij = rowCols[ii];
-        D.placeElementSymmetric(ij.x,ij.y,entries[ii]);
-        };
-
     int evecTest = 11;
-    D.SASolve(evecTest+1);
-    vector<Dscalar> eigenv;
-    for (int ee = 0; ee < 40; ++ee)
+    vector<Dscalar> testMode;
+    if (sparseModes > 0)
+        {
+        //a dense matrix is limited to a few thousand cells; for larger systems assemble a sparse one
+        //and find only the lowest modes
+        EigSparseMat D;
+        D.setFromEntries(2*numpts,rowCols,entries,nThreads);
+        D.shiftInvertSolve(sparseModes);
+        for (int ee = 0; ee < D.eigenvalues.size(); ++ee)
+            printf("lambda = %f\t \n",D.eigenvalues[ee]);
+        evecTest = min(evecTest,(int)D.eigenvalues.size()-1);
+        D.getEvec(evecTest,testMode);
+        }
+    else
         {
-        D.getEvec(ee,eigenv);
-        printf("lambda = %f\t \n",D.eigenvalues[ee]);
+        EigMat D(2*numpts);
+        for (int ii = 0; ii < rowCols.size(); ++ii)
+            {
+            int2 ij = rowCols[ii];
+            D.placeElementSymmetric(ij.x,ij.y,entries[ii]);
+            };
+
+        D.SASolve(evecTest+1);
+        vector<Dscalar> eigenv;
+        for (int ee = 0; ee < 40; ++ee)
+            {
+            D.getEvec(ee,eigenv);
+            printf("lambda = %f\t \n",D.eigenvalues[ee]);
+            };
+        D.getEvec(evecTest,testMode);
         };
     cout <<endl;
 
@@ -202,10 +224,10 @@ int main(int argc, char*argv[])
     ArrayHandle<Dscalar2> hn(dispneg);
     for (int ii = 0; ii < numpts; ++ii)
         {
-        hp.data[ii].x = mag*D.eigenvectors[evecTest][2*ii];
-        hp.data[ii].y = mag*D.eigenvectors[evecTest][2*ii+1];
-        hn.data[ii].x = -mag*D.eigenvectors[evecTest][2*ii];
-        hn.data[ii].y = -mag*D.eigenvectors[evecTest][2*ii+1];
+        hp.data[ii].x = mag*testMode[2*ii];
+        hp.data[ii].y = mag*testMode[2*ii+1];
+        hn.data[ii].x = -mag*testMode[2*ii];
+        hn.data[ii].y = -mag*testMode[2*ii+1];
         //printf("(%f,%f)\t",hn.data[ii].x,hn.data[ii].y);
         };
     };
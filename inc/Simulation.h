@@ -59,8 +59,12 @@ class Simulation : public enable_shared_from_this<Simulation>
         void setIntegrationTimestep(Dscalar dt);
         //!turn on CPU-only mode for all components
         void setCPUOperation(bool setcpu);
+        //!Set the number of threads the cell configuration may use in its CPU routines
+        void setNumThreads(int n);
         //!Enforce reproducible dynamics
         void setReproducible(bool reproducible);
+        //!Set the precision in which the configuration and the updaters accumulate sums over the whole system
+        void setAccumulatorPrecision(accumulator_precision::Enum precision);
 
         //!Set the time between spatial sorting operations.
         void setSortPeriod(int sp){sortPeriod = sp;};
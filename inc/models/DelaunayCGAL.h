@@ -57,9 +57,23 @@ class DelaunayCGAL
         void PeriodicTriangulation(vector<pair<Point,int> > &points,Dscalar bxx, Dscalar bxy, Dscalar byx, Dscalar byy);
         //! Given a vector of points (in the form of pair<PDT::Point p ,int index>), explicitly constructing the covering and using CGAL's non-periodic routines
         void PeriodicTriangulationNineSheeted(vector<pair<Point,int> > &points,Dscalar bxx, Dscalar bxy, Dscalar byx, Dscalar byy);
+        //! Given a vector of points (in the form of pair<PDT::Point p ,int index>), only replicating points within a strip of width haloWidth around the domain
+        void PeriodicTriangulationHalo(vector<pair<Point,int> > &points,Dscalar bxx, Dscalar bxy, Dscalar byx, Dscalar byy, Dscalar haloWidth = -1.0);
+        //! Given a vector of points (in the form of pair<PDT::Point p ,int index>), triangulate strips of the domain (plus ghost layers) on nThreads threads
+        void PeriodicTriangulationParallel(vector<pair<Point,int> > &points,Dscalar bxx, Dscalar bxy, Dscalar byx, Dscalar byy,
+                                           int nThreads, Dscalar ghostWidth = -1.0);
         //! Given a vector of points (in the form of pair<PDT::Point p ,int index>), fill the allneighs structure with the neighbor list
         void PeriodicTriangulationSquareDomain(vector<pair<Point,int> > &points,Dscalar boxX, Dscalar boxY);
         //! given a similar vector of points, calculate the neighbors of the first point in a non-periodic domain.
         bool LocalTriangulation(const vector<pair<LPoint,int> > &points, vector<int> &neighs);
+
+    protected:
+        //!Transform points to virtual coordinates and sort them into vertical strips
+        void getVirtualStrips(vector<pair<Point,int> > &points, Dscalar bxx, Dscalar bxy, Dscalar byx, Dscalar byy,
+                              int nStrips, vector<Dscalar2> &virtualCoords, vector<vector<int> > &stripMembers);
+        //!Triangulate one strip plus its ghost layer, and get the neighbors of the points in the strip
+        bool TriangulateStrip(const vector<Dscalar2> &virtualCoords, const vector<vector<int> > &stripMembers,
+                              int strip, Dscalar hx, Dscalar hy, Dscalar bxx, Dscalar bxy, Dscalar byx, Dscalar byy,
+                              vector<vector<int> > &neighs);
     };
 #endif
@@ -0,0 +1,102 @@
+#ifndef DELAUNAYFLIP_H
+#define DELAUNAYFLIP_H
+
+#include "std_include.h"
+#include "gpubox.h"
+#include "indexer.h"
+#include <queue>
+#include <functional>
+
+/*! \file DelaunayFlip.h */
+//!Maintain a periodic Delaunay triangulation of moving points by Lawson edge flips
+/*!
+DelaunayFlip stores a periodic triangulation explicitly, as a list of CCW-ordered triangles together
+with the three triangles adjacent to each of them. After the points move by a small amount, the
+Delaunay property is restored by flipping the edges that fail the in-circle predicate (Lawson's
+algorithm).
+
+Each triangle carries a displacement certificate: a distance that every point may move before the
+triangle could be inverted, or before the opposite vertex of one of its neighbors could enter its
+circumcircle. The caller reports an upper bound on the displacement of every point after each move
+(addDisplacement), and only triangles whose certificates have expired are checked; their edges seed
+the flip stack, and the triangles changed by flips are certified again. Maintaining the topology then
+costs O(number of expired triangles + number of flips) rather than O(N). When the displacements are
+not known (invalidateCertificates), every triangle is checked and certified again.
+
+Edge flips can only repair a triangulation that is still valid (i.e., no triangle has been
+inverted by the motion of the points). Since every triangle that could have been inverted is
+checked, any inversion is detected, in which case the routines return false and the calling code
+should fall back to constructing a fresh triangulation.
+This class operates strictly on the CPU.
+ */
+class DelaunayFlip
+    {
+    public:
+        //!Blank constructor
+        DelaunayFlip(){Np = 0;flipsPerformed = 0;trianglesChecked = 0;certified = false;displacementBound = 0.0;Box = make_shared<gpubox>();};
+
+        //!Set the box
+        void setBox(BoxPtr bx){Box=bx;};
+
+        //!Build the triangle and adjacency structure from a set of CCW-ordered neighbor lists
+        bool initialize(int N, const int *neighborNum, const int *neighbors, const IndexCSR &nIdx);
+        //!Flip edges until every edge is locally Delaunay for the given points, checking every triangle
+        bool flipToDelaunay(const Dscalar2 *points, vector<int> &changedVertices);
+        //!Flip edges until every edge is locally Delaunay, checking only the triangles whose certificates have expired
+        bool updateToDelaunay(const Dscalar2 *points, vector<int> &changedVertices);
+        //!Every point has moved by at most this much since the last call to flipToDelaunay or updateToDelaunay
+        void addDisplacement(Dscalar maxDisplacement){displacementBound += maxDisplacement;};
+        //!The points have moved by unknown amounts; the next update checks every triangle
+        void invalidateCertificates(){certified = false;};
+        //!Get the CCW-ordered Delaunay neighbors of vertex i from the current triangulation
+        bool getNeighbors(int i, vector<int> &neighbors);
+
+        //!The number of triangles in the triangulation
+        int getNumberOfTriangles(){return triangles.size();};
+        //!The total number of edge flips that have been performed
+        int flipsPerformed;
+        //!The total number of triangles whose certificates expired and were checked by updateToDelaunay
+        int trianglesChecked;
+
+    protected:
+        //!Is d inside the circumcircle of the CCW triangle (a,b,c)?
+        bool inCircumcircle(const Dscalar2 *points, int a, int b, int c, int d);
+        //!flip the edge opposite local vertex j of triangle t
+        void flipEdge(int t, int j);
+        //!In triangle t, replace the adjacency to triangle oldT with newT
+        void replaceNeighbor(int t, int oldT, int newT);
+        //!Is triangle t still CCW for the given points?
+        bool positivelyOriented(const Dscalar2 *points, int t);
+        //!Flip edges from the edge stack until it is empty
+        bool processEdgeStack(const Dscalar2 *points, vector<int> &changedVertices);
+        //!The displacement tolerance of triangle t for the given points
+        Dscalar triangleTolerance(const Dscalar2 *points, int t);
+        //!Give triangle t a new certificate, valid from the current displacementBound
+        void certifyTriangle(const Dscalar2 *points, int t);
+        //!Give every triangle a new certificate
+        void certifyAll(const Dscalar2 *points);
+
+        //!The number of points
+        int Np;
+        //!The vertices of each triangle, in CCW order
+        vector<int3> triangles;
+        //!triangleNeighbors[t].x is the triangle sharing the edge opposite triangles[t].x, etc.
+        vector<int3> triangleNeighbors;
+        //!The index of one triangle containing each vertex
+        vector<int> vertexTriangle;
+        //!A stack of (triangle, local vertex) pairs whose opposite edge needs to be checked
+        vector<int2> edgeStack;
+        //!The triangles changed by the flips of the current update, and their neighbors
+        vector<int> touchedTriangles;
+        //!Are the certificates consistent with the triangulation and the reported displacements?
+        bool certified;
+        //!The sum of the maximum displacements reported since the certificates were last rebuilt
+        Dscalar displacementBound;
+        //!The value of displacementBound at which each triangle has to be checked again
+        vector<Dscalar> triangleExpiry;
+        //!A min-heap of (expiry, triangle) pairs; entries whose expiry no longer matches triangleExpiry are stale
+        priority_queue<pair<Dscalar,int>, vector<pair<Dscalar,int> >, greater<pair<Dscalar,int> > > expiryQueue;
+        //!The box defining the periodic domain
+        BoxPtr Box;
+    };
+#endif
@@ -8,6 +8,18 @@
 using namespace std;
 
 /*! \file DelaunayLoc.h */
+//!Reusable storage for the candidate 1-ring routines of DelaunayLoc, so that repeated calls do not touch the heap
+struct oneRingScratch
+    {
+    vector<int> cellNeighbors;  //!<the cells in a search shell or around a circumcircle
+    vector<int> cellsToSearch;  //!<the (unique) cells that overlap the circumcircles of the enclosing polygon
+    vector<int> ringIdx;        //!<the indices of the candidate 1-ring
+    vector<Dscalar2> ring;      //!<the relative positions of the candidate 1-ring
+    vector<int> newRingIdx;     //!<temporary storage for reduceOneRing
+    vector<Dscalar2> newRing;   //!<temporary storage for reduceOneRing
+    vector<int> star;           //!<the neighbors of the most recently triangulated point
+    };
+
  //!A CPU-based class for locally constructing the Delaunay triangulation of part of a point set
 /*!
  *
@@ -24,16 +36,20 @@ using namespace std;
 class DelaunayLoc
     {
     public:
-        DelaunayLoc(){triangulated=false;cellsize=2.0;Box = make_shared<gpubox>();};
+        DelaunayLoc(){triangulated=false;cellsize=2.0;nV=0;pts=NULL;cList=&ownedCellList;Box = make_shared<gpubox>();};
         //!constructor via a vector of Dscalar2 objects
-        DelaunayLoc(std::vector<Dscalar2> &points, gpubox &bx){setPoints(points);setBox(bx);};
+        DelaunayLoc(std::vector<Dscalar2> &points, gpubox &bx){cList=&ownedCellList;setPoints(points);setBox(bx);};
         //!constructor via a vector of scalars, {x1,y1,x2,y2,...}
-        DelaunayLoc(std::vector<Dscalar> &points,gpubox &bx){setPoints(points);setBox(bx);};
+        DelaunayLoc(std::vector<Dscalar> &points,gpubox &bx){cList=&ownedCellList;setPoints(points);setBox(bx);};
 
         void setPoints(ArrayHandle<Dscalar2> &points, int N); //!<Set points by passing an ArrayHandle
         void setPoints(GPUArray<Dscalar2> &points); //!<Set points via a GPUarray of Dscalar2's
         void setPoints(std::vector<Dscalar2> &points); //!<Set points via a vector of Dscalar2's
         void setPoints(std::vector<Dscalar> &points);   //!<Set the points via a vector of Dscalar's
+        //!Use an externally owned set of points and cell list, without copying (see DelaunayLocBinding)
+        void setSharedPoints(const Dscalar2 *points, int N, cellListGPU *sharedCellList);
+        //!Stop using the externally owned points; until setSharedPoints or setPoints is called again the class has no points
+        void releaseSharedPoints(){pts = NULL;nV = 0;triangulated = false;};
         void setBox(gpubox &bx);                        //!<Set the box
         void setBox(BoxPtr bx){Box=bx;};                        //!<Set the box
         void setCellSize(Dscalar cs){cellsize=cs;};     //!<Set the cell size of the underlying grid
@@ -42,10 +58,26 @@ class DelaunayLoc
 
         //!Find the indices of an enclosing polygon of vertex i
         void getPolygon(int i, vector<int> &P0,vector<Dscalar2> &P1);
+        //!Find the indices of an enclosing polygon of vertex i, with cell list data passed in directly
+        void getPolygon(int i, vector<int> &P0,vector<Dscalar2> &P1, const unsigned int *cellSizes, const int *cellIdxs);
+        //!The allocation-free core of getPolygon; returns false if no enclosing polygon was found
+        bool getPolygon(int i, int *P0, Dscalar2 *P1, const unsigned int *cellSizes, const int *cellIdxs,
+                        vector<int> &cellneighs);
         //!Find a candidate set of possible points in the 1-ring of vertex i
         void getOneRingCandidate(int i, vector<int> &DTringIdx,vector<Dscalar2> &DTring);
+        //!Find a candidate set of possible points in the 1-ring of vertex i, with cell list data passed in directly
+        void getOneRingCandidate(int i, vector<int> &DTringIdx,vector<Dscalar2> &DTring,
+                                 const unsigned int *cellSizes, const int *cellIdxs);
+        //!Find a candidate 1-ring using only the storage in scratch; returns false if no enclosing polygon was found
+        bool getOneRingCandidate(int i, oneRingScratch &scratch, const unsigned int *cellSizes, const int *cellIdxs);
         //!If the candidate 1-ring is large, try to reduce it before triangulating the whole thing
         void reduceOneRing(int i, vector<int> &DTringIdx,vector<Dscalar2> &DTring);
+        //!Reduce the candidate 1-ring held in scratch
+        void reduceOneRing(int i, oneRingScratch &scratch);
+        //!Find the CCW-ordered Delaunay neighbors of ring[0] (at the origin) directly from a candidate 1-ring
+        bool getStar(const vector<Dscalar2> &ring, const vector<int> &ringIdx, vector<int> &neighbors);
+        //!The largest star that getStar will construct before giving up
+        static const int maxStarSize = 64;
         //!Collect some statistics about the functioning of the oneRing algorithms
         int cellschecked,candidates; //statistics for the above function
 
@@ -55,9 +87,30 @@ class DelaunayLoc
         void getNeighbors(int i, vector<int> &neighbors);
         //!Just get the neighbors of vertex i, sorted in clockwise order. Calculated by the DelaunayCGAL class
         bool getNeighborsCGAL(int i, vector<int> &neighbors);
+        //!As above, but with caller-owned scratch space and cell list data, so that it is safe to call from multiple threads
+        bool getNeighborsCGAL(int i, vector<int> &neighbors, vector<int> &DTringIdx, vector<Dscalar2> &DTring,
+                              const unsigned int *cellSizes, const int *cellIdxs);
+        //!Get the neighbors of vertex i with getStar, only calling CGAL if that fails. Safe to call from multiple threads with different scratch structures
+        bool getNeighborsStar(int i, vector<int> &neighbors, oneRingScratch &scratch,
+                              const unsigned int *cellSizes, const int *cellIdxs);
+        //!Get the CCW-ordered neighbors of every vertex in fixlist, using nThreads threads, as a flattened list
+        bool getNeighborsLocal(const vector<int> &fixlist, vector<int> &allneighs, vector<int> &allneighidxstart,
+                               vector<int> &allneighidxstop, int nThreads = 1);
 
         //!Test whether the passed list of neighbors are the Delaunay neighbors of vertex i
         bool testPointTriangulation(int i, vector<int> &neighbors, bool timing=false);
+        //!Test a list of neighbors of vertex i using raw cell list data and caller-owned scratch space, so that it is safe to call from multiple threads
+        bool testPointTriangulation(int i, const int *neighbors, int neighNum, const unsigned int *cellSizes,
+                                    const int *cellIdxs, vector<int> &cns);
+        //!Test the neighbor lists of vertices [0,N) using nThreads threads, flagging failures in the repair array
+        int testPointTriangulations(int N, const int *neighborNum, const int *neighbors, const IndexCSR &nIdx,
+                                    int *repair, int nThreads = 1);
+        //!Test whether a triangle's circumcircle is empty, optionally estimating how far the points may move before that can change
+        bool testCircumcircle(const int3 &tri, const unsigned int *cellSizes, const int *cellIdxs,
+                              vector<int> &cns, vector<int> &intruders, Dscalar *tolerance = NULL);
+        //!Test the circumcircles of a list of triangles using nThreads threads, flagging points in the repair array
+        int testCircumcircles(const vector<int> &triangleList, const int3 *triangles, int *repair,
+                              Dscalar *tolerances = NULL, int nThreads = 1, vector<int> *failedTriangles = NULL);
         //!Given a vector of circumcircle indices, label particles that are part of non-empty circumcircles
         void testTriangulation(vector< int > &ccs, vector<bool> &points, bool timing=false);
         //!return the gpubox
@@ -79,7 +132,8 @@ class DelaunayLoc
         Dscalar polytiming,ringcandtiming,reducedtiming,tritiming,tritesttiming,geotiming,totaltiming;
 
     protected:
-        std::vector<Dscalar2> pts;    //!<vector of points to triangulate
+        const Dscalar2 *pts;          //!<the points to triangulate, either ownedPts or an external array
+        std::vector<Dscalar2> ownedPts; //!<storage for points that have been copied into the class
         int nV;                       //!<number of vertices
         bool triangulated;            //!<has a triangulation been performed?
 
@@ -88,7 +142,42 @@ class DelaunayLoc
 
         vector<int> DTringIdxCGAL; //!<A vector of Delaunay neighbor indicies that can be repeatedly re-written
         vector<Dscalar2> DTringCGAL;//!<A vector of Delaunay neighbors that can be repeatedly re-written
-        //!A cell list for speeding up the calculation of the candidate 1-ring
-        cellListGPU cList;
+        //!Per-thread scratch space for getNeighborsLocal, kept between calls
+        vector<oneRingScratch> threadScratch;
+        //!Per-thread neighbor buffers for getNeighborsLocal, kept between calls
+        vector< vector<int> > threadNeighs;
+        //!Triangulate an entire candidate 1-ring with CGAL and read off the neighbors of its first point
+        bool triangulateRingCGAL(const vector<int> &DTringIdx, const vector<Dscalar2> &DTring, vector<int> &neighbors);
+        //!A cell list for speeding up the calculation of the candidate 1-ring; either ownedCellList or a shared one
+        cellListGPU *cList;
+        //!The cell list used when the class owns its points
+        cellListGPU ownedCellList;
+    };
+
+//!Lend a set of points and a cell list to a DelaunayLoc for the lifetime of this object
+/*!
+The host pointer of an ArrayHandle is only valid while the handle is alive, so a binding should be
+declared right after the handle it takes its pointer from, in the same scope. The DelaunayLoc reads
+the points only while the binding exists, and has no points once it goes out of scope, so a resize
+of the underlying array (or a write to it on the GPU) can never leave it with a dangling or stale
+pointer.
+*/
+class DelaunayLocBinding
+    {
+    public:
+        //!Bind the points and cell list to del
+        DelaunayLocBinding(DelaunayLoc &del, const Dscalar2 *points, int N, cellListGPU *sharedCellList) : delLoc(del)
+            {
+            delLoc.setSharedPoints(points,N,sharedCellList);
+            };
+        //!Release the points
+        ~DelaunayLocBinding(){delLoc.releaseSharedPoints();};
+    private:
+        //!The bound DelaunayLoc
+        DelaunayLoc &delLoc;
+        //!Bindings are tied to a scope, so they cannot be copied
+        DelaunayLocBinding(const DelaunayLocBinding &other);
+        //!Bindings are tied to a scope, so they cannot be assigned
+        DelaunayLocBinding & operator=(const DelaunayLocBinding &other);
     };
 #endif
@@ -100,6 +100,8 @@ class Simple2DActiveCell : public Simple2DCell
 
         //!call the Simple2DCell spatial cell sorter, and re-index arrays of cell activity
         void spatiallySortCellsAndCellActivity();
+        //!Rebuild the Simple2DCell arrays, and the arrays of cell activity
+        virtual void rebuildCellArrays(const vector<int> &cellSources, int newCells);
 
     //public member variables
     public:
@@ -7,6 +7,7 @@
 #include "HilbertSort.h"
 #include "noiseSource.h"
 #include "functions.h"
+#include "vectorField.h"
 
 /*! \file Simple2DCell.h */
 //! Implement data structures and functions common to many off-lattice models of cells in 2D
@@ -29,6 +30,14 @@ class Simple2DCell : public Simple2DModel
 
         //!Enforce CPU-only operation. Derived classes might have to do more work when the CPU mode is invoked
         virtual void setCPU(){GPUcompute = false;};
+        //!Set the number of CPU threads used by the force, geometry, and topology routines
+        virtual void setNumThreads(int n){nThreads = max(1,n);};
+        //!Get the number of CPU threads in use
+        int getNumThreads(){return nThreads;};
+        //!Set the precision in which the energy is accumulated (the result is always a Daccum)
+        virtual void setAccumulatorPrecision(accumulator_precision::Enum precision){accumulation = precision;};
+        //!Get the precision in which the energy is accumulated
+        accumulator_precision::Enum getAccumulatorPrecision(){return accumulation;};
 
         //!get the number of degrees of freedom, defaulting to the number of cells
         virtual int getNumberOfDegreesOfFreedom(){return Ncells;};
@@ -45,7 +54,7 @@ class Simple2DCell : public Simple2DModel
 
 
         //!do everything necessary to compute the energy for the current model
-        virtual Dscalar computeEnergy(){Energy = 0.0; return 0.0;};
+        virtual Daccum computeEnergy(){Energy = 0.0; return 0.0;};
         //!Call masses and velocities to get the total kinetic energy
         Dscalar computeKineticEnergy();
         //!Call masses and velocities to get the average kinetic contribution to the pressure tensor
@@ -76,9 +85,9 @@ class Simple2DCell : public Simple2DModel
         virtual void cellDeath(int cellIndex);
 
         //!Set cell positions according to a user-specified vector
-        void setCellPositions(vector<Dscalar2> newCellPositions);
+        virtual void setCellPositions(vector<Dscalar2> newCellPositions);
         //!Set vertex positions according to a user-specified vector
-        void setVertexPositions(vector<Dscalar2> newVertexPositions);
+        virtual void setVertexPositions(vector<Dscalar2> newVertexPositions);
         //!Set velocities via a temperature. The return value is the total kinetic energy
         Dscalar setCellVelocitiesMaxwellBoltzmann(Dscalar T);
         //!Set velocities via a temperature for the vertex degrees of freedom
@@ -145,6 +154,8 @@ class Simple2DCell : public Simple2DModel
         void reIndexVertexArray(GPUArray<Dscalar2> &array);
         //!Perform a spatial sorting of the cells to try to maintain data locality
         void spatiallySortCells();
+        //!Remove and duplicate cells with a single pass over each per-cell array
+        virtual void rebuildCellArrays(const vector<int> &cellSources, int newCells);
         //!Perform a spatial sorting of the vertices to try to maintain data locality
         void spatiallySortVertices();
 
@@ -177,7 +188,8 @@ class Simple2DCell : public Simple2DModel
         */
         GPUArray<int> vertexNeighbors;
 
-        void getCellNeighs(int idx, int &nNeighs, vector<int> &neighs)
+        //!Get the neighbors of cell idx
+        virtual void getCellNeighs(int idx, int &nNeighs, vector<int> &neighs)
             {
             ArrayHandle<int> h_nn(cellNeighborNum,access_location::host,access_mode::read);
             ArrayHandle<int> h_n(cellNeighbors,access_location::host,access_mode::read);
@@ -223,7 +235,7 @@ class Simple2DCell : public Simple2DModel
         Index2D cellTypeIndexer;
 
         //!The current potential energy of the system; only updated when an explicit energy calculation is called (i.e. not by default each timestep)
-        Dscalar Energy;
+        Daccum Energy;
         //!The current kinetic energy of the system; only updated when an explicit calculation is called
         Dscalar KineticEnergy;
         //!To write consistent files...the cell that started the simulation as index i has current index tagToIdx[i]
@@ -263,6 +275,10 @@ class Simple2DCell : public Simple2DModel
     protected:
         //!Compute aspects of the model on the GPU
         bool GPUcompute;
+        //!The number of CPU threads to use when GPUcompute is false
+        int nThreads;
+        //!The precision of the energy sums (extended by default)
+        accumulator_precision::Enum accumulation;
 
         //! A flag that determines whether the GPU RNG is the same every time.
         bool Reproducible;
@@ -322,20 +338,11 @@ class Simple2DCell : public Simple2DModel
 
     //reporting functions
     public:
-        //!Get the maximum force on a cell
+        //!Get the maximum force on a cell, as the largest absolute value of any force component
         Dscalar getMaxForce()
             {
-            Dscalar maxForceNorm = 0.0;
             ArrayHandle<Dscalar2> h_f(cellForces,access_location::host,access_mode::read);
-            for (int i = 0; i < Ncells; ++i)
-                {
-                Dscalar2 temp2 = h_f.data[i];
-                Dscalar temp = sqrt(temp2.x*temp2.x+temp2.y*temp2.y);
-                temp = max(fabs(temp2.x),fabs(temp2.y));
-                if (temp >maxForceNorm)
-                    maxForceNorm = temp;
-                };
-            return maxForceNorm;
+            return constVectorField2D(h_f.data,Ncells).maxAbsComponent();
             };
         //!Report the current average force on each cell
         void reportMeanCellForce(bool verbose);
@@ -30,6 +30,10 @@ class Simple2DModel
         virtual void setGPU() = 0;
         //!Enforce CPU-only operation. Derived classes might have to do more work when the CPU mode is invoked
         virtual void setCPU() = 0;
+        //!Set the number of threads to use in CPU routines
+        virtual void setNumThreads(int n){};
+        //!Set the precision in which sums over the whole system are accumulated
+        virtual void setAccumulatorPrecision(accumulator_precision::Enum precision){};
         //!get the number of degrees of freedom, defaulting to the number of cells
         virtual int getNumberOfDegreesOfFreedom() = 0;
         //!do everything necessary to compute forces in the current model
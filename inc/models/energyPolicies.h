@@ -0,0 +1,114 @@
+#ifndef ENERGYPOLICIES_H
+#define ENERGYPOLICIES_H
+
+#include "std_include.h"
+#include "indexer.h"
+
+/*! \file energyPolicies.h */
+/** @defgroup energyPolicies energyPolicies
+ * @{
+ \brief Small policy objects that describe an energy functional to the templated CPU force routines
+
+ The CPU force routines of the Voronoi and vertex models (VoronoiQuadraticEnergy::computeVoronoiForceCPU
+ and VertexQuadraticEnergy::computeVertexForcesCPU) are templated on two policies. A cell-energy
+ policy supplies the derivatives of the energy of a cell with respect to its area and perimeter, and an
+ edge-tension policy supplies the line tension of the edge between two cells. The policies are passed
+ by value and their member functions are inlined, so each combination compiles to its own force loop
+ without any run-time switches; an edge-tension policy with active == false removes the tension terms
+ entirely. A new energy needs only a new policy (and an instantiation of the force routines for it).
+ */
+
+//!The quadratic energy of each cell, E_i = K_A(A_i-A_{i,0})^2 + K_P(P_i-P_{i,0})^2
+struct quadraticAreaPerimeterEnergy
+    {
+    //!Point at the (host) area and perimeter data
+    quadraticAreaPerimeterEnergy(Dscalar ka, Dscalar kp, const Dscalar2 *ap, const Dscalar2 *appref)
+        : KA(ka), KP(kp), AP(ap), APpref(appref) {};
+
+    //!One half of (dE/dA, dE/dP) of the given cell; the force routines apply the factor of two
+    inline Dscalar2 halfdEdAP(int cell) const
+        {
+        return make_Dscalar2(KA*(AP[cell].x - APpref[cell].x),KP*(AP[cell].y - APpref[cell].y));
+        };
+
+    //!The total energy of cells 0 to n-1, summed in order as Accumulators
+    template<typename Accumulator>
+    Daccum totalEnergy(int n) const
+        {
+        Accumulator energy = 0.0;
+        for (int cell = 0; cell < n; ++cell)
+            {
+            energy += KA*(AP[cell].x - APpref[cell].x)*(AP[cell].x - APpref[cell].x);
+            energy += KP*(AP[cell].y - APpref[cell].y)*(AP[cell].y - APpref[cell].y);
+            };
+        return energy;
+        };
+    //!The total energy of cells 0 to n-1, accumulated in the given precision
+    Daccum totalEnergy(int n, accumulator_precision::Enum precision) const
+        {
+        if (precision == accumulator_precision::storage)
+            return totalEnergy<Dscalar>(n);
+        return totalEnergy<Daccum>(n);
+        };
+
+    //!The area stiffness
+    Dscalar KA;
+    //!The perimeter stiffness
+    Dscalar KP;
+    //!The current area and perimeter of every cell
+    const Dscalar2 *AP;
+    //!The preferred area and perimeter of every cell
+    const Dscalar2 *APpref;
+    };
+
+//!No line tension between any cells
+struct noEdgeTension
+    {
+    //!The force routines skip the tension terms altogether
+    static const bool active = false;
+    //!The tension of the edge between two cells
+    inline Dscalar operator()(int cellA, int cellB) const {return 0.0;};
+    };
+
+//!A single line tension, gamma, between every pair of cells of different type
+struct uniformEdgeTension
+    {
+    static const bool active = true;
+    //!Point at the (host) cell types
+    uniformEdgeTension(Dscalar g, const int *ct) : gamma(g), types(ct) {};
+    //!The tension of the edge between two cells
+    inline Dscalar operator()(int cellA, int cellB) const
+        {
+        return types[cellA] == types[cellB] ? 0.0 : gamma;
+        };
+
+    //!The tension between unlike cells
+    Dscalar gamma;
+    //!The type of every cell
+    const int *types;
+    };
+
+//!A line tension between cells of different type given by a matrix of type-type values
+struct matrixEdgeTension
+    {
+    static const bool active = true;
+    //!Point at the (host) tension matrix, its indexer, and the cell types
+    matrixEdgeTension(const Dscalar *tm, Index2D ti, const int *ct) : tensions(tm), typeIndexer(ti), types(ct) {};
+    //!The tension of the edge between two cells; the diagonal of the matrix is never used
+    inline Dscalar operator()(int cellA, int cellB) const
+        {
+        int typeA = types[cellA];
+        int typeB = types[cellB];
+        return typeA == typeB ? 0.0 : tensions[typeIndexer(typeB,typeA)];
+        };
+
+    //!The flattened tension matrix
+    const Dscalar *tensions;
+    //!Indexes the tension matrix by a pair of types
+    Index2D typeIndexer;
+    //!The type of every cell
+    const int *types;
+    };
+
+/** @} */ //end of group declaration
+#endif
@@ -72,8 +72,19 @@ class vertexModelBase : public Simple2DActiveCell
         //!Kill the indexed cell...cell must have only three associated vertices
         virtual void cellDeath(int cellIndex);
 
+        //!Set vertex positions according to a user-specified vector, and invalidate the short-edge watch list
+        virtual void setVertexPositions(vector<Dscalar2> newVertexPositions)
+            {
+            Simple2DCell::setVertexPositions(newVertexPositions);
+            invalidateT1WatchList();
+            };
+
         //!Set the length threshold for T1 transitions
-        virtual void setT1Threshold(Dscalar t1t){T1Threshold = t1t;};
+        virtual void setT1Threshold(Dscalar t1t){T1Threshold = t1t; invalidateT1WatchList();};
+        //!Set how far edges may shorten before the CPU short-edge watch list is rebuilt (a value <= 0 tests every edge every time)
+        void setT1WatchHorizon(Dscalar horizon){T1WatchHorizon = horizon; invalidateT1WatchList();};
+        //!Make the next CPU T1 test scan every edge...call this after moving vertices by anything other than moveDegreesOfFreedom
+        void invalidateT1WatchList(){T1WatchListValid = false;};
 
         //!Simple test for T1 transitions (edge length less than threshold) on the CPU
         void testAndPerformT1TransitionsCPU();
@@ -111,6 +122,8 @@ class vertexModelBase : public Simple2DActiveCell
     protected:
         //!if the maximum number of vertices per cell increases, grow the cellVertices list
         void growCellVerticesList(int newVertexMax);
+        //!The per-cell capacity of cellVertices needed to hold newVertexMax vertices per cell, with room to grow
+        int amortizedVertexMax(int newVertexMax);
 
         //!Initialize the data structures for edge flipping...should also be called if Nvertices changes
         void initializeEdgeFlipLists();
@@ -122,9 +135,36 @@ class vertexModelBase : public Simple2DActiveCell
         //!perform the edge flips found in the previous step
         void flipEdgesGPU();
 
+        //!test the edges for a T1 event on the CPU, filling t1Candidates
+        void testEdgesForT1CPU();
+        //!perform the T1 transitions of t1Candidates, at most one per cell per round
+        void flipEdgesCPU();
+        //!The edges (vertex1 < vertex2) found by testEdgesForT1CPU that have not been flipped yet
+        vector<int2> t1Candidates;
+        //!The last round of flipEdgesCPU in which each cell took part in a T1 transition
+        vector<int> T1CellClaims;
+        //!The number of rounds of flipEdgesCPU so far (reset when T1CellClaims is re-allocated)
+        int T1ClaimRound;
+        //!File the edge (v1,v2), of the given length, in the short-edge watch list
+        void watchEdgeForT1(int v1, int v2, Dscalar length);
+        //!Whether the short-edge watch list is current
+        bool T1WatchListValid;
+        //!An upper bound on how much any edge has shortened since the watch list was built
+        Dscalar T1WatchShortening;
+        //!Edges that cannot reach T1Threshold before T1WatchShortening reaches this value are not watched
+        Dscalar T1WatchHorizon;
+        //!Watched edges, bucketed by the value of T1WatchShortening at which they might reach T1Threshold
+        vector<vector<int2> > T1WatchBuckets;
+        //!The box dimensions when the watch list was built
+        Dscalar4 T1WatchBox;
+
         //utility functions
         //!For finding T1s on the CPU; find the set of vertices and cells involved in the transition
-        void getCellVertexSetForT1(int v1, int v2, int4 &cellSet, int4 &vertexSet, bool &growList);
+        void getCellVertexSetForT1(int v1, int v2, int4 &cellSet, int4 &vertexSet, bool &growList,
+                                   const int *h_cv, const int *h_cvn, const int *h_vcn);
+        //!Perform one T1 transition on the CPU, given host pointers to the topology arrays
+        void performT1TransitionCPU(int v1, int v2, const int4 &cellSet, const int4 &vertexSet,
+                                    Dscalar2 *h_v, int *h_vn, int *h_cvn, int *h_cv, int *h_vcn);
 
         //! data structure to help with not simultaneously trying to flip nearby edges
         GPUArray<int> finishedFlippingEdges;
@@ -2,6 +2,7 @@
 #define vertexQuadraticEnergy_H
 
 #include "vertexModelBase.h"
+#include "energyPolicies.h"
 
 /*! \file vertexQuadraticEnergy.h */
 //!Implement a 2D active vertex model, using kernels in \ref avmKernels
@@ -24,13 +25,18 @@ class VertexQuadraticEnergy : public vertexModelBase
         virtual void computeForces();
 
         //!compute the quadratic energy functional
-        virtual Dscalar computeEnergy();
+        virtual Daccum computeEnergy();
 
         //!Compute the geometry (area & perimeter) of the cells on the CPU
         void computeForcesCPU();
         //!Compute the geometry (area & perimeter) of the cells on the GPU
         void computeForcesGPU();
 
+    protected:
+        //!Compute the force sets and the net force on every vertex on the CPU for the energy given by the policies
+        template<class CellEnergy, class EdgeTension>
+        void computeVertexForcesCPU(const CellEnergy &energy, const EdgeTension &tension);
+
     //be friends with the associated Database class so it can access data to store or read
     friend class AVMDatabaseNetCDF;
     };
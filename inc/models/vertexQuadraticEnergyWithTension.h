@@ -20,7 +20,7 @@ class VertexQuadraticEnergyWithTension : public VertexQuadraticEnergy
         virtual void computeForces();
         
         //!compute the quadratic energy functional
-        virtual Dscalar computeEnergy();
+        virtual Daccum computeEnergy();
 
         //!Compute the forces on the GPU with only a single tension value
         virtual void computeVertexSimpleTensionForceGPU();
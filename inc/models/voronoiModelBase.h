@@ -6,6 +6,7 @@
 #include "cellListGPU.h"
 #include "DelaunayLoc.h"
 #include "DelaunayCGAL.h"
+#include "DelaunayFlip.h"
 #include "voronoiModelBase.cuh"
 
 
@@ -35,6 +36,77 @@ class voronoiModelBase : public Simple2DActiveCell
         very infrequently, it may be faster.
         */
         void setCPU(bool global = true){GPUcompute = false;globalOnly=global;};
+        //!Maintain the triangulation by edge flips rather than by circumcircle tests and local repairs
+        /*!
+        \param flip defaults to true.
+        When set, the triangulation from the previous time step is brought back to a Delaunay
+        state by Lawson edge flips on the CPU, checking only the triangles whose displacement
+        certificates have expired. If the motion of the points has inverted a triangle a global
+        re-triangulation is performed instead. Code that writes to cellPositions other than through
+        moveDegreesOfFreedom or setCellPositions should call delFlip.invalidateCertificates() (and
+        celllist.forgetParticleBins()).
+        */
+        void setEdgeFlipTopology(bool flip = true){edgeFlipTopology = flip;flipTriangulationInitialized = false;};
+        //!Set cell positions according to a user-specified vector; the edge-flip certificates and cell list bins are invalidated
+        virtual void setCellPositions(vector<Dscalar2> newCellPositions)
+            {
+            Simple2DCell::setCellPositions(newCellPositions);
+            delFlip.invalidateCertificates();
+            celllist.forgetParticleBins();
+            };
+        //!Skip the CPU circumcircle tests of triangles that are certified to still be Delaunay
+        /*!
+        \param certify defaults to true.
+        When set (and when local testing is used on the CPU), each triangle is given a displacement
+        tolerance when it is validated, and only triangles whose tolerance is smaller than the
+        maximum displacement of any cell since then are re-tested.
+        */
+        void setCertifiedSkipping(bool certify = true){certifiedSkipping = certify;certificatesValid = false;};
+        //!Let testAndRepairTriangulation choose between local repairs and global triangulations based on their measured costs
+        /*!
+        \param adapt defaults to true. When false, a global triangulation is performed whenever more than Ncells/6 cells need repair
+        \param smoothing the weight given to each new timing in the exponential moving averages of the costs
+        \param refreshPeriod the number of time steps after which a global triangulation is timed again (see globalTimingDue); non-positive values turn the periodic re-timing off
+        */
+        void setAdaptiveRepairPolicy(bool adapt = true, Dscalar smoothing = 0.1, int refreshPeriod = 1000)
+            {
+            adaptiveRepair = adapt; repairCostSmoothing = smoothing; repairCostRefreshPeriod = refreshPeriod;
+            };
+        //!The number of cells needing repair above which a global triangulation is predicted to be cheaper
+        Dscalar getRepairCrossover();
+        //!Should the next repair be a global triangulation, so that its cost is measured again?
+        bool globalTimingDue();
+        //!Use the thin-halo (rather than CGAL's periodic) routine for global triangulations
+        /*!
+        \param halo defaults to true
+        \param width the initial width of the strip of periodic images; negative values let DelaunayCGAL choose
+        */
+        void setHaloTriangulation(bool halo = true, Dscalar width = -1.0){haloTriangulation = halo; haloWidth = width; globalTriangulationCost = -1.0;};
+        //!Split global triangulations of large systems into strips that are triangulated concurrently
+        /*!
+        \param threads the number of strips (and threads); values below two turn the strip decomposition off
+        \param minimumCells systems with fewer cells are always triangulated as a whole
+        This is independent of setNumThreads, so changing the number of threads used by the tests,
+        repairs and forces never changes the routine that performs global triangulations.
+        */
+        void setParallelTriangulation(int threads, int minimumCells = 10000)
+            {
+            parallelTriangulationThreads = max(1,threads); parallelTriangulationMinimum = minimumCells; globalTriangulationCost = -1.0;
+            };
+        //!Set the number of CPU threads, and forget the measured repair costs (which depend on it)
+        virtual void setNumThreads(int n){Simple2DActiveCell::setNumThreads(n); localRepairCost = -1.0; globalTriangulationCost = -1.0;};
+        //!Store the neighbor-dependent arrays in a compressed (CSR) layout rather than padding every cell to neighMax entries
+        /*!
+        \param compress defaults to true.
+        In the compressed layout each cell reserves room for its current number of neighbors plus
+        neighborSlack, so the arrays hold about (6+neighborSlack)*Ncells entries regardless of the
+        largest number of neighbors of any cell. Only the CPU routines understand this layout.
+        */
+        void setCompressedNeighbors(bool compress = true);
+        //!Enforce GPU operation, which requires the padded neighbor layout
+        virtual void setGPU(){if(compressedNeighbors) setCompressedNeighbors(false); GPUcompute = true;};
+        //!Get the neighbors of cell idx in either neighbor layout
+        virtual void getCellNeighs(int idx, int &nNeighs, vector<int> &neighs);
         //!write triangulation to text file
         void writeTriangulation(ofstream &outfile);
         //!read positions from text file...for debugging
@@ -67,12 +139,15 @@ class voronoiModelBase : public Simple2DActiveCell
 
         //!Kill the indexed cell by simply removing it from the simulation
         virtual void cellDeath(int cellIndex);
+        //!Divide and kill many cells at once, with a single update of the triangulation
+        virtual void cellDivisionsAndDeaths(const vector<int> &dividingCells, const vector<Dscalar> &divisionParameters,
+                                            const vector<int> &dyingCells);
 
         //!move particles on the GPU
         void movePoints(GPUArray<Dscalar2> &displacements,Dscalar scale);
         //!move particles on the CPU
         void movePointsCPU(GPUArray<Dscalar2> &displacements,Dscalar scale);
-        //!Transfer particle data from the GPU to the CPU for use by delLoc
+        //!Make the host positions and the cell list current for use by delLoc; needed before every use of delLoc (together with a DelaunayLocBinding)
         void resetDelLocPoints();
 
         //!Update the cell list structure after particles have moved
@@ -93,12 +168,27 @@ class voronoiModelBase : public Simple2DActiveCell
         //!build the auxiliary data structure containing the indices of the particle circumcenters from the neighbor list
         void getCircumcenterIndices(bool secondtime=false,bool verbose = false);
 
+        //!Remove the NeighIdxs and circumcenter entries of a set of cells before their neighbor lists change
+        void removeLocalTopologyEntries(const vector<int> &cells);
+        //!Add the NeighIdxs and circumcenter entries of a set of cells after their neighbor lists change
+        void addLocalTopologyEntries(const vector<int> &cells);
+        //!Check the incrementally updated NeighIdxs and circumcenters against a full rebuild
+        void checkLocalTopologyEntries();
+
+        //!Compute the voronoi vertices, area, and perimeter of cell i, given host pointers to the relevant arrays
+        void computeVoronoiGeometryCPU(int i, const Dscalar2 *h_p, const int *h_nn, const int *h_n,
+                                       Dscalar2 *h_v, Dscalar4 *h_vln, Dscalar2 *h_AP);
+
         //!Test the current neighbor list to see if it is still a valid triangulation. GPU function
         void testTriangulation();
         //!Test the validity of the triangulation on the CPU
         void testTriangulationCPU();
+        //!Test only the triangles that may have been invalidated since the last certification
+        int testCertifiedTriangulationCPU();
         //!repair any problems with the triangulation on the CPU
         void repairTriangulation(vector<int> &fixlist);
+        //!Restore the Delaunay property of the triangulation by edge flips on the CPU
+        void flipTriangulation();
         //!A workhorse function that calls the appropriate topology testing and repairing routines
         void testAndRepairTriangulation(bool verb = false);
         //! call getDelSets for all particles
@@ -109,8 +199,20 @@ class voronoiModelBase : public Simple2DActiveCell
         bool getDelSets(int i);
         //!resize all neighMax-related arrays
         void resetLists();
-        //!do resize and resetting operations common to cellDivision and cellDeath
-        void resizeAndReset();
+        //!Compute the layout of the neighbor-dependent arrays for the given numbers of neighbors, and resize cellNeighbors to match
+        bool setNeighborLayout(const int *neighborNum);
+        //!Move the current neighbor lists into a layout with room for neighborNum[i] neighbors of each cell i
+        void relayoutNeighbors(const vector<int> &neighborNum);
+        //!Write the new neighbor lists of a set of cells, and update the NeighIdxs and circumcenter lists
+        bool setLocalNeighbors(const vector<int> &cells, const vector<int> &neighs, const vector<int> &start, const vector<int> &stop);
+        //!Rebuild the Simple2DActiveCell arrays and the per-cell arrays of the Voronoi model
+        virtual void rebuildCellArrays(const vector<int> &cellSources, int newCells);
+        //!Find the positions of the two daughters of a cell that divides along the axis at angle theta
+        void getDivisionPositions(int cellIdx, Dscalar theta, Dscalar separationFraction, Dscalar2 &newCellPos1, Dscalar2 &newCellPos2);
+        //!Recompute only the neighbor lists changed by removing and inserting cells
+        bool updateTopologyLocally(const vector<int> &cellSources, int newCells, const vector<int> &removedCells,
+                                   const vector<int> &insertedCells, const vector<int> &oldNeighborNum,
+                                   const vector<int> &oldNeighbors, const vector<int> &oldOffsets);
 
         //Some functions associated with derivates of voronoi vertex positions or cell geometries
         //!The derivative of a voronoi vertex position with respect to change in the first cells position
@@ -125,11 +227,15 @@ class voronoiModelBase : public Simple2DActiveCell
         Matrix2x2 d2Peridvdr(Matrix2x2 &dvdr, Matrix2x2 &dvmdr, Matrix2x2 &dvpdr,Dscalar2 vm, Dscalar2 v, Dscalar2 vp);
         //!second derivatives of voronoi vertex with respect to cell positions
         vector<Dscalar> d2Hdridrj(Dscalar2 rj, Dscalar2 rk, int jj);
+        //!second derivatives of voronoi vertex with respect to cell positions, written into an array of 8 Dscalars
+        void d2Hdridrj(Dscalar2 rj, Dscalar2 rk, int jj, Dscalar *answer);
 
     //public member variables
     public:
-        //!The class' local Delaunay tester/updater
+        //!The class' local Delaunay tester/updater; it can only read cellPositions while a DelaunayLocBinding is in scope (see resetDelLocPoints)
         DelaunayLoc delLoc;
+        //!The class' edge-flipping triangulation maintainer
+        DelaunayFlip delFlip;
 
         //!Collect statistics of how many triangulation repairs are done per frame, etc.
         Dscalar repPerFrame;
@@ -143,6 +249,16 @@ class voronoiModelBase : public Simple2DActiveCell
         GPUArray<int> exclusions;
         //!The number of topology updates performed at the individual particle level
         int localTopologyUpdates;
+        //!How many triangle circumcircles were re-tested in the certified skipping mode
+        int certifiedRetests;
+        //!Exponential moving average of the wall-clock seconds per repaired cell of local repairs
+        Dscalar localRepairCost;
+        //!Exponential moving average of the wall-clock seconds per cell of global triangulations
+        Dscalar globalTriangulationCost;
+        //!How many times has testAndRepairTriangulation chosen a local repair?
+        int localRepairsChosen;
+        //!How many times has testAndRepairTriangulation chosen a global triangulation?
+        int globalTriangulationsChosen;
 
 
     protected:
@@ -152,17 +268,31 @@ class voronoiModelBase : public Simple2DActiveCell
         Dscalar cellsize;            
         //!An upper bound for the maximum number of neighbors that any cell has
         int neighMax;
+        //!Are the neighbor-dependent arrays stored in the compressed layout?
+        bool compressedNeighbors;
+        //!The number of spare entries each cell is given in the compressed layout
+        int neighborSlack;
+        //!neighborOffsets[i] is the position of the first entry of cell i in the neighbor-dependent arrays; neighborOffsets[Ncells] is their size
+        vector<int> neighborOffsets;
+        //!The CPU indexer of cellNeighbors and the other neighbor-dependent arrays, valid in either layout (n_idx is only valid in the padded one)
+        IndexCSR neigh_idx;
 
         //!An array that holds (particle, neighbor_number) info to avoid intra-warp divergence in GPU
         //!-based force calculations that might be used by child classes
         GPUArray<int2> NeighIdxs;
         //!A utility integer to help with NeighIdxs
         int NeighIdxNum;
+        //!neighIdxPosition[neigh_idx(nn,i)] is the position in NeighIdxs of the (i,nn) entry
+        vector<int> neighIdxPosition;
 
         //!A data structure that holds the indices of particles forming the circumcircles of the Delaunay Triangulation
         GPUArray<int3> circumcenters;
         //!The number of circumcircles...for a periodic system, this should never change. This provides one check that local updates to the triangulation are globally consistent
         int NumCircumCenters;
+        //!circumcenterPosition[neigh_idx(nn,i)] is the position in circumcenters of the triangle (i, neighbor nn, neighbor nn+1), or -1
+        vector<int> circumcenterPosition;
+        //!The (cell, neighbor slot) pair that generated each entry of circumcenters
+        vector<int2> circumcenterOwner;
 
         //!A flag that can be accessed by child classes... serves as notification that any change in the network topology has occured
         GPUArray<int> anyCircumcenterTestFailed;
@@ -183,6 +313,44 @@ class voronoiModelBase : public Simple2DActiveCell
         itself is CPU expensive
         */
         bool globalOnly;
+        //!Should the topology be maintained by edge flips?
+        bool edgeFlipTopology;
+        //!Is delFlip's triangulation in sync with the current neighbor lists?
+        bool flipTriangulationInitialized;
+        //!Should the choice between local and global repairs be based on measured costs?
+        bool adaptiveRepair;
+        //!The smoothing factor of the repair cost moving averages
+        Dscalar repairCostSmoothing;
+        //!The number of time steps after which a global triangulation is timed again
+        int repairCostRefreshPeriod;
+        //!The time step of the last timed global triangulation
+        int lastGlobalTimingStep;
+        //!The local repair cost when the last global triangulation was timed
+        Dscalar localCostAtGlobalTiming;
+        //!Update an exponential moving average of a cost (a negative value means no sample has been recorded)
+        void updateRepairCost(Dscalar &cost, Dscalar sample)
+            {
+            if (cost < 0)
+                cost = sample;
+            else
+                cost += repairCostSmoothing*(sample-cost);
+            };
+        //!Should global triangulations use DelaunayCGAL's thin-halo routine?
+        bool haloTriangulation;
+        //!The initial width of the halo used in global triangulations
+        Dscalar haloWidth;
+        //!The number of strips of a parallel global triangulation (one means no strip decomposition)
+        int parallelTriangulationThreads;
+        //!The smallest system for which the strip decomposition is used
+        int parallelTriangulationMinimum;
+        //!Should triangles with a displacement certificate skip the circumcircle test?
+        bool certifiedSkipping;
+        //!Are the triangle certificates consistent with the current triangulation?
+        bool certificatesValid;
+        //!The cell positions at the time the certificates were computed
+        vector<Dscalar2> certifiedPositions;
+        //!The displacement tolerance of each entry of circumcenters
+        vector<Dscalar> triangleTolerances;
         //!Count the number of times that testAndRepair has been called, separately from the derived class' time
         int timestep;
         //!A flag that notifies the existence of any particle exclusions (for which the net force is set to zero by fictitious external forces)
@@ -3,6 +3,7 @@
 
 #include "voronoiModelBase.h"
 #include "voronoiQuadraticEnergy.cuh"
+#include "energyPolicies.h"
 
 /*! \file voronoiQuadraticEnergy.h */
 //!Implement a 2D Voronoi model, with and without some extra bells and whistles, using kernels in \ref spvKernels
@@ -30,7 +31,7 @@ class VoronoiQuadraticEnergy : public voronoiModelBase
         virtual void computeForces();
 
         //!compute the quadratic energy functional
-        virtual Dscalar computeEnergy();
+        virtual Daccum computeEnergy();
 
         //cell-dynamics related functions...these call functions in the next section
         //in general, these functions are the common calls, and test flags to know whether to call specific versions of specialty functions
@@ -43,6 +44,8 @@ class VoronoiQuadraticEnergy : public voronoiModelBase
         //CPU functions
         //!Compute the net force on particle i on the CPU
         virtual void computeVoronoiForceCPU(int i);
+        //!Compute the geometry, the energy, and the net force on every cell in a single CPU pass
+        void computeGeometryAndForcesCPU();
 
         //GPU functions
         //!call gpu_force_sets kernel caller
@@ -59,11 +62,18 @@ class VoronoiQuadraticEnergy : public voronoiModelBase
 
         //!Save tuples for half of the dynamical matrix
         virtual void getDynMatEntries(vector<int2> &rcs, vector<Dscalar> &vals,Dscalar unstress = 1.0, Dscalar stress = 1.0);
+        //!The product of the dynamical matrix with a displacement of the cells, without forming the matrix
+        void computeHessianVectorProduct(GPUArray<Dscalar2> &u, GPUArray<Dscalar2> &Hu);
 
         //!calculate the current global off-diagonal stress
         virtual Dscalar getSigmaXY();
 
     protected:
+        //!Compute the net force on particle i on the CPU for the energy given by the policies, given host pointers to the relevant arrays
+        template<class CellEnergy, class EdgeTension>
+        void computeVoronoiForceCPU(int i, const Dscalar2 *h_p, const Dscalar2 *h_v, const int *h_nn, const int *h_n,
+                                    Dscalar2 *h_f, Dscalar2 *h_external_forces, const int *h_exes,
+                                    const CellEnergy &energy, const EdgeTension &tension);
         //! Second derivative of the energy w/r/t cell positions...for getting dynMat info
         Matrix2x2 d2Edridrj(int i, int j, neighborType neighbor,Dscalar unstress = 1.0, Dscalar stress = 1.0);
 
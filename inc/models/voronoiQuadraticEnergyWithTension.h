@@ -24,7 +24,7 @@ class VoronoiQuadraticEnergyWithTension : public VoronoiQuadraticEnergy
         virtual void computeForces();
         
         //!compute the quadratic energy functional
-        virtual Dscalar computeEnergy();
+        virtual Daccum computeEnergy();
 
         //!Compute force sets on the GPU
         virtual void ComputeForceSetsGPU();
@@ -56,6 +56,9 @@ class VoronoiQuadraticEnergyWithTension : public VoronoiQuadraticEnergy
         bool simpleTension;
         //!A flattened 2d matrix describing the surface tension, \gamma_{i,j} for types i and j
         GPUArray<Dscalar> tensionMatrix;
+        //!The energy, with its sums accumulated as Accumulators
+        template<typename Accumulator>
+        Daccum sumEnergy();
 
     //be friends with the associated Database class so it can access data to store or read
     friend class SPVDatabaseNetCDF;
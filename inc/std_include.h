@@ -75,6 +75,26 @@ using namespace std;
 #define Ceil ceilf
 #endif
 
+//Sums over the whole system (energies, and the power and norms of the minimizers) are returned as
+//Daccums, and the net force on a particle is summed as a Daccum2, even when Dscalars are floats. The
+//precision the system-wide sums are accumulated in is chosen per simulation at runtime (see
+//accumulator_precision and Simulation::setAccumulatorPrecision), so a float build can store and move
+//half as much data while keeping double-precision sums. The storage precision itself is a build
+//option (make float)
+#define Daccum double
+#define Daccum2 double2
+
+//!The precision in which sums over the whole system are accumulated
+struct accumulator_precision
+    {
+    //!The options
+    enum Enum
+        {
+        storage,    //!< accumulate in Dscalar (the cheapest choice in a float build)
+        extended    //!< accumulate in Daccum
+        };
+    };
+
 //!Less than operator for Dscalars just sorts by the x-coordinate
 HOSTDEVICE bool operator<(const Dscalar2 &a, const Dscalar2 &b)
     {
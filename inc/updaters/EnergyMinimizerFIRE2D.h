@@ -77,6 +77,8 @@ class EnergyMinimizerFIRE : public simpleEquationOfMotion
 
         //!Return the maximum force
         Dscalar getMaxForce(){return forceMax;};
+        //!Set the precision of the power, norm, and maximum force reductions
+        virtual void setAccumulatorPrecision(accumulator_precision::Enum precision){accumulation = precision;};
 
     protected:
         //!The number of iterations performed
@@ -84,7 +86,7 @@ class EnergyMinimizerFIRE : public simpleEquationOfMotion
         //!The maximum number of iterations allowed
         int maxIterations;
         //!The cutoff value of the maximum force
-        Dscalar forceMax;
+        Daccum forceMax;
         //!The cutoff value of the maximum force
         Dscalar forceCutoff;
         //!The number of points, or cells, or particles
@@ -104,7 +106,7 @@ class EnergyMinimizerFIRE : public simpleEquationOfMotion
         //!The fraction by which deltaT can get smaller
         Dscalar deltaTDec;
         //!The internal value of the "power"
-        Dscalar Power;
+        Daccum Power;
         //!The alpha parameter of the minimization routine
         Dscalar alpha;
         //!The initial value of the alpha parameter
@@ -126,8 +128,10 @@ class EnergyMinimizerFIRE : public simpleEquationOfMotion
         GPUArray<Dscalar> velocityDotVelocity;
 
         //!Utility array for simple reductions
-        GPUArray<Dscalar> sumReductionIntermediate;
+        GPUArray<Daccum> sumReductionIntermediate;
         //!Utility array for simple reductions
-        GPUArray<Dscalar> sumReductions;
+        GPUArray<Daccum> sumReductions;
+        //!The precision in which the reductions are accumulated
+        accumulator_precision::Enum accumulation;
     };
 #endif
@@ -42,6 +42,8 @@ class updater
 
         //!Allow for a reproducibility call to be made
         virtual void setReproducible(bool rep){};
+        //!Allow the precision of sums over the whole system (e.g., the reductions of a minimizer) to be set
+        virtual void setAccumulatorPrecision(accumulator_precision::Enum precision){};
 
         //!Enforce GPU-only operation. This is the default mode, so this method need not be called most of the time.
         virtual void setGPU(){GPUcompute = true;};
@@ -0,0 +1,127 @@
+#ifndef BATCHEDFUNCTIONS_H
+#define BATCHEDFUNCTIONS_H
+
+#include "std_include.h"
+
+#define BATCHED inline __attribute__((always_inline))
+//!Placed before a loop over the lanes of a batch, keeps it intact so that the loop vectorizer, rather than the full unroller, sees it
+#define BATCHLOOP _Pragma("GCC unroll 1")
+
+/*! \file batchedFunctions.h */
+/** @defgroup batchedFunctions batchedFunctions
+ * @{
+ \brief Host versions of some functions.h routines that act on a batch of inputs at once
+
+ Each routine evaluates the same expression as its scalar counterpart (in the same order of
+ operations, so the results agree bit for bit) for W independent inputs stored as separate arrays
+ of x and y components. The loop over the batch has a fixed trip count and no branches, so the
+ compiler can map it onto SIMD registers. BATCHWIDTH is chosen to fill a 256-bit register with
+ Dscalars. Callers fill unused lanes of a partial batch with any valid input and ignore the output.
+ The scalar routines in functions.h remain the reference implementations.
+ */
+
+#ifndef SCALARFLOAT
+//!The default number of inputs processed together by the batched routines
+#define BATCHWIDTH 4
+#else
+#define BATCHWIDTH 8
+#endif
+
+//!The circumcenters of the circles through x1, x2 and the origin; see Circumcenter(x1,x2,xc)
+template<int W>
+BATCHED void batchedCircumcenter(const Dscalar *x1x, const Dscalar *x1y, const Dscalar *x2x, const Dscalar *x2y,
+                                 Dscalar * __restrict__ xcx, Dscalar * __restrict__ xcy)
+    {
+    BATCHLOOP
+    for (int l = 0; l < W; ++l)
+        {
+        Dscalar x1norm2 = x1x[l]*x1x[l] + x1y[l]*x1y[l];
+        Dscalar x2norm2 = x2x[l]*x2x[l] + x2y[l]*x2y[l];
+        Dscalar denominator = 0.5/(x1x[l]*x2y[l]-x1y[l]*x2x[l]);
+        xcx[l] = denominator * (x1norm2*x2y[l]-x1y[l]*x2norm2);
+        xcy[l] = denominator * (x1x[l]*x2norm2-x1norm2*x2x[l]);
+        };
+    };
+
+//!The circumcenters of the circles through x1, x2 and x3; see Circumcenter(x1,x2,x3,xc)
+template<int W>
+BATCHED void batchedCircumcenter(const Dscalar *x1x, const Dscalar *x1y, const Dscalar *x2x, const Dscalar *x2y,
+                                 const Dscalar *x3x, const Dscalar *x3y, Dscalar * __restrict__ xcx, Dscalar * __restrict__ xcy)
+    {
+    BATCHLOOP
+    for (int l = 0; l < W; ++l)
+        {
+        Dscalar amcx = x1x[l]-x3x[l];
+        Dscalar amcy = x1y[l]-x3y[l];
+        Dscalar amcnorm2 = amcx*amcx+amcy*amcy;
+        Dscalar bmcx = x2x[l]-x3x[l];
+        Dscalar bmcy = x2y[l]-x3y[l];
+        Dscalar bmcnorm2 = bmcx*bmcx+bmcy*bmcy;
+        Dscalar denominator = 0.5/(amcx*bmcy-amcy*bmcx);
+        xcx[l] = x3x[l] + denominator * (amcnorm2*bmcy-amcy*bmcnorm2);
+        xcy[l] = x3y[l] + denominator * (amcx*bmcnorm2-amcnorm2*bmcx);
+        };
+    };
+
+//!The areas of the triangles (origin,p1,p2) and the lengths of the edges p1-p2; see TriangleArea
+template<int W>
+BATCHED void batchedTriangleAreaAndEdge(const Dscalar *p1x, const Dscalar *p1y, const Dscalar *p2x, const Dscalar *p2y,
+                                        Dscalar * __restrict__ area, Dscalar * __restrict__ edge)
+    {
+    BATCHLOOP
+    for (int l = 0; l < W; ++l)
+        {
+        area[l] = abs(0.5*(p1x[l]*p2y[l]-p1y[l]*p2x[l]));
+        Dscalar dx = p1x[l]-p2x[l];
+        Dscalar dy = p1y[l]-p2y[l];
+        edge[l] = sqrt(dx*dx+dy*dy);
+        };
+    };
+
+//!The derivative of the voronoi vertex of (origin,r1,r2) with respect to the point at the origin
+/*!
+This is the dhdri matrix of the CPU force routines of the Voronoi models, i.e. the change in the
+circumcenter of (ri,rj,rk) when ri moves, with r1 = rj-ri and r2 = rk-ri. It is evaluated exactly as
+Id+1.0/D*(dyad(r1,dbDdri)+dyad(r2,dgDdri)-(betaD+gammaD)*Id-dyad(z,dDdriOD)) is with Matrix2x2
+objects, without the multiplications by the zero entries of the identity.
+*/
+template<int W>
+BATCHED void batchedVoronoiVertexDerivative(const Dscalar *r1x, const Dscalar *r1y, const Dscalar *r2x, const Dscalar *r2y,
+                                            Dscalar * __restrict__ dh11, Dscalar * __restrict__ dh12, Dscalar * __restrict__ dh21, Dscalar * __restrict__ dh22)
+    {
+    BATCHLOOP
+    for (int l = 0; l < W; ++l)
+        {
+        Dscalar rjkx = r2x[l]-r1x[l];
+        Dscalar rjky = r2y[l]-r1y[l];
+        Dscalar r1r1 = r1x[l]*r1x[l]+r1y[l]*r1y[l];
+        Dscalar r2r2 = r2x[l]*r2x[l]+r2y[l]*r2y[l];
+        Dscalar r1rjk = r1x[l]*rjkx+r1y[l]*rjky;
+        Dscalar r2rjk = r2x[l]*rjkx+r2y[l]*rjky;
+
+        Dscalar betaD = -r2r2*r1rjk;
+        Dscalar gammaD = r1r1*r2rjk;
+        Dscalar cp = r1x[l]*rjky - r1y[l]*rjkx;
+        Dscalar D = 2*cp*cp;
+
+        Dscalar zx = betaD*r1x[l]+gammaD*r2x[l];
+        Dscalar zy = betaD*r1y[l]+gammaD*r2y[l];
+        Dscalar dbx = 2*r1rjk*r2x[l]+r2r2*rjkx;
+        Dscalar dby = 2*r1rjk*r2y[l]+r2r2*rjky;
+        Dscalar dgx = -2*r2rjk*r1x[l]-r1r1*rjkx;
+        Dscalar dgy = -2*r2rjk*r1y[l]-r1r1*rjky;
+        Dscalar dDx = (-2.0*rjky)/cp;
+        Dscalar dDy = (2.0*rjkx)/cp;
+
+        Dscalar bg = betaD+gammaD;
+        Dscalar invD = 1.0/D;
+        dh11[l] = 1.0 + invD*(((r1x[l]*dbx + r2x[l]*dgx) - bg) - zx*dDx);
+        dh12[l] = invD*((r1x[l]*dby + r2x[l]*dgy) - zx*dDy);
+        dh21[l] = invD*((r1y[l]*dbx + r2y[l]*dgx) - zy*dDx);
+        dh22[l] = 1.0 + invD*(((r1y[l]*dby + r2y[l]*dgy) - bg) - zy*dDy);
+        };
+    };
+
+/** @} */ //end of group declaration
+#undef BATCHED
+#endif
@@ -5,6 +5,8 @@
 #include "gpubox.h"
 #include "gpuarray.h"
 #include "indexer.h"
+#include <queue>
+#include <functional>
 
 
 /*! \file cellListGPU.h */
@@ -18,7 +20,7 @@ class cellListGPU
     {
     public:
         //!Blank constructor
-        cellListGPU(){Nmax=0;Box = make_shared<gpubox>();};
+        cellListGPU(){Nmax=0;binsTracked=false;displacementBound=0.0;Box = make_shared<gpubox>();};
         //!construct with a given set of points
         cellListGPU(vector<Dscalar> &points);
         //! constructor with points, a box, and a size for the underlying grid
@@ -78,6 +80,14 @@ class cellListGPU
         void computeGPU(GPUArray<Dscalar2> &points);
         //! compute the cell list of the gpuarry passed to it. GPU function
         void compute(GPUArray<Dscalar2> &points);
+        //!Update the cell list on the CPU, only looking at the particles that may have changed bins since the last update
+        void updateCPU(const Dscalar2 *points);
+        //!Every particle has moved by at most this much since the last call (needed by updateCPU to know which particles to look at)
+        void addDisplacement(Dscalar maxDisplacement){displacementBound += maxDisplacement;};
+        //!Particle i has been moved by an unknown amount, so the next updateCPU looks at it
+        void particleMoved(int i);
+        //!Forget which bin each particle was put in, so that the next updateCPU rebuilds the list (cheaper than moving them one by one when most particles have been re-indexed or moved)
+        void forgetParticleBins(){binsTracked = false;};
 
         //!A debugging function to report where a point is
         void repP(int i)
@@ -118,6 +128,22 @@ class cellListGPU
         int Nmax;
         //!The Box used to compute periodic distances
         BoxPtr Box;
+        //!Are particleBin and particleSlot consistent with the current cell list?
+        bool binsTracked;
+        //!The bin each particle was last put in by updateCPU
+        vector<int> particleBin;
+        //!The position of each particle within its bin
+        vector<int> particleSlot;
+        //!The sum of the maximum displacements reported since the list was last rebuilt
+        Dscalar displacementBound;
+        //!The value of displacementBound at which each particle could have left its bin
+        vector<Dscalar> particleExpiry;
+        //!A min-heap of (expiry, particle) pairs; entries whose expiry no longer matches particleExpiry are stale
+        priority_queue<pair<Dscalar,int>, vector<pair<Dscalar,int> >, greater<pair<Dscalar,int> > > expiryQueue;
+        //!How far is the point from the boundary of its bin?
+        Dscalar binMargin(const Dscalar2 &point, int bin);
+        //!Give particle nn a new expiry, valid from the current displacementBound
+        void scheduleParticle(const Dscalar2 &point, int nn);
     };
 
 #endif
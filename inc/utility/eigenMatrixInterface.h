@@ -4,6 +4,8 @@
 #include "std_include.h"
 #include <Eigen/Core>
 #include <Eigen/Eigenvalues>
+#include <Eigen/Sparse>
+#include <Eigen/SparseCholesky>
 
 /*! \file spv2d.h */
 
@@ -34,5 +36,38 @@ class EigMat
         //!return the eigenvector associated with the ith lowest eigenvalue
         void getEvec(int i, vector<Dscalar> &vec);
     };
+
+//!A symmetric sparse (CSR) matrix, e.g. a dynamical matrix, with a solver for the eigenpairs closest to a shift
+/*!
+The matrix is assembled from the (row,col,value) entries of one triangle, as produced by
+Simple2DModel::getDynMatEntries, with each entry also placed at (col,row). As with
+EigMat::placeElementSymmetric, an entry placed more than once takes its last value. Assembly is split
+over threads and its result does not depend on their number.
+
+shiftInvertSolve finds the k eigenvalues closest to a shift sigma, and their eigenvectors, by a
+Lanczos iteration (with full reorthogonalization) on (M - sigma I)^{-1}, using a sparse LDL^T
+factorization of M - sigma I. With sigma just below the bottom of the spectrum these are the k lowest
+modes, and only a few more than k Lanczos vectors are usually needed, so the soft modes of systems far
+too large for EigMat can be found.
+*/
+class EigSparseMat
+    {
+    public:
+        //!Blank constructor
+        EigSparseMat(){};
+        //!The internal sparse matrix, stored in compressed-row form
+        Eigen::SparseMatrix<double,Eigen::RowMajor> mat;
+        //!A vector of eigenvalues, in increasing order
+        vector<Dscalar> eigenvalues;
+        //!A vector of vector of eigenvectors
+        vector< vector< Dscalar> > eigenvectors;
+
+        //!Assemble the n x n symmetric matrix with M_{ij} = M_{ji} = vals[e] for every (i,j) = rcs[e]
+        void setFromEntries(int n, const vector<int2> &rcs, const vector<Dscalar> &vals, int nThreads = 1);
+        //!Find the k eigenpairs with eigenvalues closest to sigma; returns the number that converged
+        int shiftInvertSolve(int k, Dscalar sigma = -1e-4, Dscalar tolerance = 1e-10, int maxKrylov = 0);
+        //!return the eigenvector associated with the ith eigenvalue found
+        void getEvec(int i, vector<Dscalar> &vec);
+    };
 #endif
 
@@ -130,6 +130,22 @@ inline __attribute__((always_inline)) void removeGPUArrayElement(GPUArray<T> &da
     data = newData;
     };
 
+//!rebuild a GPUArray so that its i'th element is the sources[i]'th element of the old array (elements can be dropped or repeated)
+template<typename T>
+inline __attribute__((always_inline)) void gatherGPUArrayElements(GPUArray<T> &data, const vector<int> &sources)
+    {
+    int n = sources.size();
+    GPUArray<T> newData;
+    newData.resize(n);
+    {//scope for array handles
+    ArrayHandle<T> h(data,access_location::host,access_mode::read);
+    ArrayHandle<T> h1(newData,access_location::host,access_mode::overwrite);
+    for (int i = 0; i < n; ++i)
+        h1.data[i] = h.data[sources[i]];
+    };
+    data.swap(newData);
+    };
+
 //!print a Dscalar2 to screen
 inline __attribute__((always_inline)) void printDscalar2(Dscalar2 a)
     {
@@ -194,6 +210,21 @@ HOSTDEVICE void Circumcircle(const Dscalar2 &x1, const Dscalar2 &x2, const Dscal
     radius = sqrt(dx*dx+dy*dy);
     };
 
+//!How far may every point move before a point a distance gap outside the circumcircle of (origin,x1,x2) could enter it?
+/*!
+A first-order bound on how far the circumcenter can move when each vertex moves by delta is
+|dQ| <= (kappa+1) delta with kappa = 6 sqrt(2) R sqrt(|x1|^2+|x2|^2)/|x1 x x2|, so the circle stays
+empty as long as gap > 2(kappa+2) delta; a further factor of two is included for safety.
+*/
+HOSTDEVICE Dscalar circumcircleTolerance(const Dscalar2 &x1, const Dscalar2 &x2, Dscalar radius, Dscalar gap)
+    {
+    Dscalar cross = fabs(x1.x*x2.y-x1.y*x2.x);
+    Dscalar kappa = 6.0*sqrt(2.0)*radius*sqrt(x1.x*x1.x+x1.y*x1.y+x2.x*x2.x+x2.y*x2.y);
+    if (cross <= 0 || gap <= 0)
+        return 0.0;
+    return gap*cross/(4.0*(kappa+2.0*cross));
+    };
+
 //!The dot product between two vectors of length two.
 HOSTDEVICE Dscalar dot(const Dscalar2 &p1, const Dscalar2 &p2)
     {
@@ -0,0 +1,80 @@
+#ifndef GEOMETRICPREDICATES_H
+#define GEOMETRICPREDICATES_H
+
+#include "std_include.h"
+
+/*! \file geometricPredicates.h */
+/** @defgroup geometricPredicates geometricPredicates
+ * @{
+ \brief Robust orientation and in-circle tests for the CPU triangulation routines
+
+ Each predicate first evaluates its determinant in double precision along with a bound on the
+ rounding error of that evaluation (the "stage A" bounds of Shewchuk's adaptive predicates). Only if
+ the sign of the determinant cannot be certified by that bound is the determinant recomputed in
+ exact (floating-point expansion) arithmetic, so the common case costs a handful of extra flops.
+ The sign returned is exact for the double-precision values of the inputs.
+ */
+
+//!Exact sign of the orientation determinant of (a,b,c); only called when the filter fails
+int orientationExact(double ax, double ay, double bx, double by, double cx, double cy);
+//!Exact sign of the in-circle determinant of (a,b,c,d); only called when the filter fails
+int inCircleExact(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy);
+
+//!+1 if (a,b,c) are in CCW order, -1 if they are in CW order, and 0 if they are collinear
+inline int orientation(const Dscalar2 &a, const Dscalar2 &b, const Dscalar2 &c)
+    {
+    const double errBound = 3.3306690738754716e-16;//(3+16 eps) eps, with eps = 2^-53
+    double detleft = ((double)a.x-(double)c.x)*((double)b.y-(double)c.y);
+    double detright = ((double)a.y-(double)c.y)*((double)b.x-(double)c.x);
+    double det = detleft - detright;
+    double bound = errBound*(fabs(detleft)+fabs(detright));
+    if (det > bound) return 1;
+    if (-det > bound) return -1;
+    if (detleft == 0 && detright == 0) return 0;
+    return orientationExact(a.x,a.y,b.x,b.y,c.x,c.y);
+    };
+
+//!For (a,b,c) in CCW order: +1 if d is inside their circumcircle, -1 if it is outside, and 0 if the four points are cocircular
+/*!
+The sign is reversed if (a,b,c) are in CW order; see inCircumcircle for a test that does not
+depend on the orientation of the triangle.
+*/
+inline int inCircle(const Dscalar2 &a, const Dscalar2 &b, const Dscalar2 &c, const Dscalar2 &d)
+    {
+    const double errBound = 1.1102230246251577e-15;//(10+96 eps) eps, with eps = 2^-53
+    double adx = (double)a.x-(double)d.x;
+    double ady = (double)a.y-(double)d.y;
+    double bdx = (double)b.x-(double)d.x;
+    double bdy = (double)b.y-(double)d.y;
+    double cdx = (double)c.x-(double)d.x;
+    double cdy = (double)c.y-(double)d.y;
+
+    double bdxcdy = bdx*cdy;
+    double cdxbdy = cdx*bdy;
+    double alift = adx*adx+ady*ady;
+    double cdxady = cdx*ady;
+    double adxcdy = adx*cdy;
+    double blift = bdx*bdx+bdy*bdy;
+    double adxbdy = adx*bdy;
+    double bdxady = bdx*ady;
+    double clift = cdx*cdx+cdy*cdy;
+
+    double det = alift*(bdxcdy-cdxbdy) + blift*(cdxady-adxcdy) + clift*(adxbdy-bdxady);
+    double permanent = (fabs(bdxcdy)+fabs(cdxbdy))*alift
+                     + (fabs(cdxady)+fabs(adxcdy))*blift
+                     + (fabs(adxbdy)+fabs(bdxady))*clift;
+    double bound = errBound*permanent;
+    if (det > bound) return 1;
+    if (-det > bound) return -1;
+    if (permanent == 0) return 0;
+    return inCircleExact(a.x,a.y,b.x,b.y,c.x,c.y,d.x,d.y);
+    };
+
+//!+1 if d is strictly inside the circumcircle of the triangle (a,b,c), regardless of its orientation, -1 if outside, 0 if on it (or if the triangle is degenerate)
+inline int inCircumcircle(const Dscalar2 &a, const Dscalar2 &b, const Dscalar2 &c, const Dscalar2 &d)
+    {
+    return orientation(a,b,c)*inCircle(a,b,c,d);
+    };
+
+/** @} */ //end of group declaration
+#endif
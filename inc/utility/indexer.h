@@ -61,5 +61,35 @@ class Index2D
         unsigned int height;   //!< array height
     };
 
+//!Index a ragged 2D array stored in compressed-row form
+/*!
+ * The (i,j) element is the ith entry of row j, which lives at position offsets[j]+i of the flattened
+ * array. The rows need not be the same length, and padding can be left at the end of any row. An
+ * Index2D of width w is equivalent to offsets[j] = j*w.
+ */
+class IndexCSR
+    {
+    public:
+        HOSTDEVICE IndexCSR(const int *o = NULL, unsigned int h = 0) : offsets(o), height(h) {}
+
+        HOSTDEVICE unsigned int operator()(unsigned int i, unsigned int j) const
+            {
+            return offsets[j]+i;
+            }
+        //!Return the number of elements that the indexer can index (including padding)
+        HOSTDEVICE unsigned int getNumElements() const
+            {
+            return height == 0 ? 0 : offsets[height];
+            }
+        //!Return the number of elements reserved for row j
+        HOSTDEVICE unsigned int getRowCapacity(unsigned int j) const
+            {
+            return offsets[j+1]-offsets[j];
+            }
+
+        const int *offsets;   //!< the start of each row, with offsets[height] the total size
+        unsigned int height;   //!< the number of rows
+    };
+
 #undef HOSTDEVICE
 #endif
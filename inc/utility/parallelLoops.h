@@ -0,0 +1,76 @@
+#ifndef PARALLELLOOPS_H
+#define PARALLELLOOPS_H
+
+#include "std_include.h"
+#include <thread>
+#include <exception>
+
+/*! \file parallelLoops.h */
+/** @defgroup parallelLoops parallelLoops
+ * @{
+ \brief Simple utilities for splitting CPU loops over several std::threads
+ */
+
+//!The first index of block t when [0,N) is split into nThreads contiguous, nearly-equal blocks
+inline int parallelBlockStart(int N, int nThreads, int t)
+    {
+    return (int)(((long long) N * t)/nThreads);
+    };
+
+//!Call f(begin,end,t) on each of nThreads contiguous blocks of [0,N), each on its own thread
+/*!
+The partition of [0,N) depends only on N and nThreads, so a loop body that writes only to entries
+it owns (or to per-thread buffers indexed by t) gives results that are independent of thread
+scheduling. If nThreads <= 1 the function is simply called on the current thread with the whole range.
+\param N the number of loop iterations
+\param nThreads the number of threads to use
+\param f a callable with signature f(int begin, int end, int threadIdx)
+*/
+template<typename F>
+inline void parallelBlocks(int N, int nThreads, F f)
+    {
+    if (nThreads > N) nThreads = N;
+    if (nThreads <= 1)
+        {
+        f(0,N,0);
+        return;
+        };
+    //an exception thrown by a block is caught on its own thread and rethrown by the caller after every block has finished
+    vector<std::exception_ptr> errors(nThreads);
+    auto block = [&f,&errors,N,nThreads](int t)
+        {
+        try
+            {
+            f(parallelBlockStart(N,nThreads,t),parallelBlockStart(N,nThreads,t+1),t);
+            }
+        catch (...)
+            {
+            errors[t] = std::current_exception();
+            };
+        };
+    vector<std::thread> workers;
+    workers.reserve(nThreads-1);
+    for (int t = 1; t < nThreads; ++t)
+        workers.push_back(std::thread(block,t));
+    //the calling thread takes care of the first block
+    block(0);
+    for (int t = 0; t < workers.size(); ++t)
+        workers[t].join();
+    for (int t = 0; t < nThreads; ++t)
+        if (errors[t])
+            std::rethrow_exception(errors[t]);
+    };
+
+//!Call f(i) for every i in [0,N), split over nThreads threads via parallelBlocks
+template<typename F>
+inline void parallelFor(int N, int nThreads, F f)
+    {
+    parallelBlocks(N,nThreads,[&f](int begin, int end, int t)
+        {
+        for (int i = begin; i < end; ++i)
+            f(i);
+        });
+    };
+
+/** @} */ //end of group declaration
+#endif
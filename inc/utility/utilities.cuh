@@ -42,6 +42,15 @@ bool gpu_parallel_reduction(
                     int helperIdx,
                     int N);
 
+//!The two-step parallel reduction, accumulating in a precision chosen at runtime
+bool gpu_parallel_reduction(
+                    Dscalar *input,
+                    Daccum *intermediate,
+                    Daccum *output,
+                    int helperIdx,
+                    int N,
+                    accumulator_precision::Enum precision);
+
 //! (Dscalar2) ans = (Dscalar2) vec1 * vec2
 bool gpu_dot_Dscalar_Dscalar2_vectors(Dscalar *d_vec1,
                               Dscalar2 *d_vec2,
@@ -0,0 +1,220 @@
+#ifndef VECTORFIELD_H
+#define VECTORFIELD_H
+
+#include "std_include.h"
+#include "batchedFunctions.h"
+
+/*! \file vectorField.h */
+//!A read-only, zero-copy view of an array of Dscalar2s as a flat array of its 2N components
+/*!
+Most of the CPU work of the equations of motion and minimizers is a component-wise update of one
+vector field by others (x += a*y, and so on) or a reduction over all components (dot products, the
+largest force). Written in terms of Dscalar2s those loops handle the x and y parts with separate
+statements and the compiler has to work out that the interleaved layout is contiguous; written over
+the components (x0,y0,x1,y1,...) they are single, stride-one loops that vectorize directly. The
+storage itself stays interleaved (it is what the CUDA kernels and the rest of the code read); a
+constVectorField2D wraps the host pointer of an existing Dscalar2 array (e.g. from an ArrayHandle) so
+the reductions can run over it without copying or reordering, and vectorField2D adds the updates for
+data that may be written. Reductions keep BATCHWIDTH partial results, combined in a fixed order, so
+their values are deterministic, and sums are accumulated as Daccums unless the caller asks for the
+storage precision (see accumulator_precision).
+*/
+class constVectorField2D
+    {
+    public:
+        //!View the n Dscalar2s starting at d
+        constVectorField2D(const Dscalar2 *d, int n) : components(reinterpret_cast<const Dscalar *>(d)), N(n) {};
+
+        //!The number of vectors in the field
+        int getNumberOfVectors() const {return N;};
+        //!The number of scalar components (2N)
+        int getNumberOfComponents() const {return 2*N;};
+        //!The ith vector
+        Dscalar2 operator[](int i) const {return make_Dscalar2(components[2*i],components[2*i+1]);};
+
+        //!The sum over all components of this*x, accumulated as Daccums
+        Daccum dot(const constVectorField2D &x) const {return dotAs<Daccum>(x);};
+        //!The sum over all components of this*x, accumulated in the given precision
+        Daccum dot(const constVectorField2D &x, accumulator_precision::Enum precision) const
+            {
+            if (precision == accumulator_precision::storage)
+                return dotAs<Dscalar>(x);
+            return dotAs<Daccum>(x);
+            };
+        //!The largest squared norm of any vector in the field, computed as Daccums
+        Daccum maxNormSquared() const {return maxNormSquaredAs<Daccum>();};
+        //!The largest squared norm of any vector in the field, computed in the given precision
+        Daccum maxNormSquared(accumulator_precision::Enum precision) const
+            {
+            if (precision == accumulator_precision::storage)
+                return maxNormSquaredAs<Dscalar>();
+            return maxNormSquaredAs<Daccum>();
+            };
+        //!The sum over all components of this*x, accumulated as Accumulators
+        template<typename Accumulator>
+        Daccum dotAs(const constVectorField2D &x) const
+            {
+            Accumulator partial[BATCHWIDTH];
+            for (int l = 0; l < BATCHWIDTH; ++l)
+                partial[l] = 0.0;
+            int n = 2*N;
+            int full = n - n%BATCHWIDTH;
+            for (int c = 0; c < full; c += BATCHWIDTH)
+                {
+                BATCHLOOP
+                for (int l = 0; l < BATCHWIDTH; ++l)
+                    partial[l] += (Accumulator)components[c+l]*x.components[c+l];
+                };
+            for (int c = full; c < n; ++c)
+                partial[c-full] += (Accumulator)components[c]*x.components[c];
+            Accumulator sum = 0.0;
+            for (int l = 0; l < BATCHWIDTH; ++l)
+                sum += partial[l];
+            return sum;
+            };
+        //!The largest squared norm of any vector in the field, computed as Accumulators
+        template<typename Accumulator>
+        Daccum maxNormSquaredAs() const
+            {
+            Accumulator partial[BATCHWIDTH];
+            for (int l = 0; l < BATCHWIDTH; ++l)
+                partial[l] = 0.0;
+            int full = N - N%BATCHWIDTH;
+            for (int i = 0; i < full; i += BATCHWIDTH)
+                {
+                BATCHLOOP
+                for (int l = 0; l < BATCHWIDTH; ++l)
+                    {
+                    Accumulator fx = components[2*(i+l)];
+                    Accumulator fy = components[2*(i+l)+1];
+                    Accumulator norm2 = fx*fx+fy*fy;
+                    partial[l] = norm2 > partial[l] ? norm2 : partial[l];
+                    };
+                };
+            Accumulator result = 0.0;
+            for (int i = full; i < N; ++i)
+                {
+                Accumulator fx = components[2*i];
+                Accumulator fy = components[2*i+1];
+                Accumulator norm2 = fx*fx+fy*fy;
+                if (norm2 > result) result = norm2;
+                };
+            for (int l = 0; l < BATCHWIDTH; ++l)
+                if (partial[l] > result) result = partial[l];
+            return result;
+            };
+        //!The largest absolute value of any component
+        Dscalar maxAbsComponent() const
+            {
+            Dscalar partial[BATCHWIDTH];
+            for (int l = 0; l < BATCHWIDTH; ++l)
+                partial[l] = 0.0;
+            int n = 2*N;
+            int full = n - n%BATCHWIDTH;
+            for (int c = 0; c < full; c += BATCHWIDTH)
+                {
+                BATCHLOOP
+                for (int l = 0; l < BATCHWIDTH; ++l)
+                    {
+                    Dscalar a = fabs(components[c+l]);
+                    partial[l] = a > partial[l] ? a : partial[l];
+                    };
+                };
+            Dscalar result = 0.0;
+            for (int c = full; c < n; ++c)
+                if (fabs(components[c]) > result) result = fabs(components[c]);
+            for (int l = 0; l < BATCHWIDTH; ++l)
+                if (partial[l] > result) result = partial[l];
+            return result;
+            };
+
+        //!The first component
+        const Dscalar *components;
+        //!The number of vectors
+        int N;
+    };
+
+//!A zero-copy view of an array of Dscalar2s as a flat array of its 2N components, with component-wise updates
+/*!
+See constVectorField2D; the other fields of an update are taken as read-only views, so a
+vectorField2D can be combined with either kind.
+*/
+class vectorField2D
+    {
+    public:
+        //!View the n Dscalar2s starting at d
+        vectorField2D(Dscalar2 *d, int n) : components(reinterpret_cast<Dscalar *>(d)), N(n) {};
+        //!A read-only view of the same data
+        operator constVectorField2D() const {return constVectorField2D(reinterpret_cast<const Dscalar2 *>(components),N);};
+
+        //!The number of vectors in the field
+        int getNumberOfVectors() const {return N;};
+        //!The number of scalar components (2N)
+        int getNumberOfComponents() const {return 2*N;};
+        //!The ith vector
+        Dscalar2 operator[](int i) const {return make_Dscalar2(components[2*i],components[2*i+1]);};
+
+        //!Set every component to zero
+        void zero()
+            {
+            int n = 2*N;
+            for (int c = 0; c < n; ++c)
+                components[c] = 0.0;
+            };
+        //!this += a*x
+        void addScaled(Dscalar a, const constVectorField2D &x)
+            {
+            int n = 2*N;
+            Dscalar * __restrict__ out = components;
+            const Dscalar * __restrict__ xc = x.components;
+            for (int c = 0; c < n; ++c)
+                out[c] += a*xc[c];
+            };
+        //!this = a*x + b*y
+        void setLinearCombination(Dscalar a, const constVectorField2D &x, Dscalar b, const constVectorField2D &y)
+            {
+            int n = 2*N;
+            Dscalar * __restrict__ out = components;
+            const Dscalar * __restrict__ xc = x.components;
+            const Dscalar * __restrict__ yc = y.components;
+            for (int c = 0; c < n; ++c)
+                out[c] = a*xc[c]+b*yc[c];
+            };
+        //!this = a*(x + b*y)
+        void setScaledSum(Dscalar a, const constVectorField2D &x, Dscalar b, const constVectorField2D &y)
+            {
+            int n = 2*N;
+            Dscalar * __restrict__ out = components;
+            const Dscalar * __restrict__ xc = x.components;
+            const Dscalar * __restrict__ yc = y.components;
+            for (int c = 0; c < n; ++c)
+                out[c] = a*(xc[c]+b*yc[c]);
+            };
+        //!this = a*this + b*x
+        void scaleAndAddScaled(Dscalar a, Dscalar b, const constVectorField2D &x)
+            {
+            int n = 2*N;
+            Dscalar * __restrict__ out = components;
+            const Dscalar * __restrict__ xc = x.components;
+            for (int c = 0; c < n; ++c)
+                out[c] = a*out[c]+b*xc[c];
+            };
+
+        //!The sum over all components of this*x, accumulated as Daccums
+        Daccum dot(const constVectorField2D &x) const {return constVectorField2D(*this).dot(x);};
+        //!The sum over all components of this*x, accumulated in the given precision
+        Daccum dot(const constVectorField2D &x, accumulator_precision::Enum precision) const {return constVectorField2D(*this).dot(x,precision);};
+        //!The largest squared norm of any vector in the field, computed as Daccums
+        Daccum maxNormSquared() const {return constVectorField2D(*this).maxNormSquared();};
+        //!The largest squared norm of any vector in the field, computed in the given precision
+        Daccum maxNormSquared(accumulator_precision::Enum precision) const {return constVectorField2D(*this).maxNormSquared(precision);};
+        //!The largest absolute value of any component
+        Dscalar maxAbsComponent() const {return constVectorField2D(*this).maxAbsComponent();};
+
+        //!The first component
+        Dscalar *components;
+        //!The number of vectors
+        int N;
+    };
+
+#endif
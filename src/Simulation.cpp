@@ -101,6 +101,17 @@ void Simulation::setCPUOperation(bool setcpu)
         };
     };
 
+/*!
+\param n the number of CPU threads the configuration may use
+\post the cell configuration will split its CPU force and geometry routines over n threads. The
+results do not depend on n.
+*/
+void Simulation::setNumThreads(int n)
+    {
+    auto cellConf = cellConfiguration.lock();
+    cellConf->setNumThreads(n);
+    };
+
 /*!
 \pre the updaters already know if the GPU will be used
 \post the updaters are set to be reproducible if the boolean is true, otherwise the RNG is initialized
@@ -114,6 +125,24 @@ void Simulation::setReproducible(bool reproducible)
         };
     };
 
+/*!
+\param precision accumulator_precision::extended (the default of models and updaters) accumulates
+energies and the reductions of minimizers in Daccum precision; accumulator_precision::storage
+accumulates them in Dscalar precision, which in a float build is cheaper but less accurate
+\pre the updaters have already been added
+\post the cell configuration and every updater accumulate in the given precision
+*/
+void Simulation::setAccumulatorPrecision(accumulator_precision::Enum precision)
+    {
+    auto cellConf = cellConfiguration.lock();
+    cellConf->setAccumulatorPrecision(precision);
+    for (int u = 0; u < updaters.size(); ++u)
+        {
+        auto upd = updaters[u].lock();
+        upd->setAccumulatorPrecision(precision);
+        };
+    };
+
 /*!
 Calls the configuration to displace the degrees of freedom
 */
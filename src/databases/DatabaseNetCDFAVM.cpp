@@ -101,6 +101,7 @@ void AVMDatabaseNetCDF::ReadState(STATE t, int rec, bool geometry)
         h_p.data[idx].x=px;
         h_p.data[idx].y=py;
         };
+    t->invalidateT1WatchList();
     
     //set the vertex neighbors and vertex-cell neighbors
     ArrayHandle<int> h_vn(t->vertexNeighbors,access_location::host,access_mode::read);
@@ -1,4 +1,5 @@
 #include "DelaunayCGAL.h"
+#include "parallelLoops.h"
 /*! \file DelaunayCGAL.cpp */
 
 /*!
@@ -61,7 +62,282 @@ void DelaunayCGAL::PeriodicTriangulation(vector<pair<Point,int> > &V, Dscalar bx
     if (bxy == 0 && byx == 0 && bxx == byy)
         PeriodicTriangulationSquareDomain(V,bxx,byy);
     else
-        PeriodicTriangulationNineSheeted(V,bxx,bxy,byx,byy);
+        PeriodicTriangulationHalo(V,bxx,bxy,byx,byy);
+    };
+
+/*!
+Triangulate one vertical strip of the unit cell (in virtual coordinates), together with every
+periodic image of every point that lies within hx (in the x direction) or hy (in the y direction) of
+it, and store the neighbors of the points that belong to the strip. The neighbors of a point are
+correct if the circumcircle of every triangle containing it lies inside the region covered by the
+points, which is checked explicitly.
+\param virtualCoords the positions of all points in virtual coordinates
+\param stripMembers stripMembers[s] lists the points whose virtual x coordinate is in [s/nStrips,(s+1)/nStrips)
+\param strip the strip to triangulate
+\param hx the width of the ghost region in the virtual x direction
+\param hy the width of the ghost region in the virtual y direction
+\param neighs on output, neighs[k] is the CCW-ordered list of neighbors of stripMembers[strip][k]
+\return false if any circumcircle around a point in the strip is not covered by the ghost region
+*/
+bool DelaunayCGAL::TriangulateStrip(const vector<Dscalar2> &virtualCoords, const vector<vector<int> > &stripMembers,
+                                    int strip, Dscalar hx, Dscalar hy, Dscalar bxx, Dscalar bxy, Dscalar byx, Dscalar byy,
+                                    vector<vector<int> > &neighs)
+    {
+    int nStrips = stripMembers.size();
+    const vector<int> &primaries = stripMembers[strip];
+    int nPrimaries = primaries.size();
+    Dscalar xmin = (Dscalar)strip/nStrips - hx;
+    Dscalar xmax = (Dscalar)(strip+1)/nStrips + hx;
+    Dscalar ymin = -hy;
+    Dscalar ymax = 1.0+hy;
+    Dscalar area = fabs(bxx*byy-bxy*byx);
+    Dscalar prefactor = 1.0/(bxx*byy-bxy*byx);
+    Dscalar xi11 = prefactor * byy;
+    Dscalar xi22 = prefactor * bxx;
+    Dscalar xi12 = -prefactor * bxy;
+    Dscalar xi21 = -prefactor * byx;
+    Dscalar widthToVirtualX = sqrt(bxy*bxy+byy*byy)/area;
+    Dscalar widthToVirtualY = sqrt(bxx*bxx+byx*byx)/area;
+
+    //the primary points come first; ghosts are indexed by nPrimaries + (position in ghostOrigin)
+    vector<pair<LPoint,int> > allPoints;
+    vector<int> ghostOrigin;
+    allPoints.reserve(nPrimaries);
+    for (int ii = 0; ii < nPrimaries; ++ii)
+        {
+        Dscalar2 point = virtualCoords[primaries[ii]];
+        allPoints.push_back(make_pair(LPoint(bxx*point.x + bxy*point.y,byx*point.x + byy*point.y),ii));
+        };
+    Dscalar stripPad = 1e-6;
+    for (int ss = 0; ss < nStrips; ++ss)
+        for (int sx = -1; sx <= 1; ++sx)
+            {
+            //skip strips whose images cannot reach the region
+            if ((Dscalar)(ss+1)/nStrips + sx + stripPad < xmin || (Dscalar)ss/nStrips + sx - stripPad > xmax)
+                continue;
+            for (int pp = 0; pp < stripMembers[ss].size(); ++pp)
+                {
+                int idx = stripMembers[ss][pp];
+                for (int sy = -1; sy <= 1; ++sy)
+                    {
+                    if (ss == strip && sx == 0 && sy == 0) continue;
+                    Dscalar2 point = make_Dscalar2(virtualCoords[idx].x+sx,virtualCoords[idx].y+sy);
+                    if (point.x < xmin || point.x > xmax || point.y < ymin || point.y > ymax)
+                        continue;
+                    allPoints.push_back(make_pair(LPoint(bxx*point.x + bxy*point.y,byx*point.x + byy*point.y),
+                                                  nPrimaries+ghostOrigin.size()));
+                    ghostOrigin.push_back(idx);
+                    };
+                };
+            };
+
+    Delaunay T;
+    T.insert(allPoints.begin(),allPoints.end());
+
+    neighs.resize(nPrimaries);
+    for (int ii = 0; ii < nPrimaries; ++ii)
+        {
+        neighs[ii].clear();
+        int li = -1;
+        LPoint p=allPoints[ii].first;
+        Delaunay::Face_handle face = T.locate(p);
+        if (face->vertex(0)->info()==ii)
+            li = 0;
+        else if (face->vertex(1)->info()==ii)
+            li = 1;
+        else if (face->vertex(2)->info()==ii)
+            li = 2;
+        if (li < 0)
+            return false;
+        Delaunay::Vertex_handle vh = face->vertex(li);
+
+        //every circumcircle around a primary point must be covered by the ghost region
+        Delaunay::Face_circulator fc = T.incident_faces(vh), fdone(fc);
+        do
+            {
+            Delaunay::Face_handle fh = fc;
+            if (T.is_infinite(fh))
+                return false;
+            LPoint center = T.circumcenter(fh);
+            Dscalar radius = sqrt(CGAL::squared_distance(center,fh->vertex(0)->point()));
+            Dscalar cx = xi11*center.x() + xi12*center.y();
+            Dscalar cy = xi21*center.x() + xi22*center.y();
+            Dscalar rx = radius*widthToVirtualX;
+            Dscalar ry = radius*widthToVirtualY;
+            if (cx-rx < xmin || cx+rx > xmax || cy-ry < ymin || cy+ry > ymax)
+                return false;
+            } while (++fc != fdone);
+
+        Delaunay::Vertex_circulator vc(vh,face);
+        int base = vc->info();
+        neighs[ii].push_back(base < nPrimaries ? primaries[base] : ghostOrigin[base-nPrimaries]);
+        ++vc;
+        while(vc->info() != base)
+            {
+            int idx = vc->info();
+            neighs[ii].push_back(idx < nPrimaries ? primaries[idx] : ghostOrigin[idx-nPrimaries]);
+            ++vc;
+            };
+        };
+    return true;
+    };
+
+/*!
+Transform the points to virtual coordinates and sort them into nStrips vertical strips
+\param V A complete set of the points to be triangulated along with their indices
+\param virtualCoords on output, the virtual coordinates of the points
+\param stripMembers on output, the points belonging to each strip
+*/
+void DelaunayCGAL::getVirtualStrips(vector<pair<Point,int> > &V, Dscalar bxx, Dscalar bxy,Dscalar byx, Dscalar byy,
+                                    int nStrips, vector<Dscalar2> &virtualCoords, vector<vector<int> > &stripMembers)
+    {
+    int vnum = V.size();
+    Dscalar prefactor = 1.0/(bxx*byy-bxy*byx);
+    Dscalar xi11 = prefactor * byy;
+    Dscalar xi22 = prefactor * bxx;
+    Dscalar xi12 = -prefactor * bxy;
+    Dscalar xi21 = -prefactor * byx;
+    virtualCoords.resize(vnum);
+    stripMembers.clear();
+    stripMembers.resize(nStrips);
+    for (int ii = 0; ii < vnum; ++ii)
+        {
+        virtualCoords[ii].x = xi11*V[ii].first.x() + xi12*V[ii].first.y();
+        virtualCoords[ii].y = xi21*V[ii].first.x() + xi22*V[ii].first.y();
+        int strip = (int)floor(virtualCoords[ii].x*nStrips);
+        if (strip < 0) strip = 0;
+        if (strip >= nStrips) strip = nStrips-1;
+        stripMembers[strip].push_back(ii);
+        };
+    };
+
+/*!
+Perform a periodic triangulation in a general domain by adding to the N points in the primary unit
+cell only those periodic images that lie within a strip of width haloWidth around it, and computing
+a non-periodic triangulation of the result. The neighbors of the primary points are correct if the
+circumcircle of every triangle containing a primary point lies inside the region covered by the
+points; if this check (or the check that the total number of neighbors is 6N) fails, the strip width
+is doubled and the triangulation is repeated. If the strip would have to be wider than the domain
+itself, the nine-sheeted routine is called instead.
+After the routine is called, the class member allneighs will store a list of particle neighbors, each sorted in CW order
+
+\param V A complete set of the points to be triangulated along with their indices
+\param haloWidth the initial width of the strip; if negative, three times the typical interparticle spacing is used
+The domain is stored as
+M= (bxx  bxy
+    byx  byy),
+and a vector, v, whose components are between zero and one has real position
+M*v
+*/
+void DelaunayCGAL::PeriodicTriangulationHalo(vector<pair<Point,int> > &V, Dscalar bxx, Dscalar bxy,Dscalar byx, Dscalar byy, Dscalar haloWidth)
+    {
+    int vnum = V.size();
+    Dscalar area = fabs(bxx*byy-bxy*byx);
+    if (haloWidth <= 0)
+        haloWidth = 3.0*sqrt(area/max(vnum,1));
+    //converting real distances to the faces of the unit cell into virtual coordinates
+    Dscalar widthToVirtualX = sqrt(bxy*bxy+byy*byy)/area;
+    Dscalar widthToVirtualY = sqrt(bxx*bxx+byx*byx)/area;
+
+    vector<Dscalar2> virtualCoords;
+    vector<vector<int> > stripMembers;
+    getVirtualStrips(V,bxx,bxy,byx,byy,1,virtualCoords,stripMembers);
+
+    vector<vector<int> > neighs;
+    bool success = false;
+    while (!success)
+        {
+        Dscalar hx = haloWidth*widthToVirtualX;
+        Dscalar hy = haloWidth*widthToVirtualY;
+        if (hx >= 1.0 || hy >= 1.0)
+            {
+            PeriodicTriangulationNineSheeted(V,bxx,bxy,byx,byy);
+            return;
+            };
+        success = TriangulateStrip(virtualCoords,stripMembers,0,hx,hy,bxx,bxy,byx,byy,neighs);
+        int totaln = 0;
+        for (int ii = 0; ii < neighs.size(); ++ii)
+            totaln += neighs[ii].size();
+        if (totaln != 6*vnum)
+            success = false;
+        if (!success)
+            haloWidth *= 2.0;
+        };
+
+    allneighs.clear();
+    allneighs.resize(vnum);
+    for (int ii = 0; ii < vnum; ++ii)
+        allneighs[stripMembers[0][ii]].swap(neighs[ii]);
+    };
+
+/*!
+Perform a periodic triangulation by splitting the domain into vertical strips (in virtual
+coordinates), one per thread. Each strip, plus a ghost layer of periodic images, is triangulated
+independently by TriangulateStrip, and the neighbor lists of the points owned by each strip are
+stitched together. A strip whose ghost layer does not cover every circumcircle of its points doubles
+its ghost width and tries again; if the ghost layer would be wider than the domain, or if the
+stitched lists fail the total neighbor = 6N check, the serial thin-halo routine is called instead.
+After the routine is called, the class member allneighs will store a list of particle neighbors, each sorted in CW order
+
+\param V A complete set of the points to be triangulated along with their indices
+\param nThreads the number of threads (and strips) to use
+\param ghostWidth the initial width of the ghost layer; if negative, three times the typical interparticle spacing is used
+*/
+void DelaunayCGAL::PeriodicTriangulationParallel(vector<pair<Point,int> > &V, Dscalar bxx, Dscalar bxy,Dscalar byx, Dscalar byy,
+                                                 int nThreads, Dscalar ghostWidth)
+    {
+    int vnum = V.size();
+    //strips much thinner than a few hundred points are dominated by their ghost layers
+    int nStrips = min(nThreads,vnum/1000);
+    if (nStrips <= 1)
+        {
+        PeriodicTriangulationHalo(V,bxx,bxy,byx,byy,ghostWidth);
+        return;
+        };
+    Dscalar area = fabs(bxx*byy-bxy*byx);
+    if (ghostWidth <= 0)
+        ghostWidth = 3.0*sqrt(area/vnum);
+    Dscalar widthToVirtualX = sqrt(bxy*bxy+byy*byy)/area;
+    Dscalar widthToVirtualY = sqrt(bxx*bxx+byx*byx)/area;
+
+    vector<Dscalar2> virtualCoords;
+    vector<vector<int> > stripMembers;
+    getVirtualStrips(V,bxx,bxy,byx,byy,nStrips,virtualCoords,stripMembers);
+
+    allneighs.clear();
+    allneighs.resize(vnum);
+    vector<int> stripSuccess(nStrips,0);
+    parallelFor(nStrips,nThreads,[&](int strip)
+        {
+        vector<vector<int> > neighs;
+        Dscalar width = ghostWidth;
+        Dscalar hx = width*widthToVirtualX;
+        Dscalar hy = width*widthToVirtualY;
+        while (hx < 1.0 && hy < 1.0)
+            {
+            if (TriangulateStrip(virtualCoords,stripMembers,strip,hx,hy,bxx,bxy,byx,byy,neighs))
+                {
+                stripSuccess[strip] = 1;
+                break;
+                };
+            width *= 2.0;
+            hx = width*widthToVirtualX;
+            hy = width*widthToVirtualY;
+            };
+        if (stripSuccess[strip])
+            for (int ii = 0; ii < stripMembers[strip].size(); ++ii)
+                allneighs[stripMembers[strip][ii]].swap(neighs[ii]);
+        });
+
+    int totaln = 0;
+    bool success = true;
+    for (int ss = 0; ss < nStrips; ++ss)
+        if (!stripSuccess[ss])
+            success = false;
+    for (int ii = 0; ii < vnum; ++ii)
+        totaln += allneighs[ii].size();
+    if (!success || totaln != 6*vnum)
+        PeriodicTriangulationHalo(V,bxx,bxy,byx,byy,ghostWidth);
     };
 
 /*!
@@ -0,0 +1,409 @@
+#include "DelaunayFlip.h"
+#include "geometricPredicates.h"
+#include "functions.h"
+#include <unordered_map>
+/*! \file DelaunayFlip.cpp */
+
+//!access the components of an int3 by index
+inline int & int3Component(int3 &a, int j)
+    {
+    if (j == 0) return a.x;
+    if (j == 1) return a.y;
+    return a.z;
+    };
+
+/*!
+\param N the number of points
+\param neighborNum the number of neighbors of each point
+\param neighbors the CCW-ordered neighbors of each point, accessed via nIdx
+\param nIdx the indexer for the neighbors array
+\return false if the neighbor lists are not consistent with a periodic triangulation with 2N triangles
+(e.g., if the system is so small that two triangles share the same pair of vertex indices)
+\post the triangles, triangleNeighbors, and vertexTriangle structures are built
+*/
+bool DelaunayFlip::initialize(int N, const int *neighborNum, const int *neighbors, const IndexCSR &nIdx)
+    {
+    Np = N;
+    triangles.clear();
+    triangles.reserve(2*N);
+    vertexTriangle.assign(N,-1);
+
+    //every triangle is stored once, by its smallest-indexed vertex
+    for (int ii = 0; ii < N; ++ii)
+        {
+        int nn = neighborNum[ii];
+        for (int jj = 0; jj < nn; ++jj)
+            {
+            int n1 = neighbors[nIdx(jj,ii)];
+            int n2 = neighbors[nIdx((jj+1)%nn,ii)];
+            if (ii < n1 && ii < n2)
+                triangles.push_back(make_int3(ii,n1,n2));
+            };
+        };
+    if (triangles.size() != 2*N)
+        return false;
+
+    //map each directed edge to the triangle (and local vertex) it is opposite to
+    int nT = triangles.size();
+    unordered_map<long long,int> edgeMap;
+    edgeMap.reserve(3*nT);
+    for (int tt = 0; tt < nT; ++tt)
+        {
+        for (int jj = 0; jj < 3; ++jj)
+            {
+            long long v1 = int3Component(triangles[tt],(jj+1)%3);
+            long long v2 = int3Component(triangles[tt],(jj+2)%3);
+            long long key = v1*N+v2;
+            if (edgeMap.find(key) != edgeMap.end())
+                return false;
+            edgeMap[key] = 3*tt+jj;
+            vertexTriangle[int3Component(triangles[tt],jj)] = tt;
+            };
+        };
+
+    //the neighbor across a directed edge (v1,v2) is the triangle containing (v2,v1)
+    triangleNeighbors.resize(nT);
+    for (int tt = 0; tt < nT; ++tt)
+        {
+        for (int jj = 0; jj < 3; ++jj)
+            {
+            long long v1 = int3Component(triangles[tt],(jj+1)%3);
+            long long v2 = int3Component(triangles[tt],(jj+2)%3);
+            unordered_map<long long,int>::iterator twin = edgeMap.find(v2*N+v1);
+            if (twin == edgeMap.end())
+                return false;
+            int3Component(triangleNeighbors[tt],jj) = twin->second / 3;
+            };
+        };
+    for (int ii = 0; ii < N; ++ii)
+        if (vertexTriangle[ii] < 0)
+            return false;
+    certified = false;
+    return true;
+    };
+
+/*!
+\param points the current positions of the points
+\param a,b,c the vertices of a triangle, in CCW order
+\param d a fourth point
+All positions are taken relative to a, using the minimum image convention, and the test is exact
+for those relative positions (see geometricPredicates.h), so cocircular points are never flipped.
+*/
+bool DelaunayFlip::inCircumcircle(const Dscalar2 *points, int a, int b, int c, int d)
+    {
+    Dscalar2 pb,pc,pd;
+    Box->minDist(points[b],points[a],pb);
+    Box->minDist(points[c],points[a],pc);
+    Box->minDist(points[d],points[a],pd);
+    return (inCircle(make_Dscalar2(0.0,0.0),pb,pc,pd) > 0);
+    };
+
+/*!
+\param t a triangle index
+\param oldT the index of the neighboring triangle to replace
+\param newT the index of the new neighbor
+*/
+void DelaunayFlip::replaceNeighbor(int t, int oldT, int newT)
+    {
+    if (triangleNeighbors[t].x == oldT)
+        triangleNeighbors[t].x = newT;
+    else if (triangleNeighbors[t].y == oldT)
+        triangleNeighbors[t].y = newT;
+    else if (triangleNeighbors[t].z == oldT)
+        triangleNeighbors[t].z = newT;
+    };
+
+/*!
+Flip the edge (b,c) shared by the CCW triangles t = (a,b,c) and u = (d,c,b), replacing them by
+t = (a,b,d) and u = (a,d,c).
+\param t the triangle index
+\param j the local index (in t) of the vertex opposite the edge to flip
+*/
+void DelaunayFlip::flipEdge(int t, int j)
+    {
+    int a = int3Component(triangles[t],j);
+    int b = int3Component(triangles[t],(j+1)%3);
+    int c = int3Component(triangles[t],(j+2)%3);
+    int nab = int3Component(triangleNeighbors[t],(j+2)%3);
+    int nca = int3Component(triangleNeighbors[t],(j+1)%3);
+
+    int u = int3Component(triangleNeighbors[t],j);
+    int m = 0;
+    for (int mm = 0; mm < 3; ++mm)
+        {
+        int v = int3Component(triangles[u],mm);
+        if (int3Component(triangleNeighbors[u],mm) == t && v != b && v != c)
+            m = mm;
+        };
+    int d = int3Component(triangles[u],m);
+    int nbd = int3Component(triangleNeighbors[u],(m+1)%3);
+    int ndc = int3Component(triangleNeighbors[u],(m+2)%3);
+
+    triangles[t] = make_int3(a,b,d);
+    triangleNeighbors[t] = make_int3(nbd,u,nab);
+    triangles[u] = make_int3(a,d,c);
+    triangleNeighbors[u] = make_int3(ndc,nca,t);
+    replaceNeighbor(nbd,u,t);
+    replaceNeighbor(nca,t,u);
+
+    vertexTriangle[a] = t;
+    vertexTriangle[b] = t;
+    vertexTriangle[d] = t;
+    vertexTriangle[c] = u;
+    flipsPerformed += 1;
+    };
+
+/*!
+\param points the current positions of the points
+\param t a triangle index
+*/
+bool DelaunayFlip::positivelyOriented(const Dscalar2 *points, int t)
+    {
+    Dscalar2 pb,pc;
+    Box->minDist(points[triangles[t].y],points[triangles[t].x],pb);
+    Box->minDist(points[triangles[t].z],points[triangles[t].x],pc);
+    return (orientation(make_Dscalar2(0.0,0.0),pb,pc) > 0);
+    };
+
+/*!
+Lawson's algorithm: any edge on the stack that fails the in-circle test is flipped, after which the
+four edges bounding the flipped quadrilateral are pushed back onto the stack.
+\param points the current positions of the points
+\param changedVertices every vertex of a flipped quadrilateral is appended
+\post the triangles changed by a flip, and their neighbors, are appended to touchedTriangles
+\return false if the flipping failed to converge or produced an inverted triangle
+*/
+bool DelaunayFlip::processEdgeStack(const Dscalar2 *points, vector<int> &changedVertices)
+    {
+    int flips = 0;
+    int maxFlips = 3*triangles.size();
+    while (!edgeStack.empty())
+        {
+        int2 edge = edgeStack.back();
+        edgeStack.pop_back();
+        int t = edge.x;
+        int j = edge.y;
+        int u = int3Component(triangleNeighbors[t],j);
+        int a = int3Component(triangles[t],j);
+        int b = int3Component(triangles[t],(j+1)%3);
+        int c = int3Component(triangles[t],(j+2)%3);
+        int d = -1;
+        for (int mm = 0; mm < 3; ++mm)
+            {
+            int v = int3Component(triangles[u],mm);
+            if (v != b && v != c)
+                d = v;
+            };
+        if (d < 0 || !inCircumcircle(points,a,b,c,d))
+            continue;
+
+        flipEdge(t,j);
+        flips += 1;
+        if (flips > maxFlips || !positivelyOriented(points,t) || !positivelyOriented(points,u))
+            return false;
+        changedVertices.push_back(a);
+        changedVertices.push_back(b);
+        changedVertices.push_back(c);
+        changedVertices.push_back(d);
+        //the flipped triangles and their neighbors (whose opposite vertices changed) need new certificates
+        touchedTriangles.push_back(t);
+        touchedTriangles.push_back(u);
+        for (int jj = 0; jj < 3; ++jj)
+            {
+            touchedTriangles.push_back(int3Component(triangleNeighbors[t],jj));
+            touchedTriangles.push_back(int3Component(triangleNeighbors[u],jj));
+            };
+
+        //t = (a,b,d) and u = (a,d,c); check the four edges of the quadrilateral
+        edgeStack.push_back(make_int2(t,0));
+        edgeStack.push_back(make_int2(t,2));
+        edgeStack.push_back(make_int2(u,0));
+        edgeStack.push_back(make_int2(u,1));
+        };
+    return true;
+    };
+
+/*!
+Every triangle is checked for inversion, every edge is put on the flip stack, and afterwards every
+triangle is given a new certificate.
+\param points the current positions of the points
+\param changedVertices on output, a sorted list of every vertex whose set of neighbors changed
+\return false if the triangulation could not be repaired by flips (because the point motion has
+inverted a triangle, or because the flipping failed to converge). In that case the class'
+data structures are no longer meaningful and initialize must be called again.
+*/
+bool DelaunayFlip::flipToDelaunay(const Dscalar2 *points, vector<int> &changedVertices)
+    {
+    changedVertices.clear();
+    touchedTriangles.clear();
+    int nT = triangles.size();
+
+    //edge flips can only fix a triangulation in which no triangle has been inverted
+    for (int tt = 0; tt < nT; ++tt)
+        if (!positivelyOriented(points,tt))
+            return false;
+
+    edgeStack.clear();
+    for (int tt = 0; tt < nT; ++tt)
+        for (int jj = 0; jj < 3; ++jj)
+            if (tt < int3Component(triangleNeighbors[tt],jj))
+                edgeStack.push_back(make_int2(tt,jj));
+
+    if (!processEdgeStack(points,changedVertices))
+        return false;
+    sort(changedVertices.begin(),changedVertices.end());
+    changedVertices.erase(unique(changedVertices.begin(),changedVertices.end()),changedVertices.end());
+    certifyAll(points);
+    return true;
+    };
+
+/*!
+The triangles whose certificates have expired (i.e., the points may have moved far enough to invert
+them or to put a point inside their circumcircles) are checked for inversion, and their edges are put
+on the flip stack. Every edge that is not locally Delaunay belongs to such a triangle, and Lawson's
+algorithm pushes every edge a flip can affect, so no other edge needs to be tested. The checked
+triangles, and the triangles changed by flips and their neighbors, are then certified again. If the
+certificates are not valid, flipToDelaunay(points,changedVertices) is called instead.
+\param points the current positions of the points
+\param changedVertices on output, a sorted list of every vertex whose set of neighbors changed
+\return as in flipToDelaunay(points,changedVertices)
+*/
+bool DelaunayFlip::updateToDelaunay(const Dscalar2 *points, vector<int> &changedVertices)
+    {
+    if (!certified)
+        return flipToDelaunay(points,changedVertices);
+    changedVertices.clear();
+    touchedTriangles.clear();
+    edgeStack.clear();
+    while (!expiryQueue.empty() && expiryQueue.top().first <= displacementBound)
+        {
+        pair<Dscalar,int> entry = expiryQueue.top();
+        expiryQueue.pop();
+        int t = entry.second;
+        if (entry.first != triangleExpiry[t])
+            continue;
+        trianglesChecked += 1;
+        if (!positivelyOriented(points,t))
+            return false;
+        touchedTriangles.push_back(t);
+        for (int jj = 0; jj < 3; ++jj)
+            edgeStack.push_back(make_int2(t,jj));
+        };
+
+    if (!processEdgeStack(points,changedVertices))
+        return false;
+    sort(changedVertices.begin(),changedVertices.end());
+    changedVertices.erase(unique(changedVertices.begin(),changedVertices.end()),changedVertices.end());
+    sort(touchedTriangles.begin(),touchedTriangles.end());
+    touchedTriangles.erase(unique(touchedTriangles.begin(),touchedTriangles.end()),touchedTriangles.end());
+    for (int tt = 0; tt < touchedTriangles.size(); ++tt)
+        certifyTriangle(points,touchedTriangles[tt]);
+
+    //every new certificate leaves a stale entry behind; drop them once they dominate the queue
+    int nT = triangles.size();
+    if (expiryQueue.size() > 4*nT)
+        {
+        vector<pair<Dscalar,int> > entries(nT);
+        for (int tt = 0; tt < nT; ++tt)
+            entries[tt] = make_pair(triangleExpiry[tt],tt);
+        expiryQueue = priority_queue<pair<Dscalar,int>, vector<pair<Dscalar,int> >, greater<pair<Dscalar,int> > >(greater<pair<Dscalar,int> >(),entries);
+        };
+    return true;
+    };
+
+/*!
+The tolerance is the smaller of two distances. The orientation determinant of t, det(u,v) with u
+and v two of its edges, changes by at most 2 delta (|u|+|v|) + 4 delta^2 when every point moves by
+at most delta, and the tolerance keeps that below half of det(u,v). For each neighbor of t the
+distance of its opposite vertex from the circumcircle of t is turned into a displacement by
+circumcircleTolerance, as for the certificates of DelaunayLoc::testCircumcircle.
+\param points the current positions of the points
+\param t a (positively oriented) triangle index
+*/
+Dscalar DelaunayFlip::triangleTolerance(const Dscalar2 *points, int t)
+    {
+    int a = triangles[t].x;
+    Dscalar2 pb,pc,pd;
+    Box->minDist(points[triangles[t].y],points[a],pb);
+    Box->minDist(points[triangles[t].z],points[a],pc);
+    Dscalar det = pb.x*pc.y-pb.y*pc.x;
+    if (det <= 0)
+        return 0.0;
+    Dscalar edges = norm(pb)+norm(pc);
+    Dscalar tolerance = 0.25*(sqrt(edges*edges+2.0*det)-edges);
+
+    Dscalar2 Q;
+    Dscalar radius;
+    Circumcircle(pb,pc,Q,radius);
+    for (int jj = 0; jj < 3; ++jj)
+        {
+        int u = int3Component(triangleNeighbors[t],jj);
+        int b = int3Component(triangles[t],(jj+1)%3);
+        int c = int3Component(triangles[t],(jj+2)%3);
+        for (int mm = 0; mm < 3; ++mm)
+            {
+            int d = int3Component(triangles[u],mm);
+            if (d == b || d == c)
+                continue;
+            Box->minDist(points[d],points[a],pd);
+            Dscalar gap = norm(pd-Q)-radius;
+            tolerance = min(tolerance,circumcircleTolerance(pb,pc,radius,gap));
+            };
+        };
+    return tolerance;
+    };
+
+/*!
+\param points the current positions of the points
+\param t a triangle index
+*/
+void DelaunayFlip::certifyTriangle(const Dscalar2 *points, int t)
+    {
+    triangleExpiry[t] = displacementBound + triangleTolerance(points,t);
+    expiryQueue.push(make_pair(triangleExpiry[t],t));
+    };
+
+/*!
+\param points the current positions of the points
+\post displacementBound is reset, and every triangle has a certificate
+*/
+void DelaunayFlip::certifyAll(const Dscalar2 *points)
+    {
+    int nT = triangles.size();
+    displacementBound = 0.0;
+    triangleExpiry.resize(nT);
+    vector<pair<Dscalar,int> > entries(nT);
+    for (int tt = 0; tt < nT; ++tt)
+        {
+        triangleExpiry[tt] = triangleTolerance(points,tt);
+        entries[tt] = make_pair(triangleExpiry[tt],tt);
+        };
+    expiryQueue = priority_queue<pair<Dscalar,int>, vector<pair<Dscalar,int> >, greater<pair<Dscalar,int> > >(greater<pair<Dscalar,int> >(),entries);
+    certified = true;
+    };
+
+/*!
+\param i the vertex in question
+\param neighbors on output, the neighbors of vertex i in CCW order
+\return false if the triangles around i do not close up properly
+*/
+bool DelaunayFlip::getNeighbors(int i, vector<int> &neighbors)
+    {
+    neighbors.clear();
+    int t0 = vertexTriangle[i];
+    int t = t0;
+    int steps = 0;
+    do
+        {
+        int k = 0;
+        if (triangles[t].y == i) k = 1;
+        if (triangles[t].z == i) k = 2;
+        //in the CCW triangle (i,p,q), the next triangle around i is the one across the edge (q,i)
+        neighbors.push_back(int3Component(triangles[t],(k+1)%3));
+        t = int3Component(triangleNeighbors[t],(k+1)%3);
+        steps += 1;
+        if (steps > 64)
+            return false;
+        } while (t != t0);
+    return true;
+    };
@@ -2,24 +2,76 @@
 
 #include "DelaunayLoc.h"
 #include "DelaunayCGAL.h"
+#include "parallelLoops.h"
+#include "geometricPredicates.h"
 
 /*! \file DelaunayLoc.cpp */
 
+/*!
+A bound on how far a point that is truly inside the circumcircle of (origin,x1,x2) can appear to be
+outside of the circle computed by Circumcircle(x1,x2,xc,radius), i.e., on the combined rounding error
+of the circumcenter, the radius, and the distance from a point in the circle to the circumcenter.
+With D = x1 x x2, m = |x1.x x2.y|+|x1.y x2.x| and n_i = |x_i|^2, each component of the circumcenter
+is a quotient whose numerator has an error of at most about 4u (n1|x2|+n2|x1|) and whose denominator
+D has an error of at most about 2u m, so that |dQ| <~ 2u (|Q| m + 2 (n1|x2|+n2|x1|))/|D| + 2u|Q|.
+Because of the 1/|D|, the bound is large for the skinny triangles whose circumcircles are
+ill-conditioned, and infinite (or NaN) for degenerate ones. The radius and the distances to the
+circumcenter add errors of a few u (|Q|+R); a further factor of two is included, and u is taken to
+be the machine epsilon (twice the unit roundoff) for safety.
+*/
+static Dscalar circumcircleError(const Dscalar2 &x1, const Dscalar2 &x2, const Dscalar2 &xc, Dscalar radius)
+    {
+    const Dscalar eps = numeric_limits<Dscalar>::epsilon();
+    Dscalar det = fabs(x1.x*x2.y-x1.y*x2.x);
+    Dscalar m = fabs(x1.x*x2.y)+fabs(x1.y*x2.x);
+    Dscalar n1 = x1.x*x1.x+x1.y*x1.y;
+    Dscalar n2 = x2.x*x2.x+x2.y*x2.y;
+    Dscalar q = sqrt(xc.x*xc.x+xc.y*xc.y);
+    return 4.0*eps*((q*m+2.0*(n1*sqrt(n2)+n2*sqrt(n1)))/det + 2.0*(q+radius));
+    };
+
+/*!
+\param x1 the second vertex of a triangle whose first vertex is the origin
+\param x2 the third vertex
+\param xc the circumcenter computed by Circumcircle(x1,x2,xc,radius)
+\param radius the computed radius
+\return the squared distance from xc up to which a point must be passed to the exact in-circle test;
+a point whose computed squared distance is larger than this is guaranteed to be outside of the circle.
+For a degenerate triangle this is infinite, so that every point is tested
+*/
+static Dscalar circumcircleBand2(const Dscalar2 &x1, const Dscalar2 &x2, const Dscalar2 &xc, Dscalar radius)
+    {
+    Dscalar band = radius + circumcircleError(x1,x2,xc,radius);
+    Dscalar band2 = band*band*(1.0+4.0*numeric_limits<Dscalar>::epsilon());
+    if (!(band2 < numeric_limits<Dscalar>::max()))
+        return numeric_limits<Dscalar>::infinity();
+    return band2;
+    };
+
+//!How many cells around a circumcenter must be searched to find every point within radius of it?
+static int searchWidth(cellListGPU *cl, Dscalar radius)
+    {
+    if (!(radius < cl->getXsize()*cl->getBoxsize()))
+        return cl->getXsize();
+    return ceil(radius/cl->getBoxsize())+1;
+    };
+
 /*!
 \param points references to a vector of new location for points, formatted as {x1,y1,x2,y2,...}
 */
 void DelaunayLoc::setPoints(vector<Dscalar> &points)
     {
     nV=points.size()/2;
-    pts.resize(nV);
+    ownedPts.resize(nV);
     triangulated = false;
     cellsize = 2.0;
     for (unsigned int ii = 0; ii<nV; ++ii)
         {
         Dscalar2 point;
         point.x=points[ii*2]; point.y=points[ii*2+1];
-        pts[ii]=point;
+        ownedPts[ii]=point;
         };
+    pts = ownedPts.data();
     };
 /*!
 \param points ArrayHandle of Dscalar2's that has already accessed a GPUArray containing the
@@ -29,14 +81,15 @@ new desired points
 void DelaunayLoc::setPoints(ArrayHandle<Dscalar2> &points, int N)
     {
     nV=N;
-    pts.clear();
-    pts.reserve(nV);
+    ownedPts.clear();
+    ownedPts.reserve(nV);
     triangulated = false;
     cellsize = 2.0;
     for (int ii = 0; ii < nV; ++ii)
         {
-        pts.push_back(points.data[ii]);
+        ownedPts.push_back(points.data[ii]);
         };
+    pts = ownedPts.data();
     };
 
 /*!
@@ -45,16 +98,16 @@ void DelaunayLoc::setPoints(ArrayHandle<Dscalar2> &points, int N)
 void DelaunayLoc::setPoints(GPUArray<Dscalar2> &points)
     {
     nV=points.getNumElements();
-    //pts.clear();
-    pts.resize(nV);
+    ownedPts.resize(nV);
     triangulated = false;
     cellsize = 2.0;
     ArrayHandle<Dscalar2> hp(points,access_location::host,access_mode::read);
     for (int ii = 0; ii < nV; ++ii)
         {
-        pts[ii].x=hp.data[ii].x;
-        pts[ii].y=hp.data[ii].y;
+        ownedPts[ii].x=hp.data[ii].x;
+        ownedPts[ii].y=hp.data[ii].y;
         };
+    pts = ownedPts.data();
     };
 
 /*!
@@ -63,15 +116,34 @@ void DelaunayLoc::setPoints(GPUArray<Dscalar2> &points)
 void DelaunayLoc::setPoints(vector<Dscalar2> &points)
     {
     nV=points.size();
-    pts.clear();pts.reserve(nV);
+    ownedPts.clear();ownedPts.reserve(nV);
     for (int ii = 0; ii < nV; ++ii)
         {
-        pts.push_back(points[ii]);
+        ownedPts.push_back(points[ii]);
         };
+    pts = ownedPts.data();
     triangulated = false;
     cellsize = 2.0;
     };
 
+/*!
+Rather than copying the points and building a private cell list, use data that is owned (and kept
+up to date) by someone else, e.g. the positions and cell list of a voronoiModelBase.
+\param points a host pointer to the positions of the points. It is not owned by this class, and is
+only valid while the ArrayHandle it came from is alive, so bind it through a DelaunayLocBinding
+declared next to that handle rather than calling this function directly
+\param N the number of points
+\param sharedCellList a cell list of the same points, on a grid that is already initialized
+*/
+void DelaunayLoc::setSharedPoints(const Dscalar2 *points, int N, cellListGPU *sharedCellList)
+    {
+    nV = N;
+    pts = points;
+    triangulated = false;
+    cList = sharedCellList;
+    cellsize = cList->getBoxsize();
+    };
+
 /*!
 \param bx a gpubox that the DelaunayLoc object should use in internal computations
 */
@@ -93,11 +165,15 @@ void DelaunayLoc::setBox(gpubox &bx)
 void DelaunayLoc::initialize(Dscalar csize)
     {
     cellsize = csize;
-    cList.setNp(nV);
-    cList.setBox(Box);
-    cList.setGridSize(cellsize);
-    cList.setParticles(pts);
-    cList.compute();
+    cList = &ownedCellList;
+    cList->setNp(nV);
+    cList->setBox(Box);
+    cList->setGridSize(cellsize);
+    if (pts != ownedPts.data())
+        ownedPts.assign(pts,pts+nV);
+    pts = ownedPts.data();
+    cList->setParticles(ownedPts);
+    cList->compute();
     };
 
 /*!
@@ -110,35 +186,59 @@ quadrant around cell i is found.
 */
 void DelaunayLoc::getPolygon(int i, vector<int> &P0,vector<Dscalar2> &P1)
     {
-    vector<int> Pt(4,-1);
-    Dscalar2 np;
-    np.x=-1;np.y=-1;
-    vector<Dscalar2> Pt2(4,np);
+    ArrayHandle<unsigned int> h_cs(cList->cell_sizes,access_location::host,access_mode::read);
+    ArrayHandle<int> h_idx(cList->idxs,access_location::host,access_mode::read);
+    getPolygon(i,P0,P1,h_cs.data,h_idx.data);
+    };
+
+/*!
+The same as above, but the cell list data is passed in directly so that this can be called from multiple threads
+\param i the index of the cell in question
+\param P0 a reference to the indices of cells that form the enclosing polygon
+\param P1 a reference to the positions of the cells forming the enclosing polygon relative to cell i
+\param cellSizes host pointer to the cell_sizes array of the class' cell list
+\param cellIdxs host pointer to the idxs array of the class' cell list
+*/
+void DelaunayLoc::getPolygon(int i, vector<int> &P0,vector<Dscalar2> &P1, const unsigned int *cellSizes, const int *cellIdxs)
+    {
     P0.resize(4);
     P1.resize(4);
+    vector<int> cellneighs;cellneighs.reserve(25);
+    getPolygon(i,&P0[0],&P1[0],cellSizes,cellIdxs,cellneighs);
+    };
 
-    vector<Dscalar> dists(4,1e6);
+/*!
+The allocation-free core of the routines above.
+\param i the index of the cell in question
+\param P0 an array of four indices of cells that form the enclosing polygon
+\param P1 an array of the four positions of the cells forming the enclosing polygon relative to cell i
+\param cellSizes host pointer to the cell_sizes array of the class' cell list
+\param cellIdxs host pointer to the idxs array of the class' cell list
+\param cellneighs scratch space for the cells in each search shell
+\return false if no point was found in some quadrant around cell i
+*/
+bool DelaunayLoc::getPolygon(int i, int *P0, Dscalar2 *P1, const unsigned int *cellSizes, const int *cellIdxs,
+                             vector<int> &cellneighs)
+    {
+    Dscalar dists[4] = {1e6,1e6,1e6,1e6};
+    bool found[4] = {false,false,false,false};
     Dscalar2 v = pts[i];
-    int cidx = cList.positionToCellIndex(v.x,v.y);
-    vector<bool> found(4,false);
-    int wmax = cList.getXsize();
+    int cidx = cList->positionToCellIndex(v.x,v.y);
+    int wmax = cList->getXsize();
     //while a data point in a quadrant hasn't been found, expand the size of the search grid and keep looking
     int width = 0;
-    vector<int> cellneighs;cellneighs.reserve(25);
     int idx;
     Dscalar2 disp;
     Dscalar nrm;
-    ArrayHandle<unsigned int> h_cs(cList.cell_sizes,access_location::host,access_mode::read);
-    ArrayHandle<int> h_idx(cList.idxs,access_location::host,access_mode::read);
     while(!found[0]||!found[1]||!found[2]||!found[3])
         {
-        cList.getCellShellNeighbors(cidx,width,cellneighs);
+        cList->getCellShellNeighbors(cidx,width,cellneighs);
         for (int cc = 0; cc < cellneighs.size(); ++cc)
             {
-            int numberInCell = h_cs.data[cellneighs[cc]];
+            int numberInCell = cellSizes[cellneighs[cc]];
             for (int pp = 0; pp < numberInCell;++pp)
                 {
-                idx = h_idx.data[cList.cell_list_indexer(pp,cellneighs[cc])];
+                idx = cellIdxs[cList->cell_list_indexer(pp,cellneighs[cc])];
                 if (idx == i ) continue;
                 Box->minDist(pts[idx],v,disp);
                 nrm = sqrt(disp.x*disp.x+disp.y*disp.y);
@@ -154,8 +254,9 @@ void DelaunayLoc::getPolygon(int i, vector<int> &P0,vector<Dscalar2> &P1)
             };
 
         width +=1;
-        if (width >= wmax) return;
+        if (width >= wmax) return false;
         };//end loop over cells
+    return true;
     };
 
 /*!
@@ -170,56 +271,86 @@ subset
 */
 void DelaunayLoc::getOneRingCandidate(int i, vector<int> &DTringIdx, vector<Dscalar2> &DTring)
     {
+    ArrayHandle<unsigned int> h_cs(cList->cell_sizes,access_location::host,access_mode::read);
+    ArrayHandle<int> h_idx(cList->idxs,access_location::host,access_mode::read);
+    getOneRingCandidate(i,DTringIdx,DTring,h_cs.data,h_idx.data);
+    };
+
+/*!
+The same as above, but the cell list data is passed in directly so that this can be called from multiple threads
+\param i the cell to get the candidate 1-ring of
+\param DTringIdx a reference to a vector of cell indices that will make up the candidate 1-ring
+\param DTring a reference to a vector of relative cell positions that will make up the candidate 1-ring
+\param cellSizes host pointer to the cell_sizes array of the class' cell list
+\param cellIdxs host pointer to the idxs array of the class' cell list
+*/
+void DelaunayLoc::getOneRingCandidate(int i, vector<int> &DTringIdx, vector<Dscalar2> &DTring,
+                                      const unsigned int *cellSizes, const int *cellIdxs)
+    {
+    oneRingScratch scratch;
+    scratch.ringIdx.swap(DTringIdx);
+    scratch.ring.swap(DTring);
+    getOneRingCandidate(i,scratch,cellSizes,cellIdxs);
+    DTringIdx.swap(scratch.ringIdx);
+    DTring.swap(scratch.ring);
+    };
+
+/*!
+The core of the candidate 1-ring calculation. All temporary storage lives in the scratch structure,
+so once its vectors have grown to a typical size repeated calls do not allocate.
+\param i the cell to get the candidate 1-ring of
+\param scratch reusable storage; on output scratch.ringIdx and scratch.ring hold the indices and
+relative positions of the candidate 1-ring, with cell i itself in the first position
+\param cellSizes host pointer to the cell_sizes array of the class' cell list
+\param cellIdxs host pointer to the idxs array of the class' cell list
+\return false if no enclosing polygon could be found, in which case the ring is not a valid candidate 1-ring
+*/
+bool DelaunayLoc::getOneRingCandidate(int i, oneRingScratch &scratch, const unsigned int *cellSizes, const int *cellIdxs)
+    {
+    vector<int> &DTringIdx = scratch.ringIdx;
+    vector<Dscalar2> &DTring = scratch.ring;
     //first, find a polygon enclosing vertex i
-    vector<int> P0;//index of vertices forming surrounding sqaure
-    vector<Dscalar2> P1;//relative position of vertices forming surrounding square
-    getPolygon(i,P0,P1);
+    int P0[4];//index of vertices forming surrounding sqaure
+    Dscalar2 P1[4];//relative position of vertices forming surrounding square
+    Dscalar2 vc;
+    vc.x=0.0; vc.y=0.0;
+    DTring.clear();
+    DTringIdx.clear();
+    DTring.push_back(vc);
+    DTringIdx.push_back(i);
+    if (!getPolygon(i,P0,P1,cellSizes,cellIdxs,scratch.cellNeighbors))
+        return false;
 
     //now, get the cells in the circumcircles
     Dscalar2 v;
     v.x=pts[i].x;v.y=pts[i].y;
-    DTring.clear();
-    DTringIdx.clear();
 
     int reduceSize = 30;
-    DTring.reserve(2*reduceSize); DTringIdx.reserve(2*reduceSize);
-    Dscalar2 vc;
-    vc.x=0.0; vc.y=0.0;
-    DTring.push_back(vc);
-    DTringIdx.push_back(i);
     for (int jj = 0; jj < 4;++jj)
         {
         DTringIdx.push_back(P0[jj]);
         DTring.push_back(P1[jj]);
         };
 
-    vector<Dscalar2> Q0;//vector of circumcenters formed by vertex i and the P_i
-    Dscalar2 Qnew;
-    Qnew.x=0.0;Qnew.y=0.0;
-    bool valid;
-    vector<Dscalar> rads;
-    Q0.reserve(4);
-    rads.reserve(4);
+    Dscalar2 Q0[4];//circumcenters formed by vertex i and the P_i
+    Dscalar rads[4];
     Dscalar radius;
-    Dscalar vx = 0.0;Dscalar vy = 0.0;
     for (int ii = 0; ii < 4; ++ii)
         {
-        Circumcircle(P1[ii],P1[(ii+1)%4],Qnew,radius);
-        Q0.push_back(Qnew);
-        rads.push_back(radius*1.0001);
+        Circumcircle(P1[ii],P1[(ii+1)%4],Q0[ii],radius);
+        rads[ii] = radius*1.0001;
         };
 
-
-    vector<int> cellns;
-    cellns.reserve(100);//often 16*4 or 25*4
-    vector<int> cns;
+    vector<int> &cellns = scratch.cellsToSearch;
+    vector<int> &cns = scratch.cellNeighbors;
+    cellns.clear();
     int idx;
     for (int ii = 0; ii < 4; ++ii)
         {
-        int cix = cList.positionToCellIndex(v.x+Q0[ii].x,v.y+Q0[ii].y);
+        int cix = cList->positionToCellIndex(v.x+Q0[ii].x,v.y+Q0[ii].y);
 
-        int wcheck = ceil(rads[ii]/cList.getBoxsize())+1;
-        cList.getCellNeighbors(cix,wcheck,cns);
+        int wcheck = ceil(rads[ii]/cList->getBoxsize())+1;
+        cList->getCellNeighbors(cix,wcheck,cns);
         //cellschecked += cns.size();
         for (int cc = 0; cc < cns.size(); ++cc)
             cellns.push_back(cns[cc]);
@@ -231,45 +362,40 @@ void DelaunayLoc::getOneRingCandidate(int i, vector<int> &DTringIdx, vector<Dsca
 
     Dscalar2 tocenter;
     Dscalar2 disp;
-    bool repeat=false;
     Dscalar rr;
-    ArrayHandle<unsigned int> h_cs(cList.cell_sizes,access_location::host,access_mode::read);
-    ArrayHandle<int> h_idx(cList.idxs,access_location::host,access_mode::read);
     for (int cc = 0; cc < cellns.size(); ++cc)
         {
-        int numberInCell = h_cs.data[cellns[cc]];
+        int numberInCell = cellSizes[cellns[cc]];
         for (int pp = 0; pp < numberInCell;++pp)
             {
-            idx = h_idx.data[cList.cell_list_indexer(pp,cellns[cc])];
+            idx = cellIdxs[cList->cell_list_indexer(pp,cellns[cc])];
             //exclude anything already in the ring (vertex and polygon)
             if (idx == i || idx == DTringIdx[1] || idx == DTringIdx[2] ||
                             idx == DTringIdx[3] || idx == DTringIdx[4]) continue;
             Box->minDist(pts[idx],v,disp);
             //how far is the point from the circumcircle's center?
-            repeat = false;
             for (int qq = 0; qq < 4; ++qq)
                 {
-                if (repeat) continue;
                 rr=rads[qq];
                 rr = rr*rr;
                 Box->minDist(disp,Q0[qq],tocenter);
                 if(tocenter.x*tocenter.x+tocenter.y*tocenter.y<rr)
                     {
                     //the point is in at least one circumcircle...
-                     repeat = true;
-                     DTringIdx.push_back(idx);
-                     DTring.push_back(disp);
+                    DTringIdx.push_back(idx);
+                    DTring.push_back(disp);
+                    break;
                     };
-
                 };
             };
         };
     //if the candidate 1-ring is very large, see if a simple algorithm can reduce it
     if (DTring.size() > reduceSize)
         {
-        reduceOneRing(i,DTringIdx,DTring);
+        reduceOneRing(i,scratch);
         };
     //candidates = DTring.size();
+    return true;
     };
 
 /*!
@@ -286,43 +412,45 @@ subset
 */
 void DelaunayLoc::reduceOneRing(int i, vector<int> &DTringIdx, vector<Dscalar2> &DTring)
     {
+    oneRingScratch scratch;
+    scratch.ringIdx.swap(DTringIdx);
+    scratch.ring.swap(DTring);
+    reduceOneRing(i,scratch);
+    DTringIdx.swap(scratch.ringIdx);
+    DTring.swap(scratch.ring);
+    };
+
+/*!
+The core of the routine above, acting on (and using the storage of) a oneRingScratch structure
+\param i the cell to get the candidate 1-ring of
+\param scratch reusable storage whose ringIdx and ring members hold the candidate 1-ring to reduce
+*/
+void DelaunayLoc::reduceOneRing(int i, oneRingScratch &scratch)
+    {
+    vector<int> &DTringIdx = scratch.ringIdx;
+    vector<Dscalar2> &DTring = scratch.ring;
     //basically, see if an enclosing polygon with a smaller sum of circumcircle radii can be found
     //start with the vertex i
-    vector<int> newRingIdx; newRingIdx.reserve(50);
-    vector<Dscalar2> newRing;     newRing.reserve(50);
+    vector<int> &newRingIdx = scratch.newRingIdx;
+    vector<Dscalar2> &newRing = scratch.newRing;
+    newRingIdx.clear();
+    newRing.clear();
     Dscalar2 v;
     v.x=0.0;v.y=0.0;
     newRing.push_back(v);
     newRingIdx.push_back(i);
 
-    vector<Dscalar2> Q0;//vector of circumcenters formed by vertex i and the P_i
     Dscalar2 Qnew,Qnew2;
     Qnew.x=0.0;Qnew.y=0.0;Qnew2.x=0.0;Qnew2.y=0.0;
-    bool valid;
-    vector<int> P0(4);
-    vector<Dscalar2> P1(4);
-    P0[0]=DTringIdx[1];
-    P0[1]=DTringIdx[2];
-    P0[2]=DTringIdx[3];
-    P0[3]=DTringIdx[4];
-    P1[0]=DTring[1];
-    P1[1]=DTring[2];
-    P1[2]=DTring[3];
-    P1[3]=DTring[4];
-
-    Dscalar radius;
-    Dscalar vx = 0.0;Dscalar vy = 0.0;
+    Dscalar2 P1[4];
+    for (int ii = 0; ii < 4; ++ii)
+        P1[ii]=DTring[ii+1];
 
-    int Psize=P1.size();
-    vector<Dscalar> rads;
-    Q0.reserve(4);
-    rads.reserve(4);
+    const int Psize=4;
+    Dscalar2 Q0[4];//circumcenters formed by vertex i and the P_i
+    Dscalar rads[4];
     for (int ii = 0; ii < Psize; ++ii)
-        {
-        Circumcircle(P1[ii],P1[(ii+1)%Psize],Qnew,radius);
-        Q0.push_back(Qnew);
-        rads.push_back(radius);
-        };
+        Circumcircle(P1[ii],P1[(ii+1)%Psize],Q0[ii],rads[ii]);
 
     for (int nn = 5; nn < DTring.size(); ++nn)
         {
@@ -340,20 +468,16 @@ void DelaunayLoc::reduceOneRing(int i, vector<int> &DTringIdx, vector<Dscalar2>
             Q0[polyi2]=Qnew2;
             rads[q]=r1;
             rads[polyi2]=r2;
-            P0[q]=DTringIdx[nn];
             };
         };
 
-    bool repeat = false;
     Dscalar2 tocenter;
     Dscalar rr;
     for (int pp = 1; pp < DTring.size(); ++pp)
         {
         //check if DTring[pp] is in any of the new circumcircles
-        repeat = false;
-        for (int qq = 0; qq < Q0.size(); ++qq)
+        for (int qq = 0; qq < Psize; ++qq)
             {
-            if (repeat) continue;
             rr=rads[qq]*1.0001;
             rr = rr*rr;
             Box->minDist(DTring[pp],Q0[qq],tocenter);
@@ -361,16 +485,153 @@ void DelaunayLoc::reduceOneRing(int i, vector<int> &DTringIdx, vector<Dscalar2>
                 {
                 newRing.push_back(DTring[pp]);
                 newRingIdx.push_back(DTringIdx[pp]);
-                repeat = true;
+                break;
                 };
             };
 
         };
-
     DTring.swap(newRing);
     DTringIdx.swap(newRingIdx);
     //candidates = DTring.size();
     };
+
+/*!
+The lifted in-circle determinant of (0,a,b,p) vanishes when the four points are cocircular. In that
+case the tie is broken by perturbing the lifted height of each point by an amount that decreases
+with its global index (simulation of simplicity), which only requires the cofactors of the lifted
+heights, i.e. the orientations of the other three points. Since the perturbation only depends on
+global indices the same choice is made in the candidate 1-ring of every point.
+\param idx the global indices of the points 0, a, b, and p
+\param a,b,p positions relative to the first point
+\return +1 if p is inside the perturbed circle through 0, a and b, and -1 if it is outside
+*/
+static int perturbedInCircle(const int *idx, const Dscalar2 &a, const Dscalar2 &b, const Dscalar2 &p)
+    {
+    Dscalar2 origin = make_Dscalar2(0.0,0.0);
+    int cofactor[4];
+    cofactor[0] = orientation(a,b,p);
+    cofactor[1] = -orientation(origin,b,p);
+    cofactor[2] = orientation(origin,a,p);
+    cofactor[3] = -orientation(origin,a,b);
+    bool used[4] = {false,false,false,false};
+    for (int kk = 0; kk < 4; ++kk)
+        {
+        int smallest = -1;
+        for (int jj = 0; jj < 4; ++jj)
+            if (!used[jj] && (smallest < 0 || idx[jj] < idx[smallest]))
+                smallest = jj;
+        used[smallest] = true;
+        if (cofactor[smallest] != 0)
+            return cofactor[smallest];
+        };
+    return 0;
+    };
+
+/*!
+Find the Delaunay neighbors of the first point of a candidate 1-ring directly, without triangulating
+the rest of the ring. The first point is taken to be at the origin, and the star is found by gift
+wrapping: the closest point is always a Delaunay neighbor, and given a neighbor a, the next neighbor
+in CCW order is the point to the left of the ray from the origin through a whose circle through the
+origin and a contains no other such point. The orientation and in-circle tests are exact (see
+geometricPredicates.h), and cocircular points are handled by perturbedInCircle. Everything is done
+in a fixed-size buffer on the stack.
+\param ring the candidate 1-ring, positions relative to ring[0] (which must be at the origin)
+\param ringIdx the global indices of the points in the ring
+\param neighbors on output, the indices (within the ring) of the Delaunay neighbors of ring[0], in CCW order
+\return false if the star could not be closed (e.g., the ring does not enclose the origin, or the star
+has more than maxStarSize points), in which case the caller should fall back to a full triangulation
+*/
+bool DelaunayLoc::getStar(const vector<Dscalar2> &ring, const vector<int> &ringIdx, vector<int> &neighbors)
+    {
+    neighbors.clear();
+    int n = ring.size();
+    if (n < 4)
+        return false;
+    int star[maxStarSize];
+    int starSize = 0;
+
+    int first = 1;
+    Dscalar minDist2 = ring[1].x*ring[1].x+ring[1].y*ring[1].y;
+    for (int jj = 2; jj < n; ++jj)
+        {
+        Dscalar d2 = ring[jj].x*ring[jj].x+ring[jj].y*ring[jj].y;
+        if (d2 < minDist2)
+            {
+            minDist2 = d2;
+            first = jj;
+            };
+        };
+    if (minDist2 <= 0)
+        return false;
+
+    int current = first;
+    int quad[4];
+    quad[0] = ringIdx[0];
+    Dscalar2 origin = ring[0];
+    do
+        {
+        if (starSize == maxStarSize)
+            return false;
+        star[starSize] = current;
+        starSize += 1;
+        Dscalar2 a = ring[current];
+        quad[1] = ringIdx[current];
+        int next = -1;
+        Dscalar2 b;
+        for (int jj = 1; jj < n; ++jj)
+            {
+            Dscalar2 p = ring[jj];
+            if (orientation(origin,a,p) <= 0)
+                continue;
+            if (next >= 0)
+                {
+                //is p inside the circle through (0,a,b)?
+                int inside = inCircle(origin,a,b,p);
+                if (inside == 0)
+                    {
+                    quad[2] = ringIdx[next];
+                    quad[3] = ringIdx[jj];
+                    inside = perturbedInCircle(quad,a,b,p);
+                    };
+                if (inside <= 0)
+                    continue;
+                };
+            next = jj;
+            b = p;
+            };
+        if (next < 0)
+            return false;
+        current = next;
+        } while (current != first);
+
+    neighbors.assign(star,star+starSize);
+    return true;
+    };
+
+/*!
+Call the CGAL library (for non-periodic 2D Delaunay triangulations) through the DelaunayCGAL class to
+triangulate an entire candidate 1-ring, and read off the star of its first point.
+\param DTringIdx the indices of the candidate 1-ring
+\param DTring the relative positions of the candidate 1-ring
+\param neighbors on output, the (global) indices of the Delaunay neighbors of the first point, in CCW order
+*/
+bool DelaunayLoc::triangulateRingCGAL(const vector<int> &DTringIdx, const vector<Dscalar2> &DTring, vector<int> &neighbors)
+    {
+    DelaunayCGAL delcgal;
+
+    vector<pair<LPoint,int> > Pnts(DTring.size());
+    for (int ii = 0; ii < DTring.size(); ++ii)
+        {
+        Pnts[ii] = make_pair(LPoint(DTring[ii].x,DTring[ii].y),ii);
+        };
+    bool success = delcgal.LocalTriangulation(Pnts, neighbors);
+
+    for (int nn = 0; nn < neighbors.size(); ++nn)
+        neighbors[nn] = DTringIdx[neighbors[nn]];
+
+    return success;
+    };
+
 /*!
 call the CGAL library (for non-periodic 2D Delaunay triangulations) through the DelaunayCGAL class
 to go from the candidate 1-ring of cell i to its true set of delaunay neighbors.
@@ -380,28 +641,128 @@ to go from the candidate 1-ring of cell i to its true set of delaunay neighbors.
 */
 bool DelaunayLoc::getNeighborsCGAL(int i, vector<int> &neighbors)
     {
+    ArrayHandle<unsigned int> h_cs(cList->cell_sizes,access_location::host,access_mode::read);
+    ArrayHandle<int> h_idx(cList->idxs,access_location::host,access_mode::read);
+    return getNeighborsCGAL(i,neighbors,DTringIdxCGAL,DTringCGAL,h_cs.data,h_idx.data);
+    };
+
+/*!
+The same as above, but with caller-owned scratch vectors and cell list data passed in directly, so
+that different threads can find the neighbors of different cells at the same time.
+\param i the cell in question
+\param neighbors a reference to a vector of cell indices that are the Delaunay neighbors of i
+\param DTringIdx scratch space for the indices of the candidate 1-ring
+\param DTring scratch space for the relative positions of the candidate 1-ring
+\param cellSizes host pointer to the cell_sizes array of the class' cell list
+\param cellIdxs host pointer to the idxs array of the class' cell list
+*/
+bool DelaunayLoc::getNeighborsCGAL(int i, vector<int> &neighbors, vector<int> &DTringIdx, vector<Dscalar2> &DTring,
+                                   const unsigned int *cellSizes, const int *cellIdxs)
+    {
     //first, get candidate 1-ring
-    getOneRingCandidate(i,DTringIdxCGAL,DTringCGAL);
+    getOneRingCandidate(i,DTringIdx,DTring,cellSizes,cellIdxs);
 
     //call another algorithm to triangulate the candidate set
-    DelaunayCGAL delcgal;
+    return triangulateRingCGAL(DTringIdx,DTring,neighbors);
+    };
 
-    vector<pair<LPoint,int> > Pnts(DTringCGAL.size());
-    for (int ii = 0; ii < DTringCGAL.size(); ++ii)
+/*!
+Get the Delaunay neighbors of cell i from its candidate 1-ring with getStar, falling back on a CGAL
+triangulation of the candidate 1-ring only if that fails on a valid candidate 1-ring. This is safe
+to call from multiple threads as long as each thread has its own scratch structure, and does not
+allocate once the scratch vectors have grown to a typical size.
+\param i the cell in question
+\param neighbors a reference to a vector of cell indices that are the Delaunay neighbors of i, in CCW order
+\param scratch reusable storage
+\param cellSizes host pointer to the cell_sizes array of the class' cell list
+\param cellIdxs host pointer to the idxs array of the class' cell list
+\return false if no candidate 1-ring could be found (no enclosing polygon) or the CGAL triangulation
+failed; the caller should then fall back on a global triangulation
+*/
+bool DelaunayLoc::getNeighborsStar(int i, vector<int> &neighbors, oneRingScratch &scratch,
+                                   const unsigned int *cellSizes, const int *cellIdxs)
+    {
+    //without an enclosing polygon the ring is just cell i, and only a global triangulation will do
+    if (!getOneRingCandidate(i,scratch,cellSizes,cellIdxs))
+        return false;
+    if (getStar(scratch.ring,scratch.ringIdx,neighbors))
         {
-        Pnts[ii] = make_pair(LPoint(DTringCGAL[ii].x,DTringCGAL[ii].y),ii);
+        for (int nn = 0; nn < neighbors.size(); ++nn)
+            neighbors[nn] = scratch.ringIdx[neighbors[nn]];
+        return true;
         };
-    bool success = delcgal.LocalTriangulation(Pnts, neighbors);
+    return triangulateRingCGAL(scratch.ringIdx,scratch.ring,neighbors);
+    };
 
-    for (int nn = 0; nn < neighbors.size(); ++nn)
-        neighbors[nn] = DTringIdxCGAL[neighbors[nn]];
+/*!
+Find the Delaunay neighbors of every cell in a list, splitting the work over several threads.
+The list is split into contiguous blocks; each thread writes the neighbors of its block into its
+own buffer, and the buffers are then concatenated in thread order. The output is therefore
+identical to calling getNeighborsStar(fixlist[ii],...) for each ii in turn. The per-thread scratch
+space and buffers are kept between calls.
+\param fixlist the cells whose neighbors should be found
+\param allneighs the (flattened) output; the CCW-ordered neighbors of fixlist[ii] are allneighs[allneighidxstart[ii]] to allneighs[allneighidxstop[ii]-1]
+\param allneighidxstart see above
+\param allneighidxstop see above
+\param nThreads the number of threads to use
+\return false if the local triangulation of any cell failed, in which case the output is incomplete
+*/
+bool DelaunayLoc::getNeighborsLocal(const vector<int> &fixlist, vector<int> &allneighs, vector<int> &allneighidxstart,
+                                    vector<int> &allneighidxstop, int nThreads)
+    {
+    int fixes = fixlist.size();
+    allneighidxstart.resize(fixes);
+    allneighidxstop.resize(fixes);
+    if (nThreads < 1) nThreads = 1;
+    ArrayHandle<unsigned int> h_cs(cList->cell_sizes,access_location::host,access_mode::read);
+    ArrayHandle<int> h_idx(cList->idxs,access_location::host,access_mode::read);
+    const unsigned int *cellSizes = h_cs.data;
+    const int *cellIdxs = h_idx.data;
+
+    if (threadScratch.size() < nThreads)
+        threadScratch.resize(nThreads);
+    if (threadNeighs.size() < nThreads)
+        threadNeighs.resize(nThreads);
+    vector<int> threadFailure(nThreads,0);
+    parallelBlocks(fixes,nThreads,[&](int begin, int end, int t)
+        {
+        oneRingScratch &scratch = threadScratch[t];
+        vector<int> &neighTemp = scratch.star;
+        vector<int> &buffer = threadNeighs[t];
+        buffer.clear();
+        for (int ii = begin; ii < end; ++ii)
+            {
+            if(!getNeighborsStar(fixlist[ii],neighTemp,scratch,cellSizes,cellIdxs))
+                {
+                threadFailure[t] = 1;
+                return;
+                };
+            //offsets are relative to this thread's buffer until the merge below
+            allneighidxstart[ii] = buffer.size();
+            buffer.insert(buffer.end(),neighTemp.begin(),neighTemp.end());
+            allneighidxstop[ii] = buffer.size();
+            };
+        });
 
-    if (success)
-        return true;
-    else
-        return false;
-    };
+    for (int t = 0; t < nThreads; ++t)
+        if(threadFailure[t] != 0)
+            return false;
 
+    //merge the per-thread buffers in order
+    allneighs.clear();
+    int effectiveThreads = min(nThreads,max(fixes,1));
+    for (int t = 0; t < effectiveThreads; ++t)
+        {
+        int offset = allneighs.size();
+        for (int ii = parallelBlockStart(fixes,effectiveThreads,t); ii < parallelBlockStart(fixes,effectiveThreads,t+1); ++ii)
+            {
+            allneighidxstart[ii] += offset;
+            allneighidxstop[ii] += offset;
+            };
+        allneighs.insert(allneighs.end(),threadNeighs[t].begin(),threadNeighs[t].end());
+        };
+    return true;
+    };
 
 /*!
 If CGAL is unavailable, call the DelaunayNP class to go from the candidate 1-ring of cell i to
@@ -516,17 +877,34 @@ Given a cell index and a propsed set of neighbors in CCW order, see if all circu
 */
 bool DelaunayLoc::testPointTriangulation(int i, vector<int> &neighbors, bool timing)
     {
+    ArrayHandle<unsigned int> h_cs(cList->cell_sizes,access_location::host,access_mode::read);
+    ArrayHandle<int> h_idx(cList->idxs,access_location::host,access_mode::read);
+    vector<int> cns;
+    return testPointTriangulation(i,&neighbors[0],neighbors.size(),h_cs.data,h_idx.data,cns);
+    };
 
+/*!
+The workhorse of the circumcircle test. Since no GPUArrays are accessed here (the cell list data
+is passed in directly), many threads can call this function at the same time on different cells.
+\param i the target cell
+\param neighbors a pointer to the set of proposed neighbors, in CCW order
+\param neighNum the number of proposed neighbors
+\param cellSizes host pointer to the cell_sizes array of the class' cell list
+\param cellIdxs host pointer to the idxs array of the class' cell list
+\param cns scratch space for the cell indices to check (one per calling thread)
+*/
+bool DelaunayLoc::testPointTriangulation(int i, const int *neighbors, int neighNum, const unsigned int *cellSizes,
+                                         const int *cellIdxs, vector<int> &cns)
+    {
     Dscalar2 v = pts[i];
     //for each circumcirlce, see if its empty
-    int neigh1 = neighbors[neighbors.size()-1];
-    vector<int> cns;
+    int neigh1 = neighbors[neighNum-1];
     Dscalar radius;
-    Dscalar vx = 0.0; Dscalar vy = 0.0;
     bool repeat = false;
     Dscalar2 tocenter, disp;
+    Dscalar2 origin = make_Dscalar2(0.0,0.0);
 
-    for (int nn = 0; nn < neighbors.size(); ++nn)
+    for (int nn = 0; nn < neighNum; ++nn)
         {
         if (repeat) continue;
         int neigh2 = neighbors[nn];
@@ -536,31 +914,30 @@ bool DelaunayLoc::testPointTriangulation(int i, vector<int> &neighbors, bool tim
 
         Dscalar2 Q;
         Circumcircle(pt1,pt2,Q,radius);
-        Dscalar rad2 = radius*radius;
+        Dscalar band2 = circumcircleBand2(pt1,pt2,Q,radius);
 
         //what cell indices to check
-        int cix = cList.positionToCellIndex(v.x+Q.x,v.y+Q.y);
-        int wcheck = ceil(radius/cList.getBoxsize())+1;
-        cList.getCellNeighbors(cix,wcheck,cns);
-        ArrayHandle<unsigned int> h_cs(cList.cell_sizes,access_location::host,access_mode::read);
-        ArrayHandle<int> h_idx(cList.idxs,access_location::host,access_mode::read);
+        int cix = cList->positionToCellIndex(v.x+Q.x,v.y+Q.y);
+        int wcheck = searchWidth(cList,sqrt(band2));
+        cList->getCellNeighbors(cix,wcheck,cns);
         for (int cc = 0; cc < cns.size(); ++cc)
             {
             if (repeat) continue;
-            int numberInCell = h_cs.data[cns[cc]];
+            int numberInCell = cellSizes[cns[cc]];
             for (int pp = 0; pp < numberInCell;++pp)
                 {
                 if (repeat) continue;
 
-                int idx = h_idx.data[cList.cell_list_indexer(pp,cns[cc])];
+                int idx = cellIdxs[cList->cell_list_indexer(pp,cns[cc])];
                 Box->minDist(pts[idx],v,disp);
-                //how far is the point from the circumcircle's center?
+                //how far is the point from the circumcircle's center? Close calls are decided exactly
                 Box->minDist(disp,Q,tocenter);
-                if(tocenter.x*tocenter.x+tocenter.y*tocenter.y<rad2)
+                if(!(tocenter.x*tocenter.x+tocenter.y*tocenter.y > band2) &&
+                   inCircumcircle(origin,pt1,pt2,disp) > 0)
                     {
                     //double check that it isn't one of the points in the nlist or i
                     repeat = true;
-                    for (int n2 = 0; n2 < neighbors.size();++n2)
+                    for (int n2 = 0; n2 < neighNum;++n2)
                         if (neighbors[n2] == idx) repeat = false;
                     if (idx == i) repeat = false;
                     };
@@ -569,10 +946,171 @@ bool DelaunayLoc::testPointTriangulation(int i, vector<int> &neighbors, bool tim
         neigh1 = neigh2;
         }; // end loop over neighbors for circumcircle
 
-
     return (!repeat);
     };
 
+/*!
+Test the current neighbor lists of every point in [0,N). The points are split into contiguous
+blocks, one per thread, and each thread writes only to the repair entries of its own block, so the
+set of flagged points is identical to the one found by a serial sweep, regardless of nThreads.
+\param N the number of points to test
+\param neighborNum host pointer to the number of neighbors of each point
+\param neighbors host pointer to the (CCW ordered) neighbor list, accessed via nIdx
+\param nIdx the indexer for the neighbors array
+\param repair host pointer to an array of length N; repair[i] is set to 1 if the test fails, and to 0 otherwise
+\param nThreads the number of threads to use
+\return the number of points whose test failed
+*/
+int DelaunayLoc::testPointTriangulations(int N, const int *neighborNum, const int *neighbors, const IndexCSR &nIdx,
+                                         int *repair, int nThreads)
+    {
+    ArrayHandle<unsigned int> h_cs(cList->cell_sizes,access_location::host,access_mode::read);
+    ArrayHandle<int> h_idx(cList->idxs,access_location::host,access_mode::read);
+    const unsigned int *cellSizes = h_cs.data;
+    const int *cellIdxs = h_idx.data;
+
+    vector<int> failures(max(nThreads,1),0);
+    parallelBlocks(N,nThreads,[&](int begin, int end, int t)
+        {
+        vector<int> cns;
+        cns.reserve(25);
+        for (int nn = begin; nn < end; ++nn)
+            {
+            repair[nn] = 0;
+            if(!testPointTriangulation(nn,&neighbors[nIdx(0,nn)],neighborNum[nn],cellSizes,cellIdxs,cns))
+                {
+                repair[nn] = 1;
+                failures[t] += 1;
+                };
+            };
+        });
+
+    int totalFailures = 0;
+    for (int t = 0; t < failures.size(); ++t)
+        totalFailures += failures[t];
+    return totalFailures;
+    };
+
+/*!
+Test whether the circumcircle of a single triangle is empty, and (optionally) estimate how far the
+points may move before that could change. The estimate (see circumcircleTolerance) is based on the
+gap between the circumradius and the nearest non-member point.
+\param tri the indices of the vertices of the triangle
+\param cellSizes host pointer to the cell list's cell_sizes data
+\param cellIdxs host pointer to the cell list's idxs data
+\param cns caller-owned scratch space for the list of neighboring cells
+\param intruders on output, the points inside the circumcircle, if any
+\param tolerance if not NULL, on output the maximum displacement of any point for which the circle is certified to remain empty
+\return true if the circumcircle is empty
+*/
+bool DelaunayLoc::testCircumcircle(const int3 &tri, const unsigned int *cellSizes, const int *cellIdxs,
+                                   vector<int> &cns, vector<int> &intruders, Dscalar *tolerance)
+    {
+    intruders.clear();
+    Dscalar2 v = pts[tri.x];
+    Dscalar2 pt1, pt2, disp, tocenter;
+    Dscalar2 origin = make_Dscalar2(0.0,0.0);
+    Box->minDist(pts[tri.y],v,pt1);
+    Box->minDist(pts[tri.z],v,pt2);
+    Dscalar2 Q;
+    Dscalar radius;
+    Circumcircle(pt1,pt2,Q,radius);
+    Dscalar band2 = circumcircleBand2(pt1,pt2,Q,radius);
+
+    //when estimating the tolerance, also look for the nearest point in a shell about one cell wide
+    Dscalar searchRadius = radius;
+    if (tolerance != NULL)
+        searchRadius += cList->getBoxsize();
+    Dscalar nearest2 = searchRadius*searchRadius;
+
+    int cix = cList->positionToCellIndex(v.x+Q.x,v.y+Q.y);
+    int wcheck = searchWidth(cList,max(sqrt(band2),searchRadius));
+    cList->getCellNeighbors(cix,wcheck,cns);
+    for (int cc = 0; cc < cns.size(); ++cc)
+        {
+        int numberInCell = cellSizes[cns[cc]];
+        for (int pp = 0; pp < numberInCell;++pp)
+            {
+            int idx = cellIdxs[cList->cell_list_indexer(pp,cns[cc])];
+            if (idx == tri.x || idx == tri.y || idx == tri.z)
+                continue;
+            Box->minDist(pts[idx],v,disp);
+            Box->minDist(disp,Q,tocenter);
+            Dscalar d2 = tocenter.x*tocenter.x+tocenter.y*tocenter.y;
+            //close calls are decided by the exact in-circle test
+            if (!(d2 > band2) && inCircumcircle(origin,pt1,pt2,disp) > 0)
+                intruders.push_back(idx);
+            if (d2 < nearest2)
+                nearest2 = d2;
+            };
+        };
+    if (intruders.size() > 0)
+        return false;
+
+    if (tolerance != NULL)
+        *tolerance = circumcircleTolerance(pt1,pt2,radius,sqrt(nearest2) - sqrt(band2));
+    return true;
+    };
+
+/*!
+Test the circumcircles of a list of triangles. Whenever a circumcircle is not empty, the vertices
+of the triangle and the points inside the circle are flagged in the repair array (as is done by the
+GPU circumcircle test). The triangles are split over nThreads threads; the flags are collected per
+thread and written afterwards, so the result is independent of nThreads.
+\param triangleList the positions in the triangles array of the triangles to test
+\param triangles host pointer to the (i,j,k) vertex indices of every triangle
+\param repair host pointer to an array of length N; entries are set to 1 for flagged points, and are not otherwise changed
+\param tolerances if not NULL, tolerances[t] is set to the displacement tolerance of each empty triangle t (see testCircumcircle)
+\param nThreads the number of threads to use
+\param failedTriangles if not NULL, the positions (in the triangles array) of the non-empty triangles
+are appended, in the order of triangleList
+\return the number of non-empty circumcircles
+*/
+int DelaunayLoc::testCircumcircles(const vector<int> &triangleList, const int3 *triangles, int *repair,
+                                   Dscalar *tolerances, int nThreads, vector<int> *failedTriangles)
+    {
+    ArrayHandle<unsigned int> h_cs(cList->cell_sizes,access_location::host,access_mode::read);
+    ArrayHandle<int> h_idx(cList->idxs,access_location::host,access_mode::read);
+    const unsigned int *cellSizes = h_cs.data;
+    const int *cellIdxs = h_idx.data;
+
+    int nTests = triangleList.size();
+    vector<vector<int> > flagged(max(nThreads,1));
+    vector<vector<int> > failed(max(nThreads,1));
+    vector<int> failures(max(nThreads,1),0);
+    parallelBlocks(nTests,nThreads,[&](int begin, int end, int t)
+        {
+        vector<int> cns;
+        vector<int> intruders;
+        cns.reserve(25);
+        for (int tt = begin; tt < end; ++tt)
+            {
+            int triIdx = triangleList[tt];
+            Dscalar *tol = (tolerances == NULL) ? NULL : &tolerances[triIdx];
+            if(!testCircumcircle(triangles[triIdx],cellSizes,cellIdxs,cns,intruders,tol))
+                {
+                failures[t] += 1;
+                failed[t].push_back(triIdx);
+                flagged[t].push_back(triangles[triIdx].x);
+                flagged[t].push_back(triangles[triIdx].y);
+                flagged[t].push_back(triangles[triIdx].z);
+                flagged[t].insert(flagged[t].end(),intruders.begin(),intruders.end());
+                };
+            };
+        });
+
+    int totalFailures = 0;
+    for (int t = 0; t < failures.size(); ++t)
+        {
+        totalFailures += failures[t];
+        for (int ff = 0; ff < flagged[t].size(); ++ff)
+            repair[flagged[t][ff]] = 1;
+        if (failedTriangles != NULL)
+            failedTriangles->insert(failedTriangles->end(),failed[t].begin(),failed[t].end());
+        };
+    return totalFailures;
+    };
+
 /*!
 Test all circumcircles to see if they are empty, and flag particles for retriangulation if needed.
 \param ccs a vector of length (3*numberOfCircumcircles)
@@ -604,12 +1142,12 @@ void DelaunayLoc::testTriangulation(vector<int> &ccs, vector<bool> &points, bool
         Dscalar rad2 = radius*radius;
 
         //what cell indices to check
-        int cix = cList.positionToCellIndex(v.x+Q.x,v.y+Q.y);
-        int wcheck = ceil(radius/cList.getBoxsize())+1;
-        cList.getCellNeighbors(cix,wcheck,cns);
+        int cix = cList->positionToCellIndex(v.x+Q.x,v.y+Q.y);
+        int wcheck = ceil(radius/cList->getBoxsize())+1;
+        cList->getCellNeighbors(cix,wcheck,cns);
 
-        ArrayHandle<unsigned int> h_cs(cList.cell_sizes,access_location::host,access_mode::read);
-        ArrayHandle<int> h_idx(cList.idxs,access_location::host,access_mode::read);
+        ArrayHandle<unsigned int> h_cs(cList->cell_sizes,access_location::host,access_mode::read);
+        ArrayHandle<int> h_idx(cList->idxs,access_location::host,access_mode::read);
         for (int cc = 0; cc < cns.size(); ++cc)
             {
             if (repeat) continue;
@@ -618,7 +1156,7 @@ void DelaunayLoc::testTriangulation(vector<int> &ccs, vector<bool> &points, bool
                 {
                 if (repeat) continue;
 
-                int idx = h_idx.data[cList.cell_list_indexer(pp,cns[cc])];
+                int idx = h_idx.data[cList->cell_list_indexer(pp,cns[cc])];
                 Box->minDist(pts[idx],v,disp);
                 //how far is the point from the circumcircle's center?
                 Box->minDist(disp,Q,tocenter);
@@ -122,6 +122,27 @@ void Simple2DActiveCell::cellDeath(int cellIndex)
     removeGPUArrayElement(Motility,cellIndex);
     };
 
+/*!
+This function supports batches of cell divisions and deaths (see Simple2DCell::rebuildCellArrays).
+The new cells copy the motility of their parent cells and get random directors, drawn in order.
+*/
+void Simple2DActiveCell::rebuildCellArrays(const vector<int> &cellSources, int newCells)
+    {
+    Simple2DCell::rebuildCellArrays(cellSources,newCells);
+    gatherGPUArrayElements(cellDirectors,cellSources);
+    gatherGPUArrayElements(Motility,cellSources);
+    noise.Reproducible = Reproducible;
+    ArrayHandle<Dscalar2> h_mot(Motility,access_location::host,access_mode::read);
+    ArrayHandle<Dscalar> h_cd(cellDirectors);
+    ArrayHandle<Dscalar2> h_v(cellVelocities);
+    for (int ii = Ncells-newCells; ii < Ncells; ++ii)
+        {
+        h_cd.data[ii] = noise.getRealUniform(0.,2*PI);
+        h_v.data[ii].x = h_mot.data[ii].x*cos(h_cd.data[ii]);
+        h_v.data[ii].y = h_mot.data[ii].x*sin(h_cd.data[ii]);
+        };
+    };
+
 /*!
 This function supports cellDivisions, updating data structures in Simple2DActiveCell
 This function will first call Simple2DCell's routine, and then
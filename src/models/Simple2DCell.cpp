@@ -8,7 +8,7 @@
 An extremely simple constructor that does nothing, but enforces default GPU operation
 */
 Simple2DCell::Simple2DCell() :
-    Ncells(0), Nvertices(0),GPUcompute(true),Energy(-1.0)
+    Ncells(0), Nvertices(0),GPUcompute(true),nThreads(1),accumulation(accumulator_precision::extended),Energy(-1.0)
     {
     forcesUpToDate = false;
     Box = make_shared<gpubox>();
@@ -809,6 +809,59 @@ void Simple2DCell::cellDeath(int cellIndex)
     removeGPUArrayElement(cellPositions,cellIndex);
     };
 
+/*!
+This function supports batches of cell divisions and deaths, replacing the repeated
+removeGPUArrayElement and growGPUArray calls of cellDeath and cellDivision by a single gather per array.
+\param cellSources the new cell i takes the data of the old cell cellSources[i]. The last newCells
+entries are newly created cells (copies of their parent cells, with zero velocity); every other old
+cell that is not listed is removed
+\param newCells the number of newly created cells
+\post the arrays and tags are exactly as if the new cells had been created by cellDivision, in order,
+and the removed cells then killed by cellDeath
+*/
+void Simple2DCell::rebuildCellArrays(const vector<int> &cellSources, int newCells)
+    {
+    int oldNcells = Ncells;
+    Ncells = cellSources.size();
+    forcesUpToDate=false;
+    n_idx = Index2D(vertexMax,Ncells);
+    int firstNewCell = Ncells - newCells;
+
+    //surviving cells keep their tags, in order, and the new cells get new tags at the end
+    vector<int> newIndex(oldNcells,-1);
+    for (int ii = 0; ii < firstNewCell; ++ii)
+        newIndex[cellSources[ii]] = ii;
+    vector<int> newTagToIdx;
+    newTagToIdx.reserve(Ncells);
+    for (int tag = 0; tag < oldNcells; ++tag)
+        {
+        int idx = newIndex[tagToIdx[tag]];
+        if (idx >= 0)
+            newTagToIdx.push_back(idx);
+        };
+    for (int ii = firstNewCell; ii < Ncells; ++ii)
+        newTagToIdx.push_back(ii);
+    tagToIdx = newTagToIdx;
+    idxToTag.resize(Ncells);
+    for (int ii = 0; ii < Ncells; ++ii)
+        idxToTag[tagToIdx[ii]] = ii;
+    itt.resize(Ncells);
+    tti.resize(Ncells);
+
+    //AreaPeri will have its values updated in a geometry routine... just change the length
+    AreaPeri.resize(Ncells);
+    gatherGPUArrayElements(AreaPeriPreferences,cellSources);
+    gatherGPUArrayElements(Moduli,cellSources);
+    gatherGPUArrayElements(cellMasses,cellSources);
+    gatherGPUArrayElements(cellVelocities,cellSources);
+    gatherGPUArrayElements(cellType,cellSources);
+    gatherGPUArrayElements(cellPositions,cellSources);
+
+    ArrayHandle<Dscalar2> h_v(cellVelocities);
+    for (int ii = firstNewCell; ii < Ncells; ++ii)
+        h_v.data[ii] = make_Dscalar2(0.0,0.0);
+    };
+
 /*!
 This function supports cellDivisions, updating data structures in Simple2DCell
 This function will grow the cell lists by 1 and assign the new cell
@@ -3,6 +3,7 @@
 #include "vertexModelBase.h"
 #include "vertexModelBase.cuh"
 #include "voronoiQuadraticEnergy.h"
+#include "parallelLoops.h"
 /*! \file vertexModelBase.cpp */
 
 /*!
@@ -14,6 +15,8 @@ void vertexModelBase::moveDegreesOfFreedom(GPUArray<Dscalar2> &displacements,Dsc
     //handle things either on the GPU or CPU
     if (GPUcompute)
         {
+        //the displacements are not seen on the host, so the short-edge watch list must be rebuilt
+        invalidateT1WatchList();
         ArrayHandle<Dscalar2> d_d(displacements,access_location::device,access_mode::read);
         ArrayHandle<Dscalar2> d_v(vertexPositions,access_location::device,access_mode::readwrite);
         if (scale == 1.)
@@ -25,6 +28,8 @@ void vertexModelBase::moveDegreesOfFreedom(GPUArray<Dscalar2> &displacements,Dsc
         {
         ArrayHandle<Dscalar2> h_disp(displacements,access_location::host,access_mode::read);
         ArrayHandle<Dscalar2> h_v(vertexPositions,access_location::host,access_mode::readwrite);
+        //keep track of the largest displacement for the short-edge watch list
+        Dscalar maxDisp2 = 0.0;
         if(scale ==1.)
             {
             for (int i = 0; i < Nvertices; ++i)
@@ -32,6 +37,8 @@ void vertexModelBase::moveDegreesOfFreedom(GPUArray<Dscalar2> &displacements,Dsc
                 h_v.data[i].x += h_disp.data[i].x;
                 h_v.data[i].y += h_disp.data[i].y;
                 Box->putInBoxReal(h_v.data[i]);
+                Dscalar disp2 = h_disp.data[i].x*h_disp.data[i].x+h_disp.data[i].y*h_disp.data[i].y;
+                if (disp2 > maxDisp2) maxDisp2 = disp2;
                 };
             }
         else
@@ -41,8 +48,12 @@ void vertexModelBase::moveDegreesOfFreedom(GPUArray<Dscalar2> &displacements,Dsc
                 h_v.data[i].x += scale*h_disp.data[i].x;
                 h_v.data[i].y += scale*h_disp.data[i].y;
                 Box->putInBoxReal(h_v.data[i]);
+                Dscalar disp2 = h_disp.data[i].x*h_disp.data[i].x+h_disp.data[i].y*h_disp.data[i].y;
+                if (disp2 > maxDisp2) maxDisp2 = disp2;
                 };
             }
+        //an edge shortens by at most the sum of the displacements of its vertices
+        T1WatchShortening += 2.0*fabs(scale)*sqrt(maxDisp2);
         };
     };
 
@@ -57,6 +68,9 @@ void vertexModelBase::initializeVertexModelBase(int n,bool spvInitialize)
     //derive the vertices from a voronoi tesselation
     setCellsVoronoiTesselation(spvInitialize);
 
+    T1WatchHorizon = 0.2;
+    T1WatchShortening = 0.0;
+    T1ClaimRound = 0;
     setT1Threshold(0.01);
     //initializes per-cell lists
     initializeCellSorting();
@@ -239,6 +253,7 @@ void vertexModelBase::spatialSorting()
     spatiallySortVerticesAndCellActivity();
     reIndexVertexArray(vertexMasses);
     reIndexVertexArray(vertexVelocities);
+    invalidateT1WatchList();
     };
 
 /*!
@@ -255,8 +270,8 @@ void vertexModelBase::computeGeometryCPU()
     ArrayHandle<Dscalar4> h_vln(voroLastNext,access_location::host,access_mode::readwrite);
     ArrayHandle<Dscalar2> h_AP(AreaPeri,access_location::host,access_mode::readwrite);
 
-    //compute the geometry for each cell
-    for (int i = 0; i < Ncells; ++i)
+    //compute the geometry for each cell; each (vertex,cell) pair is written by one cell only, so cells can be split over threads
+    parallelFor(Ncells,nThreads,[&](int i)
         {
         int neighs = h_nn.data[i];
 //      Define the vertices of a cell relative to some (any) of its verties to take care of periodic boundaries
@@ -293,7 +308,7 @@ void vertexModelBase::computeGeometryCPU()
             };
         h_AP.data[i].x = Varea;
         h_AP.data[i].y = Vperi;
-        };
+        });
     };
 
 /*!
@@ -462,20 +477,33 @@ void vertexModelBase::initializeEdgeFlipLists()
         h_vflipc.data[i]=0;
         }
 
+    //vertex indices may have changed
+    invalidateT1WatchList();
+
     finishedFlippingEdges.resize(2);
     ArrayHandle<int> h_ffe(finishedFlippingEdges,access_location::host,access_mode::overwrite);
     h_ffe.data[0]=0;
     h_ffe.data[1]=0;
     };
 
+/*!
+The number of slots per cell of cellVertices after growing it to hold at least newVertexMax slots per cell.
+The capacity grows geometrically, so that the copies made as cells keep gaining vertices (e.g. in
+proliferating tissues) cost amortized O(1) per added vertex instead of O(vertexMax*Ncells) each time.
+*/
+int vertexModelBase::amortizedVertexMax(int newVertexMax)
+    {
+    return max(newVertexMax,vertexMax+vertexMax/2);
+    };
+
 /*!
 when a transition increases the maximum number of vertices around any cell in the system,
-call this function first to copy over the cellVertices structure into a larger array
+call this function first to copy over the cellVertices structure into a larger array. Every routine
+reads cellVertices through n_idx, so only the indexer and the array change.
  */
 void vertexModelBase::growCellVerticesList(int newVertexMax)
     {
-    cout << "maximum number of vertices per cell grew from " <<vertexMax << " to " << newVertexMax << endl;
-    vertexMax = newVertexMax+1;
+    vertexMax = amortizedVertexMax(newVertexMax+1);
     Index2D old_idx = n_idx;
     n_idx = Index2D(vertexMax,Ncells);
 
@@ -502,44 +530,32 @@ void vertexModelBase::growCellVerticesList(int newVertexMax)
 /*!
 A utility function for the CPU T1 transition routine. Given two vertex indices representing an edge that will undergo
 a T1 transition, return in the pass-by-reference variables a helpful representation of the cells in the T1
-and the vertices to be re-wired...see the comments in "testAndPerformT1TransitionsCPU" for what that representation is
+and the vertices to be re-wired...see the comments in "performT1TransitionCPU" for what that representation is.
+It only reads the host arrays it is handed, so it can be called for many edges at once.
 */
-void vertexModelBase::getCellVertexSetForT1(int vertex1, int vertex2, int4 &cellSet, int4 &vertexSet, bool &growList)
+void vertexModelBase::getCellVertexSetForT1(int vertex1, int vertex2, int4 &cellSet, int4 &vertexSet, bool &growList,
+                                            const int *h_cv, const int *h_cvn, const int *h_vcn)
     {
     int cell1,cell2,cell3,ctest;
     int vlast, vcur, vnext, cneigh;
-    ArrayHandle<int> h_cv(cellVertices,access_location::host, access_mode::read);
-    ArrayHandle<int> h_cvn(cellVertexNum,access_location::host,access_mode::read);
-    ArrayHandle<int> h_vcn(vertexCellNeighbors,access_location::host,access_mode::read);
-    cell1 = h_vcn.data[3*vertex1];
-    cell2 = h_vcn.data[3*vertex1+1];
-    cell3 = h_vcn.data[3*vertex1+2];
+    cell1 = h_vcn[3*vertex1];
+    cell2 = h_vcn[3*vertex1+1];
+    cell3 = h_vcn[3*vertex1+2];
     //cell_l doesn't contain vertex 1, so it is the cell neighbor of vertex 2 we haven't found yet
     for (int ff = 0; ff < 3; ++ff)
         {
-        ctest = h_vcn.data[3*vertex2+ff];
+        ctest = h_vcn[3*vertex2+ff];
         if(ctest != cell1 && ctest != cell2 && ctest != cell3)
             cellSet.w=ctest;
         };
-    //find vertices "c" and "d"
-    cneigh = h_cvn.data[cellSet.w];
-    vlast = h_cv.data[ n_idx(cneigh-2,cellSet.w) ];
-    vcur = h_cv.data[ n_idx(cneigh-1,cellSet.w) ];
-    for (int cn = 0; cn < cneigh; ++cn)
-        {
-        vnext = h_cv.data[n_idx(cn,cell1)];
-        if(vcur == vertex2) break;
-        vlast = vcur;
-        vcur = vnext;
-        };
 
     //classify cell1
-    cneigh = h_cvn.data[cell1];
-    vlast = h_cv.data[ n_idx(cneigh-2,cell1) ];
-    vcur = h_cv.data[ n_idx(cneigh-1,cell1) ];
+    cneigh = h_cvn[cell1];
+    vlast = h_cv[ n_idx(cneigh-2,cell1) ];
+    vcur = h_cv[ n_idx(cneigh-1,cell1) ];
     for (int cn = 0; cn < cneigh; ++cn)
         {
-        vnext = h_cv.data[n_idx(cn,cell1)];
+        vnext = h_cv[n_idx(cn,cell1)];
         if(vcur == vertex1) break;
         vlast = vcur;
         vcur = vnext;
@@ -554,12 +570,12 @@ void vertexModelBase::getCellVertexSetForT1(int vertex1, int vertex2, int4 &cell
         };
 
     //classify cell2
-    cneigh = h_cvn.data[cell2];
-    vlast = h_cv.data[ n_idx(cneigh-2,cell2) ];
-    vcur = h_cv.data[ n_idx(cneigh-1,cell2) ];
+    cneigh = h_cvn[cell2];
+    vlast = h_cv[ n_idx(cneigh-2,cell2) ];
+    vcur = h_cv[ n_idx(cneigh-1,cell2) ];
     for (int cn = 0; cn < cneigh; ++cn)
         {
-        vnext = h_cv.data[n_idx(cn,cell2)];
+        vnext = h_cv[n_idx(cn,cell2)];
         if(vcur == vertex1) break;
         vlast = vcur;
         vcur = vnext;
@@ -574,12 +590,12 @@ void vertexModelBase::getCellVertexSetForT1(int vertex1, int vertex2, int4 &cell
         };
 
     //classify cell3
-    cneigh = h_cvn.data[cell3];
-    vlast = h_cv.data[ n_idx(cneigh-2,cell3) ];
-    vcur = h_cv.data[ n_idx(cneigh-1,cell3) ];
+    cneigh = h_cvn[cell3];
+    vlast = h_cv[ n_idx(cneigh-2,cell3) ];
+    vcur = h_cv[ n_idx(cneigh-1,cell3) ];
     for (int cn = 0; cn < cneigh; ++cn)
         {
-        vnext = h_cv.data[n_idx(cn,cell3)];
+        vnext = h_cv[n_idx(cn,cell3)];
         if(vcur == vertex1) break;
         vlast = vcur;
         vcur = vnext;
@@ -594,24 +610,24 @@ void vertexModelBase::getCellVertexSetForT1(int vertex1, int vertex2, int4 &cell
         };
 
     //get the vertexSet by examining cells j and l
-    cneigh = h_cvn.data[cellSet.y];
-    vlast = h_cv.data[ n_idx(cneigh-2,cellSet.y) ];
-    vcur = h_cv.data[ n_idx(cneigh-1,cellSet.y) ];
+    cneigh = h_cvn[cellSet.y];
+    vlast = h_cv[ n_idx(cneigh-2,cellSet.y) ];
+    vcur = h_cv[ n_idx(cneigh-1,cellSet.y) ];
     for (int cn = 0; cn < cneigh; ++cn)
         {
-        vnext = h_cv.data[n_idx(cn,cellSet.y)];
+        vnext = h_cv[n_idx(cn,cellSet.y)];
         if(vcur == vertex1) break;
         vlast = vcur;
         vcur = vnext;
         };
     vertexSet.x=vlast;
     vertexSet.y=vnext;
-    cneigh = h_cvn.data[cellSet.w];
-    vlast = h_cv.data[ n_idx(cneigh-2,cellSet.w) ];
-    vcur = h_cv.data[ n_idx(cneigh-1,cellSet.w) ];
+    cneigh = h_cvn[cellSet.w];
+    vlast = h_cv[ n_idx(cneigh-2,cellSet.w) ];
+    vcur = h_cv[ n_idx(cneigh-1,cellSet.w) ];
     for (int cn = 0; cn < cneigh; ++cn)
         {
-        vnext = h_cv.data[n_idx(cn,cellSet.w)];
+        vnext = h_cv[n_idx(cn,cellSet.w)];
         if(vcur == vertex2) break;
         vlast = vcur;
         vcur = vnext;
@@ -620,170 +636,377 @@ void vertexModelBase::getCellVertexSetForT1(int vertex1, int vertex2, int4 &cell
     vertexSet.z=vnext;
 
     //Does the cell-vertex-neighbor data structure need to be bigger...for safety check all cell-vertex numbers, even if it won't be incremented?
-    if(h_cvn.data[cellSet.x] == vertexMax || h_cvn.data[cellSet.y] == vertexMax || h_cvn.data[cellSet.z] == vertexMax || h_cvn.data[cellSet.w] == vertexMax)
+    if(h_cvn[cellSet.x] == vertexMax || h_cvn[cellSet.y] == vertexMax || h_cvn[cellSet.z] == vertexMax || h_cvn[cellSet.w] == vertexMax)
         growList = true;
     };
 
 /*!
 Test whether a T1 needs to be performed on any edge by simply checking if the edge length is beneath a threshold.
-This function also performs the transition and maintains the auxiliary data structures
+This function also performs the transitions and maintains the auxiliary data structures. The edges are first
+tested in parallel (testEdgesForT1CPU), and the transitions are then performed in rounds of at most one transition
+per cell (flipEdgesCPU), mirroring the GPU routine.
  */
 void vertexModelBase::testAndPerformT1TransitionsCPU()
     {
-    ArrayHandle<Dscalar2> h_v(vertexPositions,access_location::host,access_mode::readwrite);
-    ArrayHandle<int> h_vn(vertexNeighbors,access_location::host,access_mode::readwrite);
-    ArrayHandle<int> h_cvn(cellVertexNum,access_location::host,access_mode::readwrite);
-    ArrayHandle<int> h_cv(cellVertices,access_location::host,access_mode::readwrite);
-    ArrayHandle<int> h_vcn(vertexCellNeighbors,access_location::host,access_mode::readwrite);
+    testEdgesForT1CPU();
+    flipEdgesCPU();
+    };
 
-    Dscalar2 edge;
-    //first, scan through the list for any T1 transitions...
-    int vertex2;
-    //keep track of whether vertexMax needs to be increased
-    int vMax = vertexMax;
-    /*
-     The following is the convention:
-     cell i: contains both vertex 1 and vertex 2, in CW order
-     cell j: contains only vertex 1
-     cell k: contains both vertex 1 and vertex 2, in CCW order
-     cell l: contains only vertex 2
-     */
-    int4 cellSet;
-    /*
-    vertexSet (a,b,c,d) have those indices in which before the transition
-    cell i has CCW vertices: ..., c, v2, v1, a, ...
-    and
-    cell k has CCW vertices: ..., b,v1,v2,d, ...
-    */
-    int4 vertexSet;
-    Dscalar2 v1,v2;
-    for (int vertex1 = 0; vertex1 < Nvertices; ++vertex1)
+/*!
+Find every edge shorter than T1Threshold, each edge (vertex1,vertex2) being listed once with vertex1 < vertex2.
+Measuring every edge each time is wasteful, since an edge can only have shortened by the sum of the
+displacements of its vertices since it was last measured. moveDegreesOfFreedom accumulates an upper
+bound on that, T1WatchShortening, and the short-edge watch list files each edge by the value of the
+bound at which it might reach T1Threshold, in equal-width buckets up to T1WatchHorizon. Only the edges
+in the buckets the bound has reached are re-measured (and filed again), which for dense tissues is a
+small fraction of all edges. Every edge is measured, split over nThreads threads, when the list is
+rebuilt: the first time, once the bound passes the horizon, or after anything (spatial sorting, cell
+division or death, GPU steps, a change of the box or of T1Threshold) invalidates it.
+\post t1Candidates holds the short edges, sorted
+*/
+void vertexModelBase::testEdgesForT1CPU()
+    {
+    Dscalar4 box;
+    Box->getBoxDims(box.x,box.y,box.z,box.w);
+    bool sameBox = box.x == T1WatchBox.x && box.y == T1WatchBox.y && box.z == T1WatchBox.z && box.w == T1WatchBox.w;
+    t1Candidates.clear();
+    ArrayHandle<Dscalar2> h_v(vertexPositions,access_location::host,access_mode::read);
+    ArrayHandle<int> h_vn(vertexNeighbors,access_location::host,access_mode::read);
+
+    if(T1WatchListValid && sameBox && T1WatchShortening < T1WatchHorizon)
         {
-        v1 = h_v.data[vertex1];
-        //look at vertexNeighbors list for neighbors of vertex, compute edge length
-        for (int vv = 0; vv < 3; ++vv)
+        //re-measure the edges that might have reached the threshold
+        Dscalar width = T1WatchHorizon/T1WatchBuckets.size();
+        int hottest = min((int)T1WatchBuckets.size()-1,(int)(T1WatchShortening/width));
+        vector<int2> hot;
+        for (int b = 0; b <= hottest; ++b)
+            {
+            hot.insert(hot.end(),T1WatchBuckets[b].begin(),T1WatchBuckets[b].end());
+            T1WatchBuckets[b].clear();
+            };
+        for (int e = 0; e < hot.size(); ++e)
             {
-            vertex2 = h_vn.data[3*vertex1+vv];
-            //only look at each pair once
-            if(vertex1 < vertex2)
+            int vertex1 = hot[e].x;
+            int vertex2 = hot[e].y;
+            //the edge may have been removed by a T1 transition
+            if(h_vn.data[3*vertex1] != vertex2 && h_vn.data[3*vertex1+1] != vertex2 && h_vn.data[3*vertex1+2] != vertex2)
+                continue;
+            Dscalar2 edge;
+            Box->minDist(h_v.data[vertex1],h_v.data[vertex2],edge);
+            Dscalar length = norm(edge);
+            if(length < T1Threshold)
+                t1Candidates.push_back(hot[e]);
+            watchEdgeForT1(vertex1,vertex2,length);
+            };
+        }
+    else
+        {
+        //measure every edge, and rebuild the watch list
+        int nBuckets = T1WatchHorizon > 0 ? 32 : 0;
+        Dscalar width = T1WatchHorizon/max(nBuckets,1);
+        int threads = max(1,min(nThreads,Nvertices));
+        vector<vector<int2> > shortEdges(threads);
+        vector<vector<vector<int2> > > watched(threads,vector<vector<int2> >(nBuckets));
+        parallelBlocks(Nvertices,threads,[&](int begin, int end, int t)
+            {
+            for (int vertex1 = begin; vertex1 < end; ++vertex1)
                 {
-                v2 = h_v.data[vertex2];
-                Box->minDist(v1,v2,edge);
-                if(norm(edge) < T1Threshold)
+                Dscalar2 v1 = h_v.data[vertex1];
+                for (int vv = 0; vv < 3; ++vv)
                     {
-                    bool growCellVertexList = false;
-                    getCellVertexSetForT1(vertex1,vertex2,cellSet,vertexSet,growCellVertexList);
-                    //forbid a T1 transition that would shrink a triangular cell
-                    if( h_cvn.data[cellSet.x] == 3 || h_cvn.data[cellSet.z] == 3)
+                    int vertex2 = h_vn.data[3*vertex1+vv];
+                    //only look at each pair once
+                    if(vertex1 > vertex2)
                         continue;
-                    //Does the cell-vertex-neighbor data structure need to be bigger?
-                    if(growCellVertexList)
-                        {
-                        vMax +=1;
-                        growCellVerticesList(vMax);
-                        h_cv = ArrayHandle<int>(cellVertices,access_location::host,access_mode::readwrite);
-                        };
-
-                    //Rotate the vertices in the edge and set them at twice their original distance
-                    Dscalar2 midpoint;
-                    midpoint.x = v2.x + 0.5*edge.x;
-                    midpoint.y = v2.y + 0.5*edge.y;
-
-                    v1.x = midpoint.x-edge.y;
-                    v1.y = midpoint.y+edge.x;
-                    v2.x = midpoint.x+edge.y;
-                    v2.y = midpoint.y-edge.x;
-                    Box->putInBoxReal(v1);
-                    Box->putInBoxReal(v2);
-                    h_v.data[vertex1] = v1;
-                    h_v.data[vertex2] = v2;
-
-                    //re-wire the cells and vertices
-                    //start with the vertex-vertex and vertex-cell  neighbors
-                    for (int vert = 0; vert < 3; ++vert)
-                        {
-                        //vertex-cell neighbors
-                        if(h_vcn.data[3*vertex1+vert] == cellSet.z)
-                            h_vcn.data[3*vertex1+vert] = cellSet.w;
-                        if(h_vcn.data[3*vertex2+vert] == cellSet.x)
-                            h_vcn.data[3*vertex2+vert] = cellSet.y;
-                        //vertex-vertex neighbors
-                        if(h_vn.data[3*vertexSet.y+vert] == vertex1)
-                            h_vn.data[3*vertexSet.y+vert] = vertex2;
-                        if(h_vn.data[3*vertexSet.z+vert] == vertex2)
-                            h_vn.data[3*vertexSet.z+vert] = vertex1;
-                        if(h_vn.data[3*vertex1+vert] == vertexSet.y)
-                            h_vn.data[3*vertex1+vert] = vertexSet.z;
-                        if(h_vn.data[3*vertex2+vert] == vertexSet.z)
-                            h_vn.data[3*vertex2+vert] = vertexSet.y;
-                        };
-                    //now rewire the cells
-                    //cell i loses v2 as a neighbor
-                    int cneigh = h_cvn.data[cellSet.x];
-                    int cidx = 0;
-                    for (int cc = 0; cc < cneigh-1; ++cc)
-                        {
-                        if(h_cv.data[n_idx(cc,cellSet.x)] == vertex2)
-                            cidx +=1;
-                        h_cv.data[n_idx(cc,cellSet.x)] = h_cv.data[n_idx(cidx,cellSet.x)];
-                        cidx +=1;
-                        };
-                    h_cvn.data[cellSet.x] -= 1;
-
-                    //cell j gains v2 in between v1 and b
-                    cneigh = h_cvn.data[cellSet.y];
-                    vector<int> cvcopy1(cneigh+1);
-                    cidx = 0;
-                    for (int cc = 0; cc < cneigh; ++cc)
-                        {
-                        int cellIndex = h_cv.data[n_idx(cc,cellSet.y)];
-                        cvcopy1[cidx] = cellIndex;
-                        cidx +=1;
-                        if(cellIndex == vertex1)
-                            {
-                            cvcopy1[cidx] = vertex2;
-                            cidx +=1;
-                            };
-                        };
-                    for (int cc = 0; cc < cneigh+1; ++cc)
-                        h_cv.data[n_idx(cc,cellSet.y)] = cvcopy1[cc];
-                    h_cvn.data[cellSet.y] += 1;
-
-                    //cell k loses v1 as a neighbor
-                    cneigh = h_cvn.data[cellSet.z];
-                    cidx = 0;
-                    for (int cc = 0; cc < cneigh-1; ++cc)
-                        {
-                        if(h_cv.data[n_idx(cc,cellSet.z)] == vertex1)
-                            cidx +=1;
-                        h_cv.data[n_idx(cc,cellSet.z)] = h_cv.data[n_idx(cidx,cellSet.z)];
-                        cidx +=1;
-                        };
-                    h_cvn.data[cellSet.z] -= 1;
-
-                    //cell l gains v1 in between v2 and a
-                    cneigh = h_cvn.data[cellSet.w];
-                    vector<int> cvcopy2(cneigh+1);
-                    cidx = 0;
-                    for (int cc = 0; cc < cneigh; ++cc)
-                        {
-                        int cellIndex = h_cv.data[n_idx(cc,cellSet.w)];
-                        cvcopy2[cidx] = cellIndex;
-                        cidx +=1;
-                        if(cellIndex == vertex2)
-                            {
-                            cvcopy2[cidx] = vertex1;
-                            cidx +=1;
-                            };
-                        };
-                    for (int cc = 0; cc < cneigh+1; ++cc)
-                        h_cv.data[n_idx(cc,cellSet.w)] = cvcopy2[cc];
-                    h_cvn.data[cellSet.w] = cneigh + 1;
-
-                    };//end condition that a T1 transition should occur
+                    Dscalar2 edge;
+                    Box->minDist(v1,h_v.data[vertex2],edge);
+                    Dscalar slack = norm(edge) - T1Threshold;
+                    if(slack < 0)
+                        shortEdges[t].push_back(make_int2(vertex1,vertex2));
+                    if(nBuckets > 0 && slack < T1WatchHorizon)
+                        watched[t][slack > 0 ? min(nBuckets-1,(int)(slack/width)) : 0].push_back(make_int2(vertex1,vertex2));
+                    };
                 };
-            };//end loop over vertex2
-        };//end loop over vertices
+            });
+        T1WatchBuckets.assign(nBuckets,vector<int2>());
+        for (int t = 0; t < threads; ++t)
+            {
+            t1Candidates.insert(t1Candidates.end(),shortEdges[t].begin(),shortEdges[t].end());
+            for (int b = 0; b < nBuckets; ++b)
+                T1WatchBuckets[b].insert(T1WatchBuckets[b].end(),watched[t][b].begin(),watched[t][b].end());
+            };
+        T1WatchShortening = 0.0;
+        T1WatchBox = box;
+        T1WatchListValid = nBuckets > 0;
+        };
+    //an edge may have been filed more than once
+    if(t1Candidates.size() < 2)
+        return;
+    sort(t1Candidates.begin(),t1Candidates.end(),[](const int2 &a, const int2 &b){return a.x < b.x || (a.x == b.x && a.y < b.y);});
+    t1Candidates.erase(unique(t1Candidates.begin(),t1Candidates.end(),[](const int2 &a, const int2 &b){return a.x == b.x && a.y == b.y;}),
+                       t1Candidates.end());
+    };
+
+/*!
+\param v1 the first vertex of the edge
+\param v2 the second vertex of the edge
+\param length the current length of the edge
+The edge is re-measured once T1WatchShortening reaches T1WatchShortening + length - T1Threshold; an edge
+that cannot reach the threshold before the watch list is rebuilt is not filed.
+*/
+void vertexModelBase::watchEdgeForT1(int v1, int v2, Dscalar length)
+    {
+    Dscalar key = T1WatchShortening + length - T1Threshold;
+    if(key >= T1WatchHorizon)
+        return;
+    int nBuckets = T1WatchBuckets.size();
+    int b = key > 0 ? min(nBuckets-1,(int)(key/(T1WatchHorizon/nBuckets))) : 0;
+    T1WatchBuckets[b].push_back(make_int2(min(v1,v2),max(v1,v2)));
+    };
+
+/*!
+Perform the T1 transitions of the edges in t1Candidates. As in flipEdgesGPU, a cell may take part in at most
+one transition per round: each round re-tests the remaining edges (an earlier transition may have moved or
+re-wired them) and finds the cells involved in parallel, claims the cells of the edges in list order, and then
+performs the transitions that could claim all four of their cells in parallel. Transitions in the same round
+touch disjoint sets of cells and vertices. Edges that lost a claim are deferred to the next round. Since the
+claims are made in list order, the result does not depend on nThreads.
+\post every T1 transition found by testEdgesForT1CPU has been performed (or ruled out), and t1Candidates is empty
+*/
+void vertexModelBase::flipEdgesCPU()
+    {
+    //most steps have no short edges
+    if(t1Candidates.empty())
+        return;
+    //claims are stamped with the round number, which keeps increasing between calls, so the claims
+    //never need to be cleared; they are only re-allocated when the number of cells changes
+    if(T1CellClaims.size() != Ncells || T1ClaimRound > numeric_limits<int>::max() - (int)t1Candidates.size())
+        {
+        T1CellClaims.assign(Ncells,0);
+        T1ClaimRound = 0;
+        };
+    //0: no transition; 1: perform it; 2: perform it, but the cellVertices list must grow first
+    vector<int> flipStatus;
+    vector<int4> flipCellSets, flipVertexSets;
+    vector<int> &cellClaims = T1CellClaims;
+    vector<int> selected;
+    vector<int2> deferred;
+    while(!t1Candidates.empty())
+        {
+        T1ClaimRound += 1;
+        int round = T1ClaimRound;
+        int nCandidates = t1Candidates.size();
+        flipStatus.assign(nCandidates,0);
+        flipCellSets.resize(nCandidates);
+        flipVertexSets.resize(nCandidates);
+        {//scope for array handles
+        ArrayHandle<Dscalar2> h_v(vertexPositions,access_location::host,access_mode::read);
+        ArrayHandle<int> h_vn(vertexNeighbors,access_location::host,access_mode::read);
+        ArrayHandle<int> h_cvn(cellVertexNum,access_location::host,access_mode::read);
+        ArrayHandle<int> h_cv(cellVertices,access_location::host,access_mode::read);
+        ArrayHandle<int> h_vcn(vertexCellNeighbors,access_location::host,access_mode::read);
+        parallelFor(nCandidates,nThreads,[&](int e)
+            {
+            int vertex1 = t1Candidates[e].x;
+            int vertex2 = t1Candidates[e].y;
+            if(h_vn.data[3*vertex1] != vertex2 && h_vn.data[3*vertex1+1] != vertex2 && h_vn.data[3*vertex1+2] != vertex2)
+                return;
+            Dscalar2 edge;
+            Box->minDist(h_v.data[vertex1],h_v.data[vertex2],edge);
+            if(norm(edge) >= T1Threshold)
+                return;
+            bool growList = false;
+            int4 cellSet = make_int4(-1,-1,-1,-1);
+            getCellVertexSetForT1(vertex1,vertex2,cellSet,flipVertexSets[e],growList,h_cv.data,h_cvn.data,h_vcn.data);
+            if(cellSet.x <0 || cellSet.y < 0 || cellSet.z <0 || cellSet.w <0)
+                return;
+            //forbid a T1 transition that would shrink a triangular cell
+            if( h_cvn.data[cellSet.x] == 3 || h_cvn.data[cellSet.z] == 3)
+                return;
+            flipCellSets[e] = cellSet;
+            flipStatus[e] = growList ? 2 : 1;
+            });
+        };//scope for array handles
+
+        //claim cells in list order
+        selected.clear();
+        deferred.clear();
+        bool growCellVertexList = false;
+        for (int e = 0; e < nCandidates; ++e)
+            {
+            if(flipStatus[e] == 0)
+                continue;
+            int4 cs = flipCellSets[e];
+            if(cellClaims[cs.x] == round || cellClaims[cs.y] == round || cellClaims[cs.z] == round || cellClaims[cs.w] == round)
+                {
+                deferred.push_back(t1Candidates[e]);
+                continue;
+                };
+            cellClaims[cs.x] = round;
+            cellClaims[cs.y] = round;
+            cellClaims[cs.z] = round;
+            cellClaims[cs.w] = round;
+            selected.push_back(e);
+            if(flipStatus[e] == 2)
+                growCellVertexList = true;
+            };
+        //each cell gains at most one vertex per round
+        if(growCellVertexList)
+            growCellVerticesList(vertexMax+1);
+
+        {//scope for array handles
+        ArrayHandle<Dscalar2> h_v(vertexPositions,access_location::host,access_mode::readwrite);
+        ArrayHandle<int> h_vn(vertexNeighbors,access_location::host,access_mode::readwrite);
+        ArrayHandle<int> h_cvn(cellVertexNum,access_location::host,access_mode::readwrite);
+        ArrayHandle<int> h_cv(cellVertices,access_location::host,access_mode::readwrite);
+        ArrayHandle<int> h_vcn(vertexCellNeighbors,access_location::host,access_mode::readwrite);
+        parallelFor(selected.size(),nThreads,[&](int s)
+            {
+            int e = selected[s];
+            performT1TransitionCPU(t1Candidates[e].x,t1Candidates[e].y,flipCellSets[e],flipVertexSets[e],
+                                   h_v.data,h_vn.data,h_cvn.data,h_cv.data,h_vcn.data);
+            });
+        //the edges of the flipped vertices have new lengths, and some are new edges
+        if(T1WatchListValid)
+            for (int s = 0; s < selected.size(); ++s)
+                {
+                int2 flipped = t1Candidates[selected[s]];
+                for (int vv = 0; vv < 6; ++vv)
+                    {
+                    int vertex1 = vv < 3 ? flipped.x : flipped.y;
+                    int vertex2 = h_vn.data[3*vertex1+vv%3];
+                    if(vertex1 == flipped.y && vertex2 == flipped.x)
+                        continue;
+                    Dscalar2 edge;
+                    Box->minDist(h_v.data[vertex1],h_v.data[vertex2],edge);
+                    watchEdgeForT1(vertex1,vertex2,norm(edge));
+                    };
+                };
+        };//scope for array handles
+        t1Candidates.swap(deferred);
+        };
+    };
+
+/*!
+Rotate the edge (vertex1,vertex2) and rewire the cells and vertices around it. The following is the convention:
+ cell i: contains both vertex 1 and vertex 2, in CW order
+ cell j: contains only vertex 1
+ cell k: contains both vertex 1 and vertex 2, in CCW order
+ cell l: contains only vertex 2
+and vertexSet (a,b,c,d) have those indices in which before the transition
+ cell i has CCW vertices: ..., c, v2, v1, a, ...
+and
+ cell k has CCW vertices: ..., b,v1,v2,d, ...
+Only the four cells of cellSet and the vertices vertex1, vertex2, vertexSet.y and vertexSet.z are written.
+\param vertex1 the first vertex of the edge
+\param vertex2 the second vertex of the edge
+\param cellSet the cells (i,j,k,l) of the transition, as found by getCellVertexSetForT1
+\param vertexSet the vertices (a,b,c,d) of the transition, as found by getCellVertexSetForT1
+*/
+void vertexModelBase::performT1TransitionCPU(int vertex1, int vertex2, const int4 &cellSet, const int4 &vertexSet,
+                                             Dscalar2 *h_v, int *h_vn, int *h_cvn, int *h_cv, int *h_vcn)
+    {
+    Dscalar2 edge;
+    Dscalar2 v1 = h_v[vertex1];
+    Dscalar2 v2 = h_v[vertex2];
+    Box->minDist(v1,v2,edge);
+
+    //Rotate the vertices in the edge and set them at twice their original distance
+    Dscalar2 midpoint;
+    midpoint.x = v2.x + 0.5*edge.x;
+    midpoint.y = v2.y + 0.5*edge.y;
+
+    v1.x = midpoint.x-edge.y;
+    v1.y = midpoint.y+edge.x;
+    v2.x = midpoint.x+edge.y;
+    v2.y = midpoint.y-edge.x;
+    Box->putInBoxReal(v1);
+    Box->putInBoxReal(v2);
+    h_v[vertex1] = v1;
+    h_v[vertex2] = v2;
+
+    //re-wire the cells and vertices
+    //start with the vertex-vertex and vertex-cell  neighbors
+    for (int vert = 0; vert < 3; ++vert)
+        {
+        //vertex-cell neighbors
+        if(h_vcn[3*vertex1+vert] == cellSet.z)
+            h_vcn[3*vertex1+vert] = cellSet.w;
+        if(h_vcn[3*vertex2+vert] == cellSet.x)
+            h_vcn[3*vertex2+vert] = cellSet.y;
+        //vertex-vertex neighbors
+        if(h_vn[3*vertexSet.y+vert] == vertex1)
+            h_vn[3*vertexSet.y+vert] = vertex2;
+        if(h_vn[3*vertexSet.z+vert] == vertex2)
+            h_vn[3*vertexSet.z+vert] = vertex1;
+        if(h_vn[3*vertex1+vert] == vertexSet.y)
+            h_vn[3*vertex1+vert] = vertexSet.z;
+        if(h_vn[3*vertex2+vert] == vertexSet.z)
+            h_vn[3*vertex2+vert] = vertexSet.y;
+        };
+    //now rewire the cells
+    //cell i loses v2 as a neighbor
+    int cneigh = h_cvn[cellSet.x];
+    int cidx = 0;
+    for (int cc = 0; cc < cneigh-1; ++cc)
+        {
+        if(h_cv[n_idx(cc,cellSet.x)] == vertex2)
+            cidx +=1;
+        h_cv[n_idx(cc,cellSet.x)] = h_cv[n_idx(cidx,cellSet.x)];
+        cidx +=1;
+        };
+    h_cvn[cellSet.x] -= 1;
+
+    //cell j gains v2 in between v1 and b
+    cneigh = h_cvn[cellSet.y];
+    vector<int> cvcopy1(cneigh+1);
+    cidx = 0;
+    for (int cc = 0; cc < cneigh; ++cc)
+        {
+        int cellIndex = h_cv[n_idx(cc,cellSet.y)];
+        cvcopy1[cidx] = cellIndex;
+        cidx +=1;
+        if(cellIndex == vertex1)
+            {
+            cvcopy1[cidx] = vertex2;
+            cidx +=1;
+            };
+        };
+    for (int cc = 0; cc < cneigh+1; ++cc)
+        h_cv[n_idx(cc,cellSet.y)] = cvcopy1[cc];
+    h_cvn[cellSet.y] += 1;
+
+    //cell k loses v1 as a neighbor
+    cneigh = h_cvn[cellSet.z];
+    cidx = 0;
+    for (int cc = 0; cc < cneigh-1; ++cc)
+        {
+        if(h_cv[n_idx(cc,cellSet.z)] == vertex1)
+            cidx +=1;
+        h_cv[n_idx(cc,cellSet.z)] = h_cv[n_idx(cidx,cellSet.z)];
+        cidx +=1;
+        };
+    h_cvn[cellSet.z] -= 1;
+
+    //cell l gains v1 in between v2 and a
+    cneigh = h_cvn[cellSet.w];
+    vector<int> cvcopy2(cneigh+1);
+    cidx = 0;
+    for (int cc = 0; cc < cneigh; ++cc)
+        {
+        int cellIndex = h_cv[n_idx(cc,cellSet.w)];
+        cvcopy2[cidx] = cellIndex;
+        cidx +=1;
+        if(cellIndex == vertex2)
+            {
+            cvcopy2[cidx] = vertex1;
+            cidx +=1;
+            };
+        };
+    for (int cc = 0; cc < cneigh+1; ++cc)
+        h_cv[n_idx(cc,cellSet.w)] = cvcopy2[cc];
+    h_cvn[cellSet.w] = cneigh + 1;
+
     };
 
 /*!
@@ -899,6 +1122,7 @@ Because the cellVertexList might need to grow, it's convenient to break this int
 */
 void vertexModelBase::testAndPerformT1TransitionsGPU()
     {
+    invalidateT1WatchList();
     testEdgesForT1GPU();
     flipEdgesGPU();
     };
@@ -1229,10 +1453,7 @@ void vertexModelBase::cellDivision(const vector<int> &parameters, const vector<D
     //update cell and vertex number; have access to both new and old indexer if vertexMax changes
     Index2D n_idxOld(vertexMax,Ncells);
     if (increaseVertexMax)
-        {
-        printf("vertexMax has increased due to cell division\n");
-        vertexMax += 2;
-        };
+        vertexMax = amortizedVertexMax(vertexMax+2);
 
     //The Simple2DActiveCell routine will update Motility and cellDirectors,
     // it in turn calls the Simple2DCell routine, which grows its data structures and increment Ncells by one
@@ -3,6 +3,7 @@
 #include "vertexQuadraticEnergy.h"
 #include "vertexQuadraticEnergy.cuh"
 #include "voronoiQuadraticEnergy.h"
+#include "parallelLoops.h"
 /*! \file vertexQuadraticEnergy.cpp */
 
 /*!
@@ -27,18 +28,13 @@ VertexQuadraticEnergy::VertexQuadraticEnergy(int n,Dscalar A0, Dscalar P0,bool r
 Returns the quadratic energy functional:
 E = \sum_{cells} K_A(A_i-A_i,0)^2 + K_P(P_i-P_i,0)^2
 */
-Dscalar VertexQuadraticEnergy::computeEnergy()
+Daccum VertexQuadraticEnergy::computeEnergy()
     {
     if(!forcesUpToDate)
         computeForces();
     ArrayHandle<Dscalar2> h_AP(AreaPeri,access_location::host,access_mode::read);
     ArrayHandle<Dscalar2> h_APP(AreaPeriPreferences,access_location::host,access_mode::read);
-    Energy = 0.0;
-    for (int nn = 0; nn  < Ncells; ++nn)
-        {
-        Energy += KA * (h_AP.data[nn].x-h_APP.data[nn].x)*(h_AP.data[nn].x-h_APP.data[nn].x);
-        Energy += KP * (h_AP.data[nn].y-h_APP.data[nn].y)*(h_AP.data[nn].y-h_APP.data[nn].y);
-        };
+    Energy = quadraticAreaPerimeterEnergy(KA,KP,h_AP.data,h_APP.data).totalEnergy(Ncells,accumulation);
 
     return Energy;
     };
@@ -69,49 +65,100 @@ void VertexQuadraticEnergy::computeForces()
 Use the data pre-computed in the geometry routine to rapidly compute the net force on each vertex
 */
 void VertexQuadraticEnergy::computeForcesCPU()
+    {
+    ArrayHandle<Dscalar2> h_AP(AreaPeri,access_location::host,access_mode::read);
+    ArrayHandle<Dscalar2> h_APpref(AreaPeriPreferences,access_location::host,access_mode::read);
+    computeVertexForcesCPU(quadraticAreaPerimeterEnergy(KA,KP,h_AP.data,h_APpref.data),noEdgeTension());
+    };
+
+/*!
+Computes the contribution to the force on each vertex from each of its three cells (the vertex force
+sets) and their sum, for an energy described by the policies of energyPolicies.h. When the edge-tension
+policy is active, the force set of a vertex and a cell also includes the tension of the edge from the
+vertex to the next vertex of that cell. Each vertex writes only its own force sets and net force, so
+vertices are split over threads.
+\param energy supplies the derivatives of each cell's energy with respect to its area and perimeter
+\param tension supplies the line tension of the edge between two cells
+*/
+template<class CellEnergy, class EdgeTension>
+void VertexQuadraticEnergy::computeVertexForcesCPU(const CellEnergy &energy, const EdgeTension &tension)
     {
     ArrayHandle<int> h_vcn(vertexCellNeighbors,access_location::host,access_mode::read);
     ArrayHandle<Dscalar2> h_vc(voroCur,access_location::host,access_mode::read);
     ArrayHandle<Dscalar4> h_vln(voroLastNext,access_location::host,access_mode::read);
-    ArrayHandle<Dscalar2> h_AP(AreaPeri,access_location::host,access_mode::read);
-    ArrayHandle<Dscalar2> h_APpref(AreaPeriPreferences,access_location::host,access_mode::read);
+    ArrayHandle<int> h_cv(cellVertices,access_location::host, access_mode::read);
+    ArrayHandle<int> h_cvn(cellVertexNum,access_location::host,access_mode::read);
 
     ArrayHandle<Dscalar2> h_fs(vertexForceSets,access_location::host, access_mode::overwrite);
     ArrayHandle<Dscalar2> h_f(vertexForces,access_location::host, access_mode::overwrite);
 
-    //first, compute the contribution to the force on each vertex from each of its three cells
-    Dscalar2 vlast,vcur,vnext;
-    Dscalar2 dEdv;
-    Dscalar Adiff, Pdiff;
-    for(int fsidx = 0; fsidx < Nvertices*3; ++fsidx)
+    parallelFor(Nvertices,nThreads,[&](int v)
         {
-        int cellIdx = h_vcn.data[fsidx];
-        Dscalar Adiff = KA*(h_AP.data[cellIdx].x - h_APpref.data[cellIdx].x);
-        Dscalar Pdiff = KP*(h_AP.data[cellIdx].y - h_APpref.data[cellIdx].y);
-        vcur = h_vc.data[fsidx];
-        vlast.x = h_vln.data[fsidx].x;  vlast.y = h_vln.data[fsidx].y;
-        vnext.x = h_vln.data[fsidx].z;  vnext.y = h_vln.data[fsidx].w;
-
-        //computeForceSetVertexModel is defined in inc/utility/functions.h
-        computeForceSetVertexModel(vcur,vlast,vnext,Adiff,Pdiff,dEdv);
-
-        h_fs.data[fsidx].x = dEdv.x;
-        h_fs.data[fsidx].y = dEdv.y;
-        };
-
-    //now sum these up to get the force on each vertex
-    for (int v = 0; v < Nvertices; ++v)
-        {
-        Dscalar2 ftemp = make_Dscalar2(0.0,0.0);
+        Dscalar2 vlast,vcur,vnext;
+        Dscalar2 dEdv;
+        Daccum2 ftemp = make_double2(0.0,0.0);
         for (int ff = 0; ff < 3; ++ff)
             {
-            ftemp.x += h_fs.data[3*v+ff].x;
-            ftemp.y += h_fs.data[3*v+ff].y;
+            int fsidx = 3*v+ff;
+            int cellIdx1 = h_vcn.data[fsidx];
+            Dscalar2 halfdEdAP = energy.halfdEdAP(cellIdx1);
+            vcur = h_vc.data[fsidx];
+            vlast.x = h_vln.data[fsidx].x;  vlast.y = h_vln.data[fsidx].y;
+            vnext.x = h_vln.data[fsidx].z;  vnext.y = h_vln.data[fsidx].w;
+
+            //computeForceSetVertexModel is defined in inc/utility/functions.h
+            computeForceSetVertexModel(vcur,vlast,vnext,halfdEdAP.x,halfdEdAP.y,dEdv);
+
+            if (EdgeTension::active)
+                {
+                //determine the index of the cell other than cellIdx1 that contains both vcur and vnext
+                int cellNeighs = h_cvn.data[cellIdx1];
+                int vNextInt = 0;
+                if (h_cv.data[n_idx(cellNeighs-1,cellIdx1)] != v)
+                    {
+                    for (int nn = 0; nn < cellNeighs-1; ++nn)
+                        {
+                        int idx = h_cv.data[n_idx(nn,cellIdx1)];
+                        if (idx == v)
+                            vNextInt = nn +1;
+                        };
+                    };
+                int vNextIdx = h_cv.data[n_idx(vNextInt,cellIdx1)];
+                int cellIdx2 = 0;
+                for (int cc = 0; cc < 3; ++cc)
+                    {
+                    if (ff == cc) continue;
+                    int cell2 = h_vcn.data[3*v+cc];
+                    int cNeighs = h_cvn.data[cell2];
+                    for (int nn = 0; nn < cNeighs; ++nn)
+                        if (h_cv.data[n_idx(nn,cell2)] == vNextIdx)
+                            cellIdx2 = cell2;
+                    };
+                //the tension vanishes between cells of the same type
+                Dscalar gammaEdge = tension(cellIdx2,cellIdx1);
+                Dscalar2 dnext = vcur-vnext;
+                Dscalar dnnorm = sqrt(dnext.x*dnext.x+dnext.y*dnext.y);
+                dEdv.x -= gammaEdge*dnext.x/dnnorm;
+                dEdv.y -= gammaEdge*dnext.y/dnnorm;
+                };
+
+            h_fs.data[fsidx].x = dEdv.x;
+            h_fs.data[fsidx].y = dEdv.y;
+            ftemp.x += dEdv.x;
+            ftemp.y += dEdv.y;
             };
-        h_f.data[v] = ftemp;
-        };
+        h_f.data[v] = make_Dscalar2(ftemp.x,ftemp.y);
+        });
     };
 
+//the energies for which the templated force routine is compiled
+template void VertexQuadraticEnergy::computeVertexForcesCPU<quadraticAreaPerimeterEnergy,noEdgeTension>(
+        const quadraticAreaPerimeterEnergy&,const noEdgeTension&);
+template void VertexQuadraticEnergy::computeVertexForcesCPU<quadraticAreaPerimeterEnergy,uniformEdgeTension>(
+        const quadraticAreaPerimeterEnergy&,const uniformEdgeTension&);
+template void VertexQuadraticEnergy::computeVertexForcesCPU<quadraticAreaPerimeterEnergy,matrixEdgeTension>(
+        const quadraticAreaPerimeterEnergy&,const matrixEdgeTension&);
+
 /*!
 call kernels to (1) do force sets calculation, then (2) add them up
 */
@@ -3,6 +3,9 @@
 #include "cuda_runtime.h"
 #include "voronoiModelBase.h"
 #include "voronoiModelBase.cuh"
+#include "parallelLoops.h"
+#include "batchedFunctions.h"
+#include <chrono>
 
 /*! \file voronoiModelBase.cpp */
 
@@ -11,7 +14,13 @@ A simple constructor that sets many of the class member variables to zero
 */
 voronoiModelBase::voronoiModelBase() :
     cellsize(1.25), timestep(0),repPerFrame(0.0),skippedFrames(0),
-    neighMax(0),neighMaxChange(false),GlobalFixes(0),globalOnly(true)
+    neighMax(0),compressedNeighbors(false),neighborSlack(1),neighMaxChange(false),GlobalFixes(0),globalOnly(true),
+    edgeFlipTopology(false),flipTriangulationInitialized(false),
+    certifiedSkipping(false),certificatesValid(false),certifiedRetests(0),
+    haloTriangulation(false),haloWidth(-1.0),parallelTriangulationThreads(1),parallelTriangulationMinimum(10000),
+    adaptiveRepair(true),repairCostSmoothing(0.1),repairCostRefreshPeriod(1000),lastGlobalTimingStep(0),
+    localCostAtGlobalTiming(-1.0),localRepairCost(-1.0),globalTriangulationCost(-1.0),
+    localRepairsChosen(0),globalTriangulationsChosen(0)
     {
     //set cellsize to about unity...magic number should be of order 1
     //when the box area is of order N (i.e. on average one particle per bin)
@@ -50,12 +59,15 @@ void voronoiModelBase::initializeVoronoiModelBase(int n)
 
     //DelaunayLoc initialization
     delLoc.setBox(Box);
+    delFlip.setBox(Box);
     resetDelLocPoints();
 
     //make a full triangulation
     completeRetriangulationPerformed = 1;
     cellNeighborNum.resize(Ncells);
     globalTriangulationCGAL();
+    //the model is not configured yet (threads, triangulation routine), so this timing is not kept
+    globalTriangulationCost = -1.0;
     resetLists();
     allDelSets();
 
@@ -68,15 +80,23 @@ void voronoiModelBase::initializeVoronoiModelBase(int n)
     };
 
 /*!
-The GPU moves the location of points in the GPU memory... this gets a local copy that can be used
-by the DelaunayLoc class
-\post the DelaunayLoc class has the updated set of cell positions, and its cell list is initialized
+The GPU moves the location of points in the GPU memory... this makes sure the host copy is current,
+and brings the model's cell list up to date; delLoc reads the cell positions and that cell list
+directly (rather than copying the positions and building a second cell list on every call). Only
+the cells whose bins may have changed since the last call are looked at (see cellListGPU::updateCPU).
+delLoc is then given the positions through a DelaunayLocBinding, declared together with the
+ArrayHandle it takes its pointer from, so that delLoc never holds on to a stale host pointer:
+\code
+resetDelLocPoints();
+ArrayHandle<Dscalar2> h_delPoints(cellPositions,access_location::host,access_mode::read);
+DelaunayLocBinding delLocPoints(delLoc,h_delPoints.data,Ncells,&celllist);
+\endcode
+\post the host copy of the cell positions and the cell list are current
 */
 void voronoiModelBase::resetDelLocPoints()
     {
     ArrayHandle<Dscalar2> h_points(cellPositions,access_location::host, access_mode::read);
-    delLoc.setPoints(h_points,Ncells);
-    delLoc.initialize(cellsize);
+    celllist.updateCPU(h_points.data);
     };
 
 /*!
@@ -121,15 +141,8 @@ void voronoiModelBase::updateCellList()
         }
     else
         {
-        vector<Dscalar> psnew(2*Ncells);
         ArrayHandle<Dscalar2> h_points(cellPositions,access_location::host, access_mode::read);
-        for (int ii = 0; ii < Ncells; ++ii)
-            {
-            psnew[2*ii] =  h_points.data[ii].x;
-            psnew[2*ii+1]= h_points.data[ii].y;
-            };
-        celllist.setParticles(psnew);
-        celllist.compute();
+        celllist.updateCPU(h_points.data);
         };
     };
 
@@ -142,6 +155,8 @@ void voronoiModelBase::movePointsCPU(GPUArray<Dscalar2> &displacements,Dscalar s
     {
     ArrayHandle<Dscalar2> h_p(cellPositions,access_location::host,access_mode::readwrite);
     ArrayHandle<Dscalar2> h_d(displacements,access_location::host,access_mode::read);
+    //keep track of the largest displacement for the certificates of the edge-flip triangulation
+    Dscalar maxDisp2 = 0.0;
     if(scale == 1.)
         {
         for (int idx = 0; idx < Ncells; ++idx)
@@ -149,6 +164,8 @@ void voronoiModelBase::movePointsCPU(GPUArray<Dscalar2> &displacements,Dscalar s
             h_p.data[idx].x += h_d.data[idx].x;
             h_p.data[idx].y += h_d.data[idx].y;
             Box->putInBoxReal(h_p.data[idx]);
+            Dscalar disp2 = h_d.data[idx].x*h_d.data[idx].x+h_d.data[idx].y*h_d.data[idx].y;
+            if (disp2 > maxDisp2) maxDisp2 = disp2;
             };
         }
     else
@@ -158,8 +175,12 @@ void voronoiModelBase::movePointsCPU(GPUArray<Dscalar2> &displacements,Dscalar s
             h_p.data[idx].x += scale*h_d.data[idx].x;
             h_p.data[idx].y += scale*h_d.data[idx].y;
             Box->putInBoxReal(h_p.data[idx]);
+            Dscalar disp2 = h_d.data[idx].x*h_d.data[idx].x+h_d.data[idx].y*h_d.data[idx].y;
+            if (disp2 > maxDisp2) maxDisp2 = disp2;
             };
         }
+    delFlip.addDisplacement(fabs(scale)*sqrt(maxDisp2));
+    celllist.addDisplacement(fabs(scale)*sqrt(maxDisp2));
     };
 
 /*!
@@ -169,6 +190,10 @@ Displace cells on the GPU
 */
 void voronoiModelBase::movePoints(GPUArray<Dscalar2> &displacements,Dscalar scale)
     {
+    //the displacements are not seen on the host, so every triangle of the edge-flip triangulation is checked next time
+    //(and the CPU cell list is rebuilt)
+    delFlip.invalidateCertificates();
+    celllist.forgetParticleBins();
     ArrayHandle<Dscalar2> d_p(cellPositions,access_location::device,access_mode::readwrite);
     ArrayHandle<Dscalar2> d_d(displacements,access_location::device,access_mode::readwrite);
     if (scale == 1.)
@@ -207,16 +232,18 @@ void voronoiModelBase::fullTriangulation(bool verbose)
     {
     GlobalFixes +=1;
     completeRetriangulationPerformed = 1;
+    flipTriangulationInitialized = false;
+    certificatesValid = false;
     resetDelLocPoints();
+    ArrayHandle<Dscalar2> h_delPoints(cellPositions,access_location::host,access_mode::read);
+    DelaunayLocBinding delLocPoints(delLoc,h_delPoints.data,Ncells,&celllist);
 
     //get neighbors of each cell in CW order
 
     ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::overwrite);
     ArrayHandle<int> h_repair(repair,access_location::host,access_mode::overwrite);
     vector< vector<int> > allneighs(Ncells);
-    int oldNmax = neighMax;
     int totaln = 0;
-    int nmax = 0;
     for(int nn = 0; nn < Ncells; ++nn)
         {
         vector<int> neighTemp;
@@ -224,20 +251,11 @@ void voronoiModelBase::fullTriangulation(bool verbose)
         allneighs[nn]=neighTemp;
         neighnum.data[nn] = neighTemp.size();
         totaln += neighTemp.size();
-        if (neighTemp.size() > nmax) nmax= neighTemp.size();
         h_repair.data[nn]=0;
         };
-    if (nmax%2 ==0)
-        neighMax = nmax + 2;
-    else
-        neighMax = nmax + 1;
 
-    n_idx = Index2D(neighMax,Ncells);
-    if(neighMax != oldNmax)
-        {
-        cellNeighbors.resize(neighMax*Ncells);
+    if(setNeighborLayout(neighnum.data))
         neighMaxChange = true;
-        };
     updateNeighIdxs();
 
 
@@ -249,7 +267,7 @@ void voronoiModelBase::fullTriangulation(bool verbose)
         int imax = neighnum.data[nn];
         for (int ii = 0; ii < imax; ++ii)
             {
-            int idxpos = n_idx(ii,nn);
+            int idxpos = neigh_idx(ii,nn);
             ns.data[idxpos] = allneighs[nn][ii];
             };
         };
@@ -275,13 +293,18 @@ void voronoiModelBase::fullTriangulation(bool verbose)
 /*!
 This function calls the DelaunayCGAL class to determine the Delaunay triangulation of the entire
 square periodic domain this method is, obviously, better than the version written by DMS, so
-should be the default option. In addition to performing a triangulation, the function also automatically
+should be the default option. If setHaloTriangulation has been called, DelaunayCGAL's thin-halo
+routine is used instead of the periodic one, and if setParallelTriangulation has been called (and
+the system is large enough) the domain is split into strips that are triangulated concurrently. In addition to performing a triangulation, the function also automatically
 calls updateNeighIdxs and getCircumcenterIndices/
 */
 void voronoiModelBase::globalTriangulationCGAL(bool verbose)
     {
+    chrono::steady_clock::time_point tstart = chrono::steady_clock::now();
     GlobalFixes +=1;
     completeRetriangulationPerformed = 1;
+    flipTriangulationInitialized = false;
+    certificatesValid = false;
     DelaunayCGAL dcgal;
     ArrayHandle<Dscalar2> h_points(cellPositions,access_location::host, access_mode::read);
     vector<pair<Point,int> > Psnew(Ncells);
@@ -291,32 +314,26 @@ void voronoiModelBase::globalTriangulationCGAL(bool verbose)
         };
     Dscalar b1,b2,b3,b4;
     Box->getBoxDims(b1,b2,b3,b4);
-    dcgal.PeriodicTriangulation(Psnew,b1,b2,b3,b4);
+    if(parallelTriangulationThreads > 1 && Ncells >= parallelTriangulationMinimum)
+        dcgal.PeriodicTriangulationParallel(Psnew,b1,b2,b3,b4,parallelTriangulationThreads,haloWidth);
+    else if(haloTriangulation)
+        dcgal.PeriodicTriangulationHalo(Psnew,b1,b2,b3,b4,haloWidth);
+    else
+        dcgal.PeriodicTriangulation(Psnew,b1,b2,b3,b4);
 
     ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::overwrite);
     ArrayHandle<int> h_repair(repair,access_location::host,access_mode::overwrite);
 
-    int oldNmax = neighMax;
     int totaln = 0;
-    int nmax = 0;
     for(int nn = 0; nn < Ncells; ++nn)
         {
         neighnum.data[nn] = dcgal.allneighs[nn].size();
         totaln += dcgal.allneighs[nn].size();
-        if (dcgal.allneighs[nn].size() > nmax) nmax= dcgal.allneighs[nn].size();
         h_repair.data[nn]=0;
         };
-    if (nmax%2 == 0)
-        neighMax = nmax+2;
-    else
-        neighMax = nmax+1;
 
-    n_idx = Index2D(neighMax,Ncells);
-    if(cellNeighbors.getNumElements() != Ncells*neighMax)
-        {
-        cellNeighbors.resize(neighMax*Ncells);
+    if(setNeighborLayout(neighnum.data))
         neighMaxChange = true;
-        };
     updateNeighIdxs();
 
     //store data in gpuarrays
@@ -328,7 +345,7 @@ void voronoiModelBase::globalTriangulationCGAL(bool verbose)
         int imax = neighnum.data[nn];
         for (int ii = 0; ii < imax; ++ii)
             {
-            int idxpos = n_idx(ii,nn);
+            int idxpos = neigh_idx(ii,nn);
             ns.data[idxpos] = dcgal.allneighs[nn][ii];
             };
         };
@@ -338,6 +355,10 @@ void voronoiModelBase::globalTriangulationCGAL(bool verbose)
     };
 
     getCircumcenterIndices(true);
+    Dscalar elapsed = chrono::duration<Dscalar>(chrono::steady_clock::now()-tstart).count();
+    updateRepairCost(globalTriangulationCost,elapsed/Ncells);
+    lastGlobalTimingStep = timestep;
+    localCostAtGlobalTiming = localRepairCost;
 
     if(totaln != 6*Ncells)
         {
@@ -358,6 +379,7 @@ void voronoiModelBase::updateNeighIdxs()
     {
     ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::read);
     ArrayHandle<int2> h_nidx(NeighIdxs,access_location::host,access_mode::overwrite);
+    neighIdxPosition.assign(neigh_idx.getNumElements(),-1);
     int idx = 0;
     for (int ii = 0; ii < Ncells; ++ii)
         {
@@ -366,6 +388,7 @@ void voronoiModelBase::updateNeighIdxs()
             {
             h_nidx.data[idx].x = ii;
             h_nidx.data[idx].y = nn;
+            neighIdxPosition[neigh_idx(nn,ii)] = idx;
             idx+=1;
             };
         };
@@ -383,6 +406,8 @@ void voronoiModelBase::getCircumcenterIndices(bool secondtime, bool verbose)
     ArrayHandle<int> ns(cellNeighbors,access_location::host,access_mode::read);
     ArrayHandle<int3> h_ccs(circumcenters,access_location::host,access_mode::overwrite);
 
+    circumcenterPosition.assign(neigh_idx.getNumElements(),-1);
+    circumcenterOwner.resize(circumcenters.getNumElements());
     int totaln = 0;
     int cidx = 0;
     bool fail = false;
@@ -394,15 +419,20 @@ void voronoiModelBase::getCircumcenterIndices(bool secondtime, bool verbose)
             {
             if (fail) continue;
 
-            int n1 = ns.data[n_idx(jj,nn)];
+            int n1 = ns.data[neigh_idx(jj,nn)];
             int ne2 = jj + 1;
             if (jj == nmax-1)  ne2=0;
-            int n2 = ns.data[n_idx(ne2,nn)];
+            int n2 = ns.data[neigh_idx(ne2,nn)];
             if (nn < n1 && nn < n2)
                 {
                 h_ccs.data[cidx].x = nn;
                 h_ccs.data[cidx].y = n1;
                 h_ccs.data[cidx].z = n2;
+                if (cidx < circumcenterOwner.size())
+                    {
+                    circumcenterOwner[cidx] = make_int2(nn,jj);
+                    circumcenterPosition[neigh_idx(jj,nn)] = cidx;
+                    };
                 cidx+=1;
                 };
             };
@@ -423,85 +453,188 @@ void voronoiModelBase::getCircumcenterIndices(bool secondtime, bool verbose)
     };
 
 /*!
-Given a list of particle indices that need to be repaired, call CGAL to figure out their neighbors
-and then update the relevant data structures.
+Both the NeighIdxs and circumcenter arrays are used as unordered lists, so entries can be removed
+by moving the last entry of the list into the vacated position. neighIdxPosition and
+circumcenterPosition record where the entry associated with each (neighbor slot, cell) pair lives.
+\param cells a list of cells whose neighbor lists are about to be changed
+\post every NeighIdxs entry of the cells, and every circumcenter they own, is removed
 */
-void voronoiModelBase::repairTriangulation(vector<int> &fixlist)
+void voronoiModelBase::removeLocalTopologyEntries(const vector<int> &cells)
     {
-    int fixes = fixlist.size();
-    repPerFrame += ((Dscalar) fixes/(Dscalar)Ncells);
-    resetDelLocPoints();
-
-    ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::readwrite);
-
-    //First, retriangulate the target points, and check if the neighbor list needs to be reset
-    //the structure you want is vector<vector<int> > allneighs(fixes), but below a flattened version is implemented
-
-    vector<int> allneighs;
-    allneighs.reserve(fixes*neighMax);
-    vector<int> allneighidxstart(fixes);
-    vector<int> allneighidxstop(fixes);
-
-    //vector<vector<int> > allneighs(fixes);
-    vector<int> neighTemp;
-    neighTemp.reserve(10);
-
-    bool resetCCidx = false;
-    bool LocalFailure = false;
-    bool localTest = false;
-    for (int ii = 0; ii < fixes; ++ii)
-        {
-        int pidx = fixlist[ii];
-        localTest = delLoc.getNeighborsCGAL(pidx,neighTemp);
-        if(!localTest)
+    if(neighIdxPosition.size() != neigh_idx.getNumElements() || circumcenterPosition.size() != neigh_idx.getNumElements())
+        return;
+    ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::read);
+    ArrayHandle<int2> h_nidx(NeighIdxs,access_location::host,access_mode::readwrite);
+    ArrayHandle<int3> h_ccs(circumcenters,access_location::host,access_mode::readwrite);
+    for (int cc = 0; cc < cells.size(); ++cc)
+        {
+        int pidx = cells[cc];
+        int nmax = neighnum.data[pidx];
+        for (int jj = 0; jj < nmax; ++jj)
             {
-            LocalFailure = true;
-            cout << "local triangulation failed...attempting a global triangulation to save the day" << endl << "Note that a particle position has probably become NaN, in which case CGAL will give an assertion violation" << endl;
-            break;
+            int idxpos = neigh_idx(jj,pidx);
+            int pos = neighIdxPosition[idxpos];
+            if (pos >= 0)
+                {
+                NeighIdxNum -= 1;
+                int2 last = h_nidx.data[NeighIdxNum];
+                h_nidx.data[pos] = last;
+                neighIdxPosition[neigh_idx(last.y,last.x)] = pos;
+                neighIdxPosition[idxpos] = -1;
+                };
+            int cpos = circumcenterPosition[idxpos];
+            if (cpos >= 0)
+                {
+                NumCircumCenters -= 1;
+                int2 owner = circumcenterOwner[NumCircumCenters];
+                h_ccs.data[cpos] = h_ccs.data[NumCircumCenters];
+                circumcenterOwner[cpos] = owner;
+                circumcenterPosition[neigh_idx(owner.y,owner.x)] = cpos;
+                circumcenterPosition[idxpos] = -1;
+                };
             };
+        };
+    };
 
-        allneighidxstart[ii] = allneighs.size();
-        for (int nn = 0; nn < neighTemp.size(); ++nn)
+/*!
+\param cells a list of cells whose neighbor lists have just been changed, and whose entries were
+removed by removeLocalTopologyEntries
+\post the NeighIdxs and circumcenter entries of the cells are appended to the lists. If the total
+number of neighbors or of circumcenters is not consistent with a periodic triangulation, the full
+updateNeighIdxs and getCircumcenterIndices routines are called (which trigger a global
+re-triangulation if necessary).
+*/
+void voronoiModelBase::addLocalTopologyEntries(const vector<int> &cells)
+    {
+    bool consistent = (neighIdxPosition.size() == neigh_idx.getNumElements() && circumcenterPosition.size() == neigh_idx.getNumElements());
+    if(consistent)
+        {
+        ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::read);
+        ArrayHandle<int> ns(cellNeighbors,access_location::host,access_mode::read);
+        ArrayHandle<int2> h_nidx(NeighIdxs,access_location::host,access_mode::readwrite);
+        ArrayHandle<int3> h_ccs(circumcenters,access_location::host,access_mode::readwrite);
+        int maxNeighIdxs = NeighIdxs.getNumElements();
+        int maxCCs = circumcenterOwner.size();
+        for (int cc = 0; cc < cells.size() && consistent; ++cc)
             {
-            allneighs.push_back(neighTemp[nn]);
+            int pidx = cells[cc];
+            int nmax = neighnum.data[pidx];
+            for (int jj = 0; jj < nmax; ++jj)
+                {
+                if (NeighIdxNum >= maxNeighIdxs || NumCircumCenters >= maxCCs)
+                    {
+                    consistent = false;
+                    break;
+                    };
+                int idxpos = neigh_idx(jj,pidx);
+                h_nidx.data[NeighIdxNum] = make_int2(pidx,jj);
+                neighIdxPosition[idxpos] = NeighIdxNum;
+                NeighIdxNum += 1;
+
+                int n1 = ns.data[idxpos];
+                int n2 = ns.data[neigh_idx((jj+1)%nmax,pidx)];
+                if (pidx < n1 && pidx < n2)
+                    {
+                    h_ccs.data[NumCircumCenters] = make_int3(pidx,n1,n2);
+                    circumcenterOwner[NumCircumCenters] = make_int2(pidx,jj);
+                    circumcenterPosition[idxpos] = NumCircumCenters;
+                    NumCircumCenters += 1;
+                    };
+                };
             };
-        //allneighs[ii]=neighTemp;
+        };
+    if(!consistent || NeighIdxNum != 6*Ncells || NumCircumCenters != 2*Ncells)
+        {
+        updateNeighIdxs();
+        getCircumcenterIndices();
+        return;
+        };
+#ifdef DEBUGFLAGUP
+    checkLocalTopologyEntries();
+#endif
+    };
 
-        allneighidxstop[ii] = allneighs.size();
-        if(neighTemp.size() > neighMax)
+/*!
+A debugging routine: compare the incrementally maintained NeighIdxs and circumcenter lists with
+the ones that would be built from scratch from the current neighbor lists (the order of the entries
+is irrelevant).
+\post throws an exception if the lists do not match
+*/
+void voronoiModelBase::checkLocalTopologyEntries()
+    {
+    ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::read);
+    ArrayHandle<int> ns(cellNeighbors,access_location::host,access_mode::read);
+    ArrayHandle<int2> h_nidx(NeighIdxs,access_location::host,access_mode::read);
+    ArrayHandle<int3> h_ccs(circumcenters,access_location::host,access_mode::read);
+
+    vector<pair<int,int> > expectedNidx, currentNidx;
+    vector<pair<int,pair<int,int> > > expectedCCs, currentCCs;
+    for (int ii = 0; ii < Ncells; ++ii)
+        {
+        int nmax = neighnum.data[ii];
+        for (int jj = 0; jj < nmax; ++jj)
             {
-            resetCCidx = true;
+            expectedNidx.push_back(make_pair(ii,jj));
+            int n1 = ns.data[neigh_idx(jj,ii)];
+            int n2 = ns.data[neigh_idx((jj+1)%nmax,ii)];
+            if (ii < n1 && ii < n2)
+                expectedCCs.push_back(make_pair(ii,make_pair(n1,n2)));
             };
         };
+    for (int ii = 0; ii < NeighIdxNum; ++ii)
+        currentNidx.push_back(make_pair(h_nidx.data[ii].x,h_nidx.data[ii].y));
+    for (int ii = 0; ii < NumCircumCenters; ++ii)
+        currentCCs.push_back(make_pair(h_ccs.data[ii].x,make_pair(h_ccs.data[ii].y,h_ccs.data[ii].z)));
+    sort(expectedNidx.begin(),expectedNidx.end());
+    sort(currentNidx.begin(),currentNidx.end());
+    sort(expectedCCs.begin(),expectedCCs.end());
+    sort(currentCCs.begin(),currentCCs.end());
+    if(expectedNidx != currentNidx || expectedCCs != currentCCs)
+        {
+        printf("step: %i  incremental NeighIdxs/circumcenter update does not match the full rebuild\n",timestep);
+        throw std::exception();
+        };
+    };
+
+/*!
+Given a list of particle indices that need to be repaired, find their neighbors from their candidate
+1-rings (see DelaunayLoc::getNeighborsLocal) and then update the relevant data structures. The local
+triangulations are split over nThreads CPU threads; if any of them fails, or if (in the padded
+neighbor layout) any cell has more than neighMax neighbors, a global re-triangulation is performed
+instead.
+*/
+void voronoiModelBase::repairTriangulation(vector<int> &fixlist)
+    {
+    int fixes = fixlist.size();
+    repPerFrame += ((Dscalar) fixes/(Dscalar)Ncells);
+    flipTriangulationInitialized = false;
+    certificatesValid = false;
+    resetDelLocPoints();
+    ArrayHandle<Dscalar2> h_delPoints(cellPositions,access_location::host,access_mode::read);
+    DelaunayLocBinding delLocPoints(delLoc,h_delPoints.data,Ncells,&celllist);
 
-    //if needed, regenerate the "neighs" structure...hopefully don't do this too much
-    if(resetCCidx || LocalFailure)
+    //First, retriangulate the target points, and check if the neighbor list needs to be reset
+    //the structure you want is vector<vector<int> > allneighs(fixes), but below a flattened version is implemented
+    //The 1-rings are computed concurrently (in per-thread buffers) and merged in fixlist order
+    vector<int> allneighs;
+    vector<int> allneighidxstart;
+    vector<int> allneighidxstop;
+
+    bool LocalFailure = !delLoc.getNeighborsLocal(fixlist,allneighs,allneighidxstart,allneighidxstop,nThreads);
+    if(LocalFailure)
         {
-        if(resetCCidx)
-            neighMaxChange = true;
+        cout << "local triangulation failed...attempting a global triangulation to save the day" << endl << "Note that a particle position has probably become NaN, in which case CGAL will give an assertion violation" << endl;
         globalTriangulationCGAL();
         return;
         };
 
-    //now, edit the right entries of the neighborlist and neighbor size list
-    ArrayHandle<int> ns(cellNeighbors,access_location::host,access_mode::readwrite);
-    for (int nn = 0; nn < fixes; ++nn)
+    //edit the right entries of the neighborlist and neighbor size list, and patch the NeighIdx and circumcenter lists
+    if(!setLocalNeighbors(fixlist,allneighs,allneighidxstart,allneighidxstop))
         {
-        int pidx = fixlist[nn];
-        //int imax = allneighs[nn].size();
-        int imax = allneighidxstop[nn]-allneighidxstart[nn];
-        neighnum.data[pidx] = imax;
-        for (int ii = 0; ii < imax; ++ii)
-            {
-            int idxpos = n_idx(ii,pidx);
-            //ns.data[idxpos] = allneighs[nn][ii];
-            ns.data[idxpos] = allneighs[ii+allneighidxstart[nn]];
-            };
+        //regenerate the "neighs" structure...hopefully don't do this too much
+        neighMaxChange = true;
+        globalTriangulationCGAL();
         };
-
-    //finally, update the NeighIdx list and Circumcenter list
-    updateNeighIdxs();
-    getCircumcenterIndices();
     };
 
 /*!
@@ -551,7 +684,8 @@ void voronoiModelBase::testTriangulation()
 perform the same check on the CPU... because of the cost of checking circumcircles and the
 relatively poor performance of the 1-ring calculation in DelaunayLoc, it is sometimes better
 to just re-triangulate the entire point set with CGAL. At the moment that is the default
-behavior of the cpu branch.
+behavior of the cpu branch. When local testing is used, the circumcircle tests are split over
+nThreads CPU threads (see setNumThreads).
 */
 void voronoiModelBase::testTriangulationCPU()
     {
@@ -562,34 +696,230 @@ void voronoiModelBase::testTriangulationCPU()
         globalTriangulationCGAL();
         skippedFrames -= 1;
         }
+    else if (certifiedSkipping)
+        {
+        int failures = testCertifiedTriangulationCPU();
+        if(failures > 0)
+            {
+            h_actf.data[0]=1;
+            localTopologyUpdates += failures;
+            };
+        }
     else
         {
         resetDelLocPoints();
+        ArrayHandle<Dscalar2> h_delPoints(cellPositions,access_location::host,access_mode::read);
+        DelaunayLocBinding delLocPoints(delLoc,h_delPoints.data,Ncells,&celllist);
 
         ArrayHandle<int> h_repair(repair,access_location::host,access_mode::readwrite);
-        ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::readwrite);
-        ArrayHandle<int> ns(cellNeighbors,access_location::host,access_mode::readwrite);
-        h_actf.data[0]=0;
-        for (int nn = 0; nn < Ncells; ++nn)
+        ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::read);
+        ArrayHandle<int> ns(cellNeighbors,access_location::host,access_mode::read);
+        //each thread tests a contiguous block of cells and only writes to h_repair entries in its block
+        int failures = delLoc.testPointTriangulations(Ncells,neighnum.data,ns.data,neigh_idx,h_repair.data,nThreads);
+        if(failures > 0)
             {
-            h_repair.data[nn] = 0;
-            vector<int> neighbors;
-            neighbors.reserve(neighMax);
-            for (int ii = 0; ii < neighnum.data[nn];++ii)
-                    {
-                    int idxpos = n_idx(ii,nn);
-                    neighbors.push_back(ns.data[idxpos]);
-                    };
+            h_actf.data[0]=1;
+            localTopologyUpdates += failures;
+            };
+        };
+    };
+
+/*!
+The certified version of the CPU test. When the certificates are not valid (e.g., after any change
+in the topology) every circumcircle is tested, and if the triangulation is still Delaunay each
+triangle is given a displacement tolerance (see DelaunayLoc::testCircumcircle) and the current
+positions are stored. On later calls only the maximum displacement of any cell since then is
+computed, and only triangles whose tolerance is smaller than that are re-tested. The re-test moves
+the certificates to the current positions: every tolerance is reduced by that maximum displacement,
+the re-tested triangles that are still empty get a new tolerance, and the current positions are
+stored. If more than a quarter of the triangles need to be re-tested, the certificates are
+recomputed from scratch.
+\post repair is set as in testTriangulationCPU
+\return the number of non-empty circumcircles
+*/
+int voronoiModelBase::testCertifiedTriangulationCPU()
+    {
+    vector<int> triangleList;
+    Dscalar maxDisp = 0.0;
+    if (certificatesValid)
+        {
+        ArrayHandle<Dscalar2> h_p(cellPositions,access_location::host,access_mode::read);
+        Dscalar maxDisp2 = 0.0;
+        Dscalar2 disp;
+        for (int ii = 0; ii < Ncells; ++ii)
+            {
+            Box->minDist(h_p.data[ii],certifiedPositions[ii],disp);
+            Dscalar d2 = disp.x*disp.x+disp.y*disp.y;
+            if (d2 > maxDisp2) maxDisp2 = d2;
+            };
+        maxDisp = sqrt(maxDisp2);
+        for (int tt = 0; tt < NumCircumCenters; ++tt)
+            if (triangleTolerances[tt] <= maxDisp)
+                triangleList.push_back(tt);
+        if (triangleList.size() == 0)
+            return 0;
+        if (4*triangleList.size() > NumCircumCenters)
+            certificatesValid = false;
+        };
+
+    resetDelLocPoints();
+    ArrayHandle<Dscalar2> h_delPoints(cellPositions,access_location::host,access_mode::read);
+    DelaunayLocBinding delLocPoints(delLoc,h_delPoints.data,Ncells,&celllist);
+    ArrayHandle<int> h_repair(repair,access_location::host,access_mode::readwrite);
+    ArrayHandle<int3> h_ccs(circumcenters,access_location::host,access_mode::read);
+    for (int ii = 0; ii < Ncells; ++ii)
+        h_repair.data[ii] = 0;
+    int failures;
+    if (certificatesValid)
+        {
+        certifiedRetests += triangleList.size();
+        //move every certificate to the current positions...
+        for (int tt = 0; tt < NumCircumCenters; ++tt)
+            triangleTolerances[tt] -= maxDisp;
+        //...and give the re-tested triangles that are still empty a new tolerance
+        failures = delLoc.testCircumcircles(triangleList,h_ccs.data,h_repair.data,&triangleTolerances[0],nThreads);
+        ArrayHandle<Dscalar2> h_p(cellPositions,access_location::host,access_mode::read);
+        certifiedPositions.assign(h_p.data,h_p.data+Ncells);
+        }
+    else
+        {
+        triangleList.resize(NumCircumCenters);
+        for (int tt = 0; tt < NumCircumCenters; ++tt)
+            triangleList[tt] = tt;
+        triangleTolerances.resize(NumCircumCenters);
+        failures = delLoc.testCircumcircles(triangleList,h_ccs.data,h_repair.data,&triangleTolerances[0],nThreads);
+        if (failures == 0)
+            {
+            ArrayHandle<Dscalar2> h_p(cellPositions,access_location::host,access_mode::read);
+            certifiedPositions.assign(h_p.data,h_p.data+Ncells);
+            certificatesValid = true;
+            };
+        };
+    return failures;
+    };
+
+/*!
+Replaces the test-and-repair cycle when edgeFlipTopology is set. The DelaunayFlip class holds the
+triangulation of the previous time step, and Lawson flips restore the Delaunay property for the
+current positions. No circumcircle tests are performed: delFlip knows (from the displacements
+reported by movePointsCPU) which of its triangles may have been inverted or may have stopped being
+Delaunay, checks only those, and flips only from their edges, so maintaining the topology costs
+O(number of such triangles + number of flips). Only the cells whose neighbor lists changed are
+rewritten, and NeedsFixing is set to those cells and their neighbors so that the delSets can be
+updated locally. If any triangle has been inverted, if the flips cannot repair the triangulation, or
+if (in the padded neighbor layout) any cell ends up with more than neighMax neighbors, a global
+re-triangulation is performed.
+\post anyCircumcenterTestFailed is set to one if the topology changed
+*/
+void voronoiModelBase::flipTriangulation()
+    {
+    ArrayHandle<int> h_actf(anyCircumcenterTestFailed,access_location::host,access_mode::readwrite);
+    h_actf.data[0]=0;
+    NeedsFixing.clear();
+
+    if(!flipTriangulationInitialized)
+        {
+        ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::read);
+        ArrayHandle<int> ns(cellNeighbors,access_location::host,access_mode::read);
+        flipTriangulationInitialized = delFlip.initialize(Ncells,neighnum.data,ns.data,neigh_idx);
+        };
+
+    vector<int> changedCells;
+    bool flipSuccess = flipTriangulationInitialized;
+    if(flipSuccess)
+        {
+        ArrayHandle<Dscalar2> h_p(cellPositions,access_location::host,access_mode::read);
+        flipSuccess = delFlip.updateToDelaunay(h_p.data,changedCells);
+        };
 
-            bool good = delLoc.testPointTriangulation(nn,neighbors,false);
-            if(!good)
+    //collect the new neighbor lists of every cell touched by a flip
+    vector<int> flipNeighs, flipStart, flipStop;
+    if(flipSuccess && changedCells.size() > 0)
+        {
+        vector<int> neighs;
+        for (int cc = 0; cc < changedCells.size(); ++cc)
+            {
+            if(!delFlip.getNeighbors(changedCells[cc],neighs))
                 {
-                h_repair.data[nn] = 1;
-                h_actf.data[0]=1;
-                localTopologyUpdates += 1;
+                flipSuccess = false;
+                break;
                 };
+            flipStart.push_back(flipNeighs.size());
+            flipNeighs.insert(flipNeighs.end(),neighs.begin(),neighs.end());
+            flipStop.push_back(flipNeighs.size());
             };
         };
+
+    if(!flipSuccess)
+        {
+        h_actf.data[0]=1;
+        globalTriangulationCGAL();
+        return;
+        };
+    if(changedCells.size() == 0)
+        return;
+
+    h_actf.data[0]=1;
+    completeRetriangulationPerformed = 0;
+    certificatesValid = false;
+    if(!setLocalNeighbors(changedCells,flipNeighs,flipStart,flipStop))
+        {
+        neighMaxChange = true;
+        globalTriangulationCGAL();
+        return;
+        };
+    localTopologyUpdates += changedCells.size();
+    repPerFrame += ((Dscalar) changedCells.size()/(Dscalar)Ncells);
+
+    //the delSets of a cell depend on the neighbor lists of its neighbors, too
+    ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::read);
+    ArrayHandle<int> ns(cellNeighbors,access_location::host,access_mode::read);
+    for (int cc = 0; cc < changedCells.size(); ++cc)
+        {
+        int pidx = changedCells[cc];
+        NeedsFixing.push_back(pidx);
+        for (int ii = 0; ii < neighnum.data[pidx]; ++ii)
+            NeedsFixing.push_back(ns.data[neigh_idx(ii,pidx)]);
+        };
+    sort(NeedsFixing.begin(),NeedsFixing.end());
+    NeedsFixing.erase(unique(NeedsFixing.begin(),NeedsFixing.end() ),NeedsFixing.end() );
+    };
+
+/*!
+The predicted cost of a local repair is the number of cells to repair times the moving average of
+the cost per repaired cell, and the predicted cost of a global triangulation is Ncells times the
+moving average of the cost per cell of previous global triangulations.
+\return the number of cells needing repair above which a global triangulation is predicted to be
+cheaper. Falls back on the fixed value of Ncells/6 if the adaptive policy is off, if the simulation is
+meant to be Reproducible (the timings would make the sequence of operations vary from run to run),
+or if either cost has not been measured yet.
+*/
+Dscalar voronoiModelBase::getRepairCrossover()
+    {
+    if (!adaptiveRepair || Reproducible || localRepairCost <= 0 || globalTriangulationCost < 0)
+        return (Dscalar)(Ncells/6);
+    return globalTriangulationCost*Ncells/localRepairCost;
+    };
+
+/*!
+The cost of a global triangulation is only measured when one is performed, so once local repairs are
+always predicted to be cheaper the estimate would never change again. A global triangulation is
+therefore chosen (and timed) when none has been timed since the model was configured, when
+repairCostRefreshPeriod time steps have passed since the last one was timed, or when the cost of local
+repairs has changed by more than a factor of two since then.
+\return false if the adaptive policy is not in use, or if no local repair has been timed yet
+*/
+bool voronoiModelBase::globalTimingDue()
+    {
+    if (!adaptiveRepair || Reproducible || localRepairCost <= 0)
+        return false;
+    if (globalTriangulationCost < 0)
+        return true;
+    if (repairCostRefreshPeriod > 0 && timestep - lastGlobalTimingStep >= repairCostRefreshPeriod)
+        return true;
+    if (localCostAtGlobalTiming <= 0)
+        return false;
+    return (localRepairCost > 2.0*localCostAtGlobalTiming || 2.0*localRepairCost < localCostAtGlobalTiming);
     };
 
 /*!
@@ -601,6 +931,16 @@ void voronoiModelBase::testAndRepairTriangulation(bool verb)
     {
     timestep +=1;
 
+    if (edgeFlipTopology)
+        {
+        if (verb) printf("flipping triangulation\n");
+        flipTriangulation();
+        ArrayHandle<int> h_actf(anyCircumcenterTestFailed,access_location::host,access_mode::read);
+        if(h_actf.data[0]==0)
+            skippedFrames+=1;
+        return;
+        };
+
     if (verb) printf("testing triangulation\n");
     if(GPUcompute)
         {
@@ -637,7 +977,7 @@ void voronoiModelBase::testAndRepairTriangulation(bool verb)
                 h_repair.data[nn] = 0;
                 for (int ii = 0; ii < neighnum.data[nn];++ii)
                     {
-                    int idxpos = n_idx(ii,nn);
+                    int idxpos = neigh_idx(ii,nn);
                     NeedsFixing.push_back(ns.data[idxpos]);
                     };
                 };
@@ -647,15 +987,23 @@ void voronoiModelBase::testAndRepairTriangulation(bool verb)
 
         if (verb) printf("repairing triangulation via %lu\n",NeedsFixing.size());
 
-        if (NeedsFixing.size() > (Ncells/6))
+        if (NeedsFixing.size() > getRepairCrossover() || globalTimingDue())
             {
+            globalTriangulationsChosen += 1;
             completeRetriangulationPerformed = 1;
             globalTriangulationCGAL();
             }
         else
             {
+            localRepairsChosen += 1;
             completeRetriangulationPerformed = 0;
+            int globalFixesBefore = GlobalFixes;
+            chrono::steady_clock::time_point tstart = chrono::steady_clock::now();
             repairTriangulation(NeedsFixing);
+            Dscalar elapsed = chrono::duration<Dscalar>(chrono::steady_clock::now()-tstart).count();
+            //repairs that fell back on a global triangulation don't say anything about local costs
+            if (GlobalFixes == globalFixesBefore && NeedsFixing.size() > 0)
+                updateRepairCost(localRepairCost,elapsed/NeedsFixing.size());
             };
         }
     else
@@ -669,6 +1017,8 @@ When sortPeriod < 0, this routine does not get called
 void voronoiModelBase::spatialSorting()
     {
     spatiallySortCellsAndCellActivity();
+    //almost every cell has a new index, so rebuilding the cell list is cheaper than moving each cell
+    celllist.forgetParticleBins();
     //reTriangulate with the new ordering
     globalTriangulationCGAL();
     //get new DelSets and DelOthers
@@ -791,58 +1141,87 @@ void voronoiModelBase::computeGeometryCPU()
     ArrayHandle<Dscalar2> h_v(voroCur,access_location::host,access_mode::overwrite);
     ArrayHandle<Dscalar4> h_vln(voroLastNext,access_location::host,access_mode::overwrite);
 
-    for (int i = 0; i < Ncells; ++i)
+    parallelFor(Ncells,nThreads,[&](int i)
         {
-        //get Delaunay neighbors of the cell
-        int neigh = h_nn.data[i];
-        vector<int> ns(neigh);
-        for (int nn = 0; nn < neigh; ++nn)
-            {
-            ns[nn]=h_n.data[n_idx(nn,i)];
-            };
+        computeVoronoiGeometryCPU(i,h_p.data,h_nn.data,h_n.data,h_v.data,h_vln.data,h_AP.data);
+        });
+    };
 
-        //compute base set of voronoi points, and the derivatives of those points w/r/t cell i's position
-        vector<Dscalar2> voro(neigh);
-        Dscalar2 circumcent;
-        Dscalar2 nnextp,nlastp;
-        Dscalar2 pi = h_p.data[i];
-        Dscalar2 rij, rik;
+/*!
+The per-cell work of computeGeometryCPU, acting on host pointers so that callers can acquire the
+ArrayHandles once for a whole sweep over the cells. Only entries belonging to cell i are written.
+\param i the cell in question
+\param h_p the cell positions
+\param h_nn the number of neighbors of each cell
+\param h_n the neighbor lists, accessed via neigh_idx
+\param h_v voroCur
+\param h_vln voroLastNext
+\param h_AP the area and perimeter of each cell
+*/
+void voronoiModelBase::computeVoronoiGeometryCPU(int i, const Dscalar2 *h_p, const int *h_nn, const int *h_n,
+                                                 Dscalar2 *h_v, Dscalar4 *h_vln, Dscalar2 *h_AP)
+    {
+    int neigh = h_nn[i];
+    Dscalar2 pi = h_p[i];
 
-        nlastp = h_p.data[ns[ns.size()-1]];
-        Box->minDist(nlastp,pi,rij);
-        for (int nn = 0; nn < neigh;++nn)
+    //compute base set of voronoi points, BATCHWIDTH at a time. Unused lanes of the last batch repeat
+    //the first lane of that batch
+    Dscalar rijx[BATCHWIDTH],rijy[BATCHWIDTH],rikx[BATCHWIDTH],riky[BATCHWIDTH];
+    Dscalar vx[BATCHWIDTH],vy[BATCHWIDTH];
+    Dscalar2 rij, rik;
+    Box->minDist(h_p[h_n[neigh_idx(neigh-1,i)]],pi,rij);
+    for (int start = 0; start < neigh; start += BATCHWIDTH)
+        {
+        int lanes = min(BATCHWIDTH,neigh-start);
+        for (int l = 0; l < BATCHWIDTH; ++l)
             {
-            nnextp = h_p.data[ns[nn]];
-            Box->minDist(nnextp,pi,rik);
-            Circumcenter(rij,rik,circumcent);
-            voro[nn] = circumcent;
-            rij=rik;
-            int id = n_idx(nn,i);
-            h_v.data[id] = voro[nn];
+            if (l < lanes)
+                {
+                Box->minDist(h_p[h_n[neigh_idx(start+l,i)]],pi,rik);
+                rijx[l] = rij.x; rijy[l] = rij.y;
+                rikx[l] = rik.x; riky[l] = rik.y;
+                rij = rik;
+                }
+            else
+                {
+                rijx[l] = rijx[0]; rijy[l] = rijy[0];
+                rikx[l] = rikx[0]; riky[l] = riky[0];
+                };
             };
+        batchedCircumcenter<BATCHWIDTH>(rijx,rijy,rikx,riky,vx,vy);
+        for (int l = 0; l < lanes; ++l)
+            h_v[neigh_idx(start+l,i)] = make_Dscalar2(vx[l],vy[l]);
+        };
 
-        Dscalar2 vlast,vnext;
-        //compute Area and perimeter, and fill in voroLastNext structure
-        Dscalar Varea = 0.0;
-        Dscalar Vperi = 0.0;
-        vlast = voro[neigh-1];
-        for (int nn = 0; nn < neigh; ++nn)
+    //compute Area and perimeter, and fill in voroLastNext structure
+    Dscalar vlastx[BATCHWIDTH],vlasty[BATCHWIDTH],vnextx[BATCHWIDTH],vnexty[BATCHWIDTH];
+    Dscalar areas[BATCHWIDTH],edges[BATCHWIDTH];
+    Dscalar Varea = 0.0;
+    Dscalar Vperi = 0.0;
+    Dscalar2 vlast = h_v[neigh_idx(neigh-1,i)];
+    for (int start = 0; start < neigh; start += BATCHWIDTH)
+        {
+        int lanes = min(BATCHWIDTH,neigh-start);
+        for (int l = 0; l < BATCHWIDTH; ++l)
             {
-            vnext=voro[nn];
-            Varea += TriangleArea(vlast,vnext);
-            Dscalar dx = vlast.x-vnext.x;
-            Dscalar dy = vlast.y-vnext.y;
-            Vperi += sqrt(dx*dx+dy*dy);
-            int id = n_idx(nn,i);
-            h_vln.data[id].x=vlast.x;
-            h_vln.data[id].y=vlast.y;
-            h_vln.data[id].z=vnext.x;
-            h_vln.data[id].w=vnext.y;
-            vlast=vnext;
+            Dscalar2 vnext = h_v[neigh_idx(start+(l < lanes ? l : 0),i)];
+            vlastx[l] = l < lanes ? vlast.x : vlastx[0];
+            vlasty[l] = l < lanes ? vlast.y : vlasty[0];
+            vnextx[l] = vnext.x; vnexty[l] = vnext.y;
+            if (l < lanes)
+                vlast = vnext;
+            };
+        batchedTriangleAreaAndEdge<BATCHWIDTH>(vlastx,vlasty,vnextx,vnexty,areas,edges);
+        //accumulate in neighbor order
+        for (int l = 0; l < lanes; ++l)
+            {
+            Varea += areas[l];
+            Vperi += edges[l];
+            h_vln[neigh_idx(start+l,i)] = make_Dscalar4(vlastx[l],vlasty[l],vnextx[l],vnexty[l]);
             };
-        h_AP.data[i].x = Varea;
-        h_AP.data[i].y = Vperi;
         };
+    h_AP[i].x = Varea;
+    h_AP[i].y = Vperi;
     };
 
 /*!
@@ -929,7 +1308,7 @@ Dscalar2 voronoiModelBase::dAidrj(int i, int j)
     int n1, n2;
     for (int nn = 0; nn < neigh; ++nn)
         {
-        ns[nn] = h_n.data[n_idx(nn,i)];
+        ns[nn] = h_n.data[neigh_idx(nn,i)];
         if (ns[nn] ==j)
             {
             jIsANeighbor = true;
@@ -945,18 +1324,18 @@ Dscalar2 voronoiModelBase::dAidrj(int i, int j)
     //if i ==j, do the loop simply
     if ( i == j)
         {
-        vlast = h_v.data[n_idx(neigh-1,i)];
+        vlast = h_v.data[neigh_idx(neigh-1,i)];
         for (int vv = 0; vv < neigh; ++vv)
             {
-            vcur = h_v.data[n_idx(vv,i)];
-            vnext = h_v.data[n_idx((vv+1)%neigh,i)];
+            vcur = h_v.data[neigh_idx(vv,i)];
+            vnext = h_v.data[neigh_idx((vv+1)%neigh,i)];
             Dscalar2 dAdv;
             dAdv.x = -0.5*(vlast.y-vnext.y);
             dAdv.y = -0.5*(vnext.x-vlast.x);
 
             int indexk = vv - 1;
             if (indexk <0) indexk = neigh-1;
-            Dscalar2 temp = dAdv*dHdri(h_p.data[i],h_p.data[ h_n.data[n_idx(vv,i)] ],h_p.data[ h_n.data[n_idx(indexk,i)] ]);
+            Dscalar2 temp = dAdv*dHdri(h_p.data[i],h_p.data[ h_n.data[neigh_idx(vv,i)] ],h_p.data[ h_n.data[neigh_idx(indexk,i)] ]);
             answer.x += temp.x;
             answer.y += temp.y;
             vlast = vcur;
@@ -965,11 +1344,11 @@ Dscalar2 voronoiModelBase::dAidrj(int i, int j)
         };
 
     //otherwise, the interesting case
-    vlast = h_v.data[n_idx(neigh-1,i)];
+    vlast = h_v.data[neigh_idx(neigh-1,i)];
     for (int vv = 0; vv < neigh; ++vv)
         {
-        vcur = h_v.data[n_idx(vv,i)];
-        vnext = h_v.data[n_idx((vv+1)%neigh,i)];
+        vcur = h_v.data[neigh_idx(vv,i)];
+        vnext = h_v.data[neigh_idx((vv+1)%neigh,i)];
         if(vv == n1 || vv == n2)
             {
             int indexk;
@@ -982,7 +1361,7 @@ Dscalar2 voronoiModelBase::dAidrj(int i, int j)
             Dscalar2 dAdv;
             dAdv.x = -0.5*(vlast.y-vnext.y);
             dAdv.y = -0.5*(vnext.x-vlast.x);
-            Dscalar2 temp = dAdv*dHdri(h_p.data[j],h_p.data[i],h_p.data[ h_n.data[n_idx(indexk,i)] ]);
+            Dscalar2 temp = dAdv*dHdri(h_p.data[j],h_p.data[i],h_p.data[ h_n.data[neigh_idx(indexk,i)] ]);
             answer.x += temp.x;
             answer.y += temp.y;
             };
@@ -1016,7 +1395,7 @@ Dscalar2 voronoiModelBase::dPidrj(int i, int j)
     int n1, n2;
     for (int nn = 0; nn < neigh; ++nn)
         {
-        ns[nn] = h_n.data[n_idx(nn,i)];
+        ns[nn] = h_n.data[neigh_idx(nn,i)];
         if (ns[nn] ==j)
             {
             jIsANeighbor = true;
@@ -1032,11 +1411,11 @@ Dscalar2 voronoiModelBase::dPidrj(int i, int j)
     //if i ==j, do the loop simply
     if ( i == j)
         {
-        vlast = h_v.data[n_idx(neigh-1,i)];
+        vlast = h_v.data[neigh_idx(neigh-1,i)];
         for (int vv = 0; vv < neigh; ++vv)
             {
-            vcur = h_v.data[n_idx(vv,i)];
-            vnext = h_v.data[n_idx((vv+1)%neigh,i)];
+            vcur = h_v.data[neigh_idx(vv,i)];
+            vnext = h_v.data[neigh_idx((vv+1)%neigh,i)];
             Dscalar2 dPdv;
             Dscalar2 dlast,dnext;
             dlast.x = vlast.x-vcur.x;
@@ -1056,7 +1435,7 @@ Dscalar2 voronoiModelBase::dPidrj(int i, int j)
 
             int indexk = vv - 1;
             if (indexk <0) indexk = neigh-1;
-            Dscalar2 temp = dPdv*dHdri(h_p.data[i],h_p.data[ h_n.data[n_idx(vv,i)] ],h_p.data[ h_n.data[n_idx(indexk,i)] ]);
+            Dscalar2 temp = dPdv*dHdri(h_p.data[i],h_p.data[ h_n.data[neigh_idx(vv,i)] ],h_p.data[ h_n.data[neigh_idx(indexk,i)] ]);
             answer.x -= temp.x;
             answer.y -= temp.y;
             vlast = vcur;
@@ -1065,11 +1444,11 @@ Dscalar2 voronoiModelBase::dPidrj(int i, int j)
         };
 
     //otherwise, the interesting case
-    vlast = h_v.data[n_idx(neigh-1,i)];
+    vlast = h_v.data[neigh_idx(neigh-1,i)];
     for (int vv = 0; vv < neigh; ++vv)
         {
-        vcur = h_v.data[n_idx(vv,i)];
-        vnext = h_v.data[n_idx((vv+1)%neigh,i)];
+        vcur = h_v.data[neigh_idx(vv,i)];
+        vnext = h_v.data[neigh_idx((vv+1)%neigh,i)];
         if(vv == n1 || vv == n2)
             {
             int indexk;
@@ -1095,7 +1474,7 @@ Dscalar2 voronoiModelBase::dPidrj(int i, int j)
                 dlnorm = Pthreshold;
             dPdv.x = dlast.x/dlnorm - dnext.x/dnnorm;
             dPdv.y = dlast.y/dlnorm - dnext.y/dnnorm;
-            Dscalar2 temp = dPdv*dHdri(h_p.data[j],h_p.data[i],h_p.data[ h_n.data[n_idx(indexk,i)] ]);
+            Dscalar2 temp = dPdv*dHdri(h_p.data[j],h_p.data[i],h_p.data[ h_n.data[neigh_idx(indexk,i)] ]);
             answer.x -= temp.x;
             answer.y -= temp.y;
             };
@@ -1168,6 +1547,17 @@ NOTE: This function assumes that rj and rk are w/r/t the position of ri, so ri =
 vector<Dscalar> voronoiModelBase::d2Hdridrj(Dscalar2 rj, Dscalar2 rk, int jj)
     {
     vector<Dscalar> answer(8);
+    d2Hdridrj(rj,rk,jj,&answer[0]);
+    return answer;
+    };
+
+/*!
+Identical to the vector-returning d2Hdridrj, but writes the eight components, in the same layout, into
+caller-owned storage so that it can be called in inner loops without allocating.
+\param answer an array of (at least) 8 Dscalars to fill
+*/
+void voronoiModelBase::d2Hdridrj(Dscalar2 rj, Dscalar2 rk, int jj, Dscalar *answer)
+    {
     Dscalar hxr1xr2x, hyr1xr2x, hxr1yr2x,hyr1yr2x;
     Dscalar hxr1xr2y, hyr1xr2y, hxr1yr2y,hyr1yr2y;
     Dscalar rjx,rjy,rkx,rky;
@@ -1210,28 +1600,204 @@ vector<Dscalar> voronoiModelBase::d2Hdridrj(Dscalar2 rj, Dscalar2 rk, int jj)
     answer[5] = hyr1xr2y;
     answer[6] = hxr1yr2y;
     answer[7] = hyr1yr2y;
-    return answer;
     };
 
 /*!
-As the code is modified, all GPUArrays whose size depend on neighMax should be added to this function
-\post voroCur,voroLastNext, delSets, delOther, and forceSets grow to size neighMax*Ncells
+As the code is modified, all GPUArrays whose size depend on neighMax should be added to this function.
+Arrays that already have the right size are not reallocated.
+\post voroCur,voroLastNext, delSets, delOther, and forceSets have the size of the neighbor layout
+(neighMax*Ncells in the padded layout)
 */
 void voronoiModelBase::resetLists()
     {
-    voroCur.resize(neighMax*Ncells);
-    voroLastNext.resize(neighMax*Ncells);
-    delSets.resize(neighMax*Ncells);
-    delOther.resize(neighMax*Ncells);
-    forceSets.resize(neighMax*Ncells);
+    int listSize = neigh_idx.getNumElements();
+    if(voroCur.getNumElements() != listSize)
+        voroCur.resize(listSize);
+    if(voroLastNext.getNumElements() != listSize)
+        voroLastNext.resize(listSize);
+    if(delSets.getNumElements() != listSize)
+        delSets.resize(listSize);
+    if(delOther.getNumElements() != listSize)
+        delOther.resize(listSize);
+    if(forceSets.getNumElements() != listSize)
+        forceSets.resize(listSize);
+    };
+
+/*!
+In the padded layout every cell gets neighMax entries, with neighMax the smallest even number that
+is larger than any element of neighborNum (so that n_idx and neigh_idx agree). In the compressed
+layout cell i gets neighborNum[i]+neighborSlack entries.
+\param neighborNum the number of neighbors each cell needs room for
+\post neighMax, n_idx, neighborOffsets and neigh_idx describe the new layout, and cellNeighbors has
+its size. The contents of cellNeighbors are not moved.
+\return true if the position of any cell's entries changed, in which case the other
+neighbor-dependent arrays need to be reset
+*/
+bool voronoiModelBase::setNeighborLayout(const int *neighborNum)
+    {
+    int nmax = 0;
+    for (int ii = 0; ii < Ncells; ++ii)
+        if (neighborNum[ii] > nmax) nmax = neighborNum[ii];
+    if (nmax%2 == 0)
+        neighMax = nmax+2;
+    else
+        neighMax = nmax+1;
+    n_idx = Index2D(neighMax,Ncells);
+
+    vector<int> oldOffsets;
+    oldOffsets.swap(neighborOffsets);
+    neighborOffsets.resize(Ncells+1);
+    neighborOffsets[0] = 0;
+    for (int ii = 0; ii < Ncells; ++ii)
+        {
+        int capacity = compressedNeighbors ? neighborNum[ii]+neighborSlack : neighMax;
+        neighborOffsets[ii+1] = neighborOffsets[ii] + capacity;
+        };
+    neigh_idx = IndexCSR(&neighborOffsets[0],Ncells);
+
+    if(cellNeighbors.getNumElements() != neighborOffsets[Ncells])
+        cellNeighbors.resize(neighborOffsets[Ncells]);
+    return oldOffsets != neighborOffsets;
+    };
+
+/*!
+\param neighborNum the number of neighbors each cell needs room for
+\post the neighbor lists are copied into the layout given by setNeighborLayout(neighborNum); each
+cell keeps as many of its current neighbors as fit. NeighIdxs and the circumcenters are not updated.
+*/
+void voronoiModelBase::relayoutNeighbors(const vector<int> &neighborNum)
+    {
+    vector<int> oldOffsets(neighborOffsets);
+    vector<int> oldNeighbors;
+    {
+    ArrayHandle<int> ns(cellNeighbors,access_location::host,access_mode::read);
+    oldNeighbors.assign(ns.data,ns.data+cellNeighbors.getNumElements());
+    }
+    setNeighborLayout(&neighborNum[0]);
+
+    ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::read);
+    ArrayHandle<int> ns(cellNeighbors,access_location::host,access_mode::readwrite);
+    for (int ii = 0; ii < Ncells; ++ii)
+        {
+        int nmax = min(neighnum.data[ii],min(oldOffsets[ii+1]-oldOffsets[ii],neighborNum[ii]));
+        for (int nn = 0; nn < nmax; ++nn)
+            ns.data[neigh_idx(nn,ii)] = oldNeighbors[oldOffsets[ii]+nn];
+        };
+    };
+
+/*!
+\param cells the cells whose neighbor lists have changed
+\param neighs the flattened new neighbor lists, with those of cells[c] in neighs[start[c]] to neighs[stop[c]-1]
+\param start see above
+\param stop see above
+\post the neighbor lists of the cells are replaced, and NeighIdxs and circumcenters are patched
+(see removeLocalTopologyEntries). In the compressed layout a cell that has outgrown its entries
+causes the layout to be rebuilt around the new neighbor numbers, and neighMaxChange is set so that
+the other neighbor-dependent arrays are reset.
+\return false, without changing anything, if in the padded layout some cell has more than neighMax
+neighbors
+*/
+bool voronoiModelBase::setLocalNeighbors(const vector<int> &cells, const vector<int> &neighs,
+                                         const vector<int> &start, const vector<int> &stop)
+    {
+    bool fits = true;
+    for (int cc = 0; cc < cells.size(); ++cc)
+        if(stop[cc]-start[cc] > neigh_idx.getRowCapacity(cells[cc]))
+            fits = false;
+    if(!fits && !compressedNeighbors)
+        return false;
+
+    if(fits)
+        removeLocalTopologyEntries(cells);
+    else
+        {
+        vector<int> newNum;
+        {
+        ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::read);
+        newNum.assign(neighnum.data,neighnum.data+Ncells);
+        }
+        for (int cc = 0; cc < cells.size(); ++cc)
+            newNum[cells[cc]] = stop[cc]-start[cc];
+        relayoutNeighbors(newNum);
+        neighMaxChange = true;
+        };
+
+    {
+    ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::readwrite);
+    ArrayHandle<int> ns(cellNeighbors,access_location::host,access_mode::readwrite);
+    for (int cc = 0; cc < cells.size(); ++cc)
+        {
+        int pidx = cells[cc];
+        int imax = stop[cc]-start[cc];
+        neighnum.data[pidx] = imax;
+        for (int ii = 0; ii < imax; ++ii)
+            ns.data[neigh_idx(ii,pidx)] = neighs[start[cc]+ii];
+        };
+    }
+
+    if(fits)
+        addLocalTopologyEntries(cells);
+    else
+        {
+        updateNeighIdxs();
+        getCircumcenterIndices();
+        };
+    return true;
+    };
+
+/*!
+Switching layouts moves the current neighbor lists into the new layout and resets every
+neighbor-dependent array, so it can be done at any point of a simulation. The GPU kernels index the
+neighbor-dependent arrays with n_idx, so the compressed layout requires CPU operation.
+\param compress whether the compressed layout should be used
+*/
+void voronoiModelBase::setCompressedNeighbors(bool compress)
+    {
+    if(compress && GPUcompute)
+        {
+        printf("The compressed neighbor layout is only supported on the CPU...call setCPU() first\n");
+        throw std::exception();
+        };
+    if(compress == compressedNeighbors)
+        return;
+    compressedNeighbors = compress;
+    if(neighborOffsets.size() != Ncells+1)
+        return;
+
+    vector<int> neighborNum;
+    {
+    ArrayHandle<int> neighnum(cellNeighborNum,access_location::host,access_mode::read);
+    neighborNum.assign(neighnum.data,neighnum.data+Ncells);
+    }
+    relayoutNeighbors(neighborNum);
+    certificatesValid = false;
+    getCircumcenterIndices();
+    resetLists();
+    allDelSets();
+    neighMaxChange = false;
+    };
+
+/*!
+\param idx the cell in question
+\param nNeighs the number of neighbors of idx
+\param neighs the neighbors of idx, in CCW order
+*/
+void voronoiModelBase::getCellNeighs(int idx, int &nNeighs, vector<int> &neighs)
+    {
+    ArrayHandle<int> h_nn(cellNeighborNum,access_location::host,access_mode::read);
+    ArrayHandle<int> h_n(cellNeighbors,access_location::host,access_mode::read);
+    nNeighs = h_nn.data[idx];
+    neighs.resize(nNeighs);
+    for (int nn = 0; nn < nNeighs;++nn)
+        neighs[nn] = h_n.data[neigh_idx(nn,idx)];
     };
 
 /*!
 \param i the cell in question
 \post the delSet and delOther data structure for cell i is updated. Recall that
-delSet.data[n_idx(nn,i)] is an int2; the x and y parts store the index of the previous and next
-Delaunay neighbor, ordered CCW. delOther contains the mutual neighbor of delSet.data[n_idx(nn,i)].y
-and delSet.data[n_idx(nn,i)].z that isn't cell i
+delSet.data[neigh_idx(nn,i)] is an int2; the x and y parts store the index of the previous and next
+Delaunay neighbor, ordered CCW. delOther contains the mutual neighbor of delSet.data[neigh_idx(nn,i)].y
+and delSet.data[neigh_idx(nn,i)].z that isn't cell i
 */
 bool voronoiModelBase::getDelSets(int i)
     {
@@ -1242,28 +1808,28 @@ bool voronoiModelBase::getDelSets(int i)
 
     int iNeighs = neighnum.data[i];
     int nm2,nm1,n1,n2;
-    nm2 = ns.data[n_idx(iNeighs-3,i)];
-    nm1 = ns.data[n_idx(iNeighs-2,i)];
-    n1 = ns.data[n_idx(iNeighs-1,i)];
+    nm2 = ns.data[neigh_idx(iNeighs-3,i)];
+    nm1 = ns.data[neigh_idx(iNeighs-2,i)];
+    n1 = ns.data[neigh_idx(iNeighs-1,i)];
 
     for (int nn = 0; nn < iNeighs; ++nn)
         {
-        n2 = ns.data[n_idx(nn,i)];
+        n2 = ns.data[neigh_idx(nn,i)];
         int nextNeighs = neighnum.data[n1];
         for (int nn2 = 0; nn2 < nextNeighs; ++nn2)
             {
-            int testPoint = ns.data[n_idx(nn2,n1)];
+            int testPoint = ns.data[neigh_idx(nn2,n1)];
             if(testPoint == nm1)
                 {
-                dother.data[n_idx(nn,i)] = ns.data[n_idx((nn2+1)%nextNeighs,n1)];
+                dother.data[neigh_idx(nn,i)] = ns.data[neigh_idx((nn2+1)%nextNeighs,n1)];
                 break;
                 };
             };
-        ds.data[n_idx(nn,i)].x= nm1;
-        ds.data[n_idx(nn,i)].y= n1;
+        ds.data[neigh_idx(nn,i)].x= nm1;
+        ds.data[neigh_idx(nn,i)].y= n1;
 
         //is "delOther" a copy of i or either of the delSet points? if so, the local topology is inconsistent
-        if(nm1 == dother.data[n_idx(nn,i)] || n1 == dother.data[n_idx(nn,i)] || i == dother.data[n_idx(nn,i)])
+        if(nm1 == dother.data[neigh_idx(nn,i)] || n1 == dother.data[neigh_idx(nn,i)] || i == dother.data[neigh_idx(nn,i)])
             return false;
 
         nm2=nm1;
@@ -1285,45 +1851,22 @@ void voronoiModelBase::allDelSets()
         getDelSets(ii);
     };
 
-/*!
-A utility function for resizing data arrays... used by the cell division and cell death routines
-*/
-void voronoiModelBase::resizeAndReset()
-    {
-    //Simple resizing operations
-    displacements.resize(Ncells);
-    cellForces.resize(Ncells);
-    external_forces.resize(Ncells);
-    exclusions.resize(Ncells);
-    NeighIdxs.resize(6*(Ncells+10));
-    circumcenters.resize(2*(Ncells+10));
-    repair.resize(Ncells);
-
-    celllist.setNp(Ncells);
-    resetDelLocPoints();
-    cellNeighborNum.resize(Ncells);
-    //brute force fix of triangulation
-    globalTriangulationCGAL();
-    resetLists();
-    allDelSets();
-    };
-
 /*!
 Trigger a cell death event. In the Voronoi model this simply removes the targeted cell and instantaneously computes the new tesselation. Very violent, if the cell isn't already small.
+The triangulation is updated locally (only the former neighbors of the cell get new neighbor lists;
+see cellDivisionsAndDeaths), but since every cell with a higher index is relabeled the per-cell and
+neighbor arrays are still passed over once.
 */
 void voronoiModelBase::cellDeath(int cellIndex)
     {
-    //first, call the parent class routines.
-    //This call already changes Ncells
-    Simple2DActiveCell::cellDeath(cellIndex);
-    resizeAndReset();
+    cellDivisionsAndDeaths(vector<int>(),vector<Dscalar>(),vector<int>(1,cellIndex));
     };
 
 /*!
 Trigger a cell division event, which involves some laborious re-indexing of various data structures.
-This version uses a heavy-handed approach, hitting the cell positions with a full, global retriangulation
-(rather than just updating the targeted cell and its neighbor with the local topology repair routines).
-If a simulation is needed where the cell division rate is very rapid, this should be improved.
+The triangulation is updated by locally re-triangulating the neighborhood of the dividing cell (see
+cellDivisionsAndDeaths), rather than by a global re-triangulation; when several cells divide at the
+same time it is cheaper still to pass them all to cellDivisionsAndDeaths.
 The idea of the division is that a targeted cell will divide normal to an axis specified by the
 angle, theta, passed to the function. The final state cell positions are placed along the axis at a
 distance away from the initial cell position set by a multiplicative factor (<1) of the in-routine determined
@@ -1338,10 +1881,26 @@ cellPositions[new number of cells - 1])
 */
 void voronoiModelBase::cellDivision(const vector<int> &parameters, const vector<Dscalar> &dParams)
     {
-    int cellIdx = parameters[0];
-    Dscalar theta = dParams[0];
-    Dscalar separationFraction = dParams[1];
+    vector<Dscalar> divisionParameters(2);
+    divisionParameters[0] = dParams[0];
+    divisionParameters[1] = dParams[1];
+    cellDivisionsAndDeaths(vector<int>(1,parameters[0]),divisionParameters,vector<int>());
+    };
 
+/*!
+The voronoi cell is found from the current neighbor list of the cell (computeGeometry need not have
+been called), and the daughters are placed along the axis at angle theta, on opposite sides of the
+initial cell position, at separationFraction of the largest distance from that position to the cell
+boundary along the axis.
+\param cellIdx the dividing cell
+\param theta the angle of the division axis
+\param separationFraction the fraction (<1) of the maximum separation along the axis
+\param newCellPos1 the position of the first daughter (which keeps the index of the parent)
+\param newCellPos2 the position of the second daughter
+*/
+void voronoiModelBase::getDivisionPositions(int cellIdx, Dscalar theta, Dscalar separationFraction,
+                                            Dscalar2 &newCellPos1, Dscalar2 &newCellPos2)
+    {
     //First let's get the geometry of the cell in a convenient reference frame
     //computeGeometry has not yet been called, so need to find the voro positions
     vector<Dscalar2> voro;
@@ -1356,7 +1915,7 @@ void voronoiModelBase::cellDivision(const vector<int> &parameters, const vector<
     neigh = h_nn.data[cellIdx];
     vector<int> ns(neigh);
     for (int nn = 0; nn < neigh; ++nn)
-            ns[nn]=h_n.data[n_idx(nn,cellIdx)];
+            ns[nn]=h_n.data[neigh_idx(nn,cellIdx)];
     Dscalar2 circumcent;
     Dscalar2 nnextp,nlastp;
     Dscalar2 pi = h_p.data[cellIdx];
@@ -1405,18 +1964,379 @@ void voronoiModelBase::cellDivision(const vector<int> &parameters, const vector<
         v1=v2;
         };
     Dscalar maxSeparation = max(norm(p-Int1),norm(p-Int2));
-    Dscalar2 newCellPos1 = initialCellPosition + separationFraction*maxSeparation*ray;
-    Dscalar2 newCellPos2 = initialCellPosition - separationFraction*maxSeparation*ray;
+    newCellPos1 = initialCellPosition + separationFraction*maxSeparation*ray;
+    newCellPos2 = initialCellPosition - separationFraction*maxSeparation*ray;
     Box->putInBoxReal(newCellPos1);
     Box->putInBoxReal(newCellPos2);
+    };
+
+/*!
+Apply a batch of cell divisions and deaths with one pass over each per-cell array (see
+Simple2DCell::rebuildCellArrays) and a single, local update of the triangulation (see
+updateTopologyLocally), rather than an array copy and a global re-triangulation per event. A
+global triangulation is only performed if the local update fails.
+\param dividingCells the cells that divide, as in cellDivision
+\param divisionParameters the angle and separation fraction of each division (see cellDivision), so
+that division k uses divisionParameters[2*k] and divisionParameters[2*k+1]
+\param dyingCells the cells that are removed, as in cellDeath
+All indices refer to the cells as they are before the call, and no cell may appear twice in the two
+lists. The daughter positions are found from the tessellation at the start of the batch, and the
+triangulation is assumed to be Delaunay for the current positions (as it is after enforceTopology).
+Calling cellDivision once per event instead finds each division from the tessellation left by the
+previous ones, so when a dividing cell is near an earlier dividing cell (e.g., a neighbor) its
+daughters, and everything that depends on their positions, differ from the sequential result. They
+agree when no two dividing cells are within two neighbor shells of each other.
+\post the per-cell arrays and tags are ordered as if the divisions had been performed in order by
+cellDivision (so the k'th new cell is at index Ncells-dividingCells.size()+k, and takes its data from
+dividingCells[k]) and the dying cells had then been removed by cellDeath. The triangulation is up to
+date for the new positions, but computeGeometry needs to be called.
+*/
+void voronoiModelBase::cellDivisionsAndDeaths(const vector<int> &dividingCells, const vector<Dscalar> &divisionParameters,
+                                              const vector<int> &dyingCells)
+    {
+    int nDivisions = dividingCells.size();
+    if (divisionParameters.size() != 2*nDivisions)
+        {
+        printf("cellDivisionsAndDeaths needs two division parameters per dividing cell\n");
+        throw std::exception();
+        };
+    vector<int> removedCells(dividingCells);
+    removedCells.insert(removedCells.end(),dyingCells.begin(),dyingCells.end());
+    sort(removedCells.begin(),removedCells.end());
+    for (int cc = 0; cc < removedCells.size(); ++cc)
+        if (removedCells[cc] < 0 || removedCells[cc] >= Ncells || (cc > 0 && removedCells[cc] == removedCells[cc-1]))
+            {
+            printf("cellDivisionsAndDeaths: cell %i is out of range or listed more than once\n",removedCells[cc]);
+            throw std::exception();
+            };
+    if (removedCells.size() == 0)
+        return;
+
+    vector<Dscalar2> daughterPositions(2*nDivisions);
+    for (int dd = 0; dd < nDivisions; ++dd)
+        getDivisionPositions(dividingCells[dd],divisionParameters[2*dd],divisionParameters[2*dd+1],
+                             daughterPositions[2*dd],daughterPositions[2*dd+1]);
+
+    //deaths re-index the cells, so a copy of the triangulation is kept to be relabeled
+    vector<int> dying(dyingCells);
+    sort(dying.begin(),dying.end());
+    vector<int> oldNeighborNum, oldNeighbors, oldOffsets;
+    if (dying.size() > 0)
+        {
+        ArrayHandle<int> h_nn(cellNeighborNum,access_location::host,access_mode::read);
+        ArrayHandle<int> h_n(cellNeighbors,access_location::host,access_mode::read);
+        oldNeighborNum.assign(h_nn.data,h_nn.data+Ncells);
+        oldNeighbors.assign(h_n.data,h_n.data+cellNeighbors.getNumElements());
+        oldOffsets = neighborOffsets;
+        };
+
+    //survivors keep their order, and the daughters are appended
+    vector<int> cellSources;
+    cellSources.reserve(Ncells+nDivisions);
+    int nextDeath = 0;
+    for (int ii = 0; ii < Ncells; ++ii)
+        {
+        if (nextDeath < dying.size() && dying[nextDeath] == ii)
+            nextDeath += 1;
+        else
+            cellSources.push_back(ii);
+        };
+    for (int dd = 0; dd < nDivisions; ++dd)
+        cellSources.push_back(dividingCells[dd]);
 
-    //This call updates many of the base data structres, but (among other things) does not actually
-    //set the new cell position
-    Simple2DActiveCell::cellDivision(parameters);
+    rebuildCellArrays(cellSources,nDivisions);
+
+    vector<int> insertedCells;
     {
     ArrayHandle<Dscalar2> cp(cellPositions);
-    cp.data[cellIdx] = newCellPos1;
-    cp.data[Ncells-1] = newCellPos2;
+    for (int dd = 0; dd < nDivisions; ++dd)
+        {
+        int parent = dividingCells[dd] - (lower_bound(dying.begin(),dying.end(),dividingCells[dd])-dying.begin());
+        int daughter = Ncells-nDivisions+dd;
+        cp.data[parent] = daughterPositions[2*dd];
+        cp.data[daughter] = daughterPositions[2*dd+1];
+        //the appended daughters are binned by the next cell list update, but the parent has jumped
+        celllist.particleMoved(parent);
+        insertedCells.push_back(parent);
+        insertedCells.push_back(daughter);
+        };
     }
-    resizeAndReset();
+
+    if(!updateTopologyLocally(cellSources,nDivisions,removedCells,insertedCells,oldNeighborNum,oldNeighbors,oldOffsets))
+        {
+        globalTriangulationCGAL();
+        resetLists();
+        allDelSets();
+        neighMaxChange = false;
+        };
+    };
+
+/*!
+Besides the arrays of Simple2DActiveCell, the exclusions are carried over (a new cell is excluded if
+its parent is), and the other per-cell arrays of the Voronoi model are resized.
+*/
+void voronoiModelBase::rebuildCellArrays(const vector<int> &cellSources, int newCells)
+    {
+    bool reindexed = (cellSources.size()-newCells != Ncells);
+    Simple2DActiveCell::rebuildCellArrays(cellSources,newCells);
+    gatherGPUArrayElements(exclusions,cellSources);
+    displacements.resize(Ncells);
+    cellForces.resize(Ncells);
+    external_forces.resize(Ncells);
+    NeighIdxs.resize(6*(Ncells+10));
+    circumcenters.resize(2*(Ncells+10));
+    //new entries are zeroed
+    repair.resize(Ncells);
+    cellNeighborNum.resize(Ncells);
+    celllist.setNp(Ncells);
+    //as in spatialSorting, re-indexed cells are cheaper to re-bin from scratch
+    if (reindexed)
+        celllist.forgetParticleBins();
+    };
+
+/*!
+Deleting a point from a Delaunay triangulation only changes the neighbor lists of its old
+neighbors, and inserting a point only changes those of its new neighbors. The same is true of any
+number of deletions and insertions at once: each vertex of a triangle that is destroyed or created
+is an old neighbor of a deleted point or a new neighbor of an inserted one (any circle through that
+vertex which grows inside the triangle's circumcircle meets the deleted or inserted point first).
+So only the 1-rings of those cells are recomputed (by delLoc, from the current positions), and every
+other cell keeps its old neighbor list. A moved cell counts as both deleted and inserted.
+
+If no cell was removed, the surviving cells keep their indices and the new cells are given rows at
+the end of the neighbor-dependent arrays, so only the neighbor lists, NeighIdxs and circumcenter
+entries, and delSets and delOther of the changed cells and their neighbors are touched. Otherwise
+the old lists are relabeled and the auxiliary lists are rebuilt.
+\param cellSources the new cell i was the old cell cellSources[i] (see Simple2DCell::rebuildCellArrays)
+\param newCells the number of new cells, at the end of cellSources
+\param removedCells old indices of the cells that were deleted or moved
+\param insertedCells new indices of the cells that were created or moved
+\param oldNeighborNum the number of neighbors of each old cell, or empty if no cell was removed (in
+which case the old lists are read from the current neighbor arrays)
+\param oldNeighbors the old neighbor lists, with the nn'th neighbor of old cell i at oldNeighbors[oldOffsets[i]+nn]
+\param oldOffsets see above
+\return false if a local triangulation failed or the new lists are not consistent with each other
+(the triangulation then needs to be recomputed globally)
+\post the neighbor lists, NeighIdxs, circumcenters, delSets and delOther describe the new triangulation
+*/
+bool voronoiModelBase::updateTopologyLocally(const vector<int> &cellSources, int newCells, const vector<int> &removedCells,
+                        const vector<int> &insertedCells, const vector<int> &oldNeighborNum,
+                        const vector<int> &oldNeighbors, const vector<int> &oldOffsets)
+    {
+    flipTriangulationInitialized = false;
+    certificatesValid = false;
+    resetDelLocPoints();
+    ArrayHandle<Dscalar2> h_delPoints(cellPositions,access_location::host,access_mode::read);
+    DelaunayLocBinding delLocPoints(delLoc,h_delPoints.data,Ncells,&celllist);
+    bool relabeled = oldNeighborNum.size() > 0;
+    int firstNewCell = Ncells-newCells;
+    vector<int> newIndex;
+    if (relabeled)
+        {
+        newIndex.assign(oldNeighborNum.size(),-1);
+        for (int ii = 0; ii < firstNewCell; ++ii)
+            newIndex[cellSources[ii]] = ii;
+        };
+
+    //find the new 1-rings of the inserted cells, and then of every other cell whose neighbors may have changed
+    vector<int> insertedNeighs, insertedStart, insertedStop;
+    if(!delLoc.getNeighborsLocal(insertedCells,insertedNeighs,insertedStart,insertedStop,nThreads))
+        return false;
+    vector<int> sortedInserted(insertedCells);
+    sort(sortedInserted.begin(),sortedInserted.end());
+
+    vector<int> fixlist, fixNeighs, fixStart, fixStop;
+    vector<int> changedCells, changedList;
+    vector<int> allNum, allStart, allNeighs;
+    {//scope for the current neighbor arrays, which hold the old lists if no cell was removed
+    ArrayHandle<int> h_nn(cellNeighborNum,access_location::host,access_mode::read);
+    ArrayHandle<int> h_n(cellNeighbors,access_location::host,access_mode::read);
+    //the old neighbors of an old cell, with their new indices (-1 for removed cells)
+    vector<int> ns;
+    auto getOldNeighbors = [&](int oldCell)
+        {
+        ns.clear();
+        if (relabeled)
+            for (int nn = 0; nn < oldNeighborNum[oldCell]; ++nn)
+                ns.push_back(newIndex[oldNeighbors[oldOffsets[oldCell]+nn]]);
+        else
+            for (int nn = 0; nn < h_nn.data[oldCell]; ++nn)
+                ns.push_back(h_n.data[neigh_idx(nn,oldCell)]);
+        };
+
+    for (int cc = 0; cc < removedCells.size(); ++cc)
+        {
+        getOldNeighbors(removedCells[cc]);
+        for (int nn = 0; nn < ns.size(); ++nn)
+            if (ns[nn] >= 0 && !binary_search(sortedInserted.begin(),sortedInserted.end(),ns[nn]))
+                fixlist.push_back(ns[nn]);
+        };
+    for (int nn = 0; nn < insertedNeighs.size(); ++nn)
+        if (!binary_search(sortedInserted.begin(),sortedInserted.end(),insertedNeighs[nn]))
+            fixlist.push_back(insertedNeighs[nn]);
+    sort(fixlist.begin(),fixlist.end());
+    fixlist.erase(unique(fixlist.begin(),fixlist.end()),fixlist.end());
+    if(!delLoc.getNeighborsLocal(fixlist,fixNeighs,fixStart,fixStop,nThreads))
+        return false;
+
+    //all changed cells, sorted, with changedList pointing at their lists (inserted cells first, then the fixlist)
+    vector<pair<int,int> > changed;
+    for (int cc = 0; cc < insertedCells.size(); ++cc)
+        changed.push_back(make_pair(insertedCells[cc],cc));
+    for (int cc = 0; cc < fixlist.size(); ++cc)
+        changed.push_back(make_pair(fixlist[cc],insertedCells.size()+cc));
+    sort(changed.begin(),changed.end());
+    for (int cc = 0; cc < changed.size(); ++cc)
+        {
+        changedCells.push_back(changed[cc].first);
+        changedList.push_back(changed[cc].second);
+        };
+    auto newList = [&](int list, int &first, int &last) -> const int *
+        {
+        if (list < insertedCells.size())
+            {
+            first = insertedStart[list]; last = insertedStop[list];
+            return &insertedNeighs[0];
+            };
+        list -= insertedCells.size();
+        first = fixStart[list]; last = fixStop[list];
+        return &fixNeighs[0];
+        };
+    auto changedPosition = [&](int cell) -> int
+        {
+        vector<int>::iterator it = lower_bound(changedCells.begin(),changedCells.end(),cell);
+        return (it != changedCells.end() && *it == cell) ? it-changedCells.begin() : -1;
+        };
+
+    //every neighbor relation involving a changed cell must be mutual
+    for (int cc = 0; cc < changedCells.size(); ++cc)
+        {
+        int cell = changedCells[cc];
+        int first,last;
+        const int *list = newList(changedList[cc],first,last);
+        for (int nn = first; nn < last; ++nn)
+            {
+            int neighbor = list[nn];
+            if (neighbor < 0 || neighbor >= Ncells || neighbor == cell)
+                return false;
+            int pos = changedPosition(neighbor);
+            if (pos >= 0)
+                {
+                int f2,l2;
+                const int *list2 = newList(changedList[pos],f2,l2);
+                if (find(list2+f2,list2+l2,cell) == list2+l2)
+                    return false;
+                }
+            else
+                {
+                getOldNeighbors(relabeled ? cellSources[neighbor] : neighbor);
+                if (find(ns.begin(),ns.end(),cell) == ns.end())
+                    return false;
+                };
+            };
+        if (binary_search(sortedInserted.begin(),sortedInserted.end(),cell))
+            continue;
+        getOldNeighbors(relabeled ? cellSources[cell] : cell);
+        for (int nn = 0; nn < ns.size(); ++nn)
+            if (ns[nn] >= 0 && changedPosition(ns[nn]) < 0 && find(list+first,list+last,ns[nn]) == list+last)
+                return false;
+        };
+
+    //after a relabeling every list is rewritten, otherwise only those of the changed cells
+    if (!relabeled)
+        {
+        for (int cc = 0; cc < changedCells.size(); ++cc)
+            {
+            int first,last;
+            const int *list = newList(changedList[cc],first,last);
+            allStart.push_back(allNeighs.size());
+            allNeighs.insert(allNeighs.end(),list+first,list+last);
+            allNum.push_back(last-first);
+            };
+        }
+    else
+        {
+        allNum.resize(Ncells);
+        allStart.resize(Ncells);
+        allNeighs.reserve(6*Ncells);
+        for (int ii = 0; ii < Ncells; ++ii)
+            {
+            allStart[ii] = allNeighs.size();
+            int pos = changedPosition(ii);
+            if (pos < 0)
+                {
+                getOldNeighbors(cellSources[ii]);
+                allNeighs.insert(allNeighs.end(),ns.begin(),ns.end());
+                }
+            else
+                {
+                int first,last;
+                const int *list = newList(changedList[pos],first,last);
+                allNeighs.insert(allNeighs.end(),list+first,list+last);
+                };
+            allNum[ii] = allNeighs.size()-allStart[ii];
+            };
+        };
+    }//end scope
+    localTopologyUpdates += changedCells.size();
+
+    if (relabeled)
+        {
+        if(setNeighborLayout(&allNum[0]))
+            neighMaxChange = true;
+        {
+        ArrayHandle<int> h_nn(cellNeighborNum,access_location::host,access_mode::overwrite);
+        ArrayHandle<int> h_n(cellNeighbors,access_location::host,access_mode::readwrite);
+        for (int ii = 0; ii < Ncells; ++ii)
+            {
+            h_nn.data[ii] = allNum[ii];
+            for (int nn = 0; nn < allNum[ii]; ++nn)
+                h_n.data[neigh_idx(nn,ii)] = allNeighs[allStart[ii]+nn];
+            };
+        }
+        completeRetriangulationPerformed = 1;
+        updateNeighIdxs();
+        getCircumcenterIndices();
+        resetLists();
+        allDelSets();
+        neighMaxChange = false;
+        return true;
+        };
+
+    //give the new cells (empty) rows at the end of the neighbor-dependent arrays...
+    for (int ii = firstNewCell; ii < Ncells; ++ii)
+        {
+        int pos = lower_bound(changedCells.begin(),changedCells.end(),ii)-changedCells.begin();
+        int capacity = compressedNeighbors ? allNum[pos]+neighborSlack : neighMax;
+        neighborOffsets.push_back(neighborOffsets.back()+capacity);
+        };
+    neigh_idx = IndexCSR(&neighborOffsets[0],Ncells);
+    n_idx = Index2D(neighMax,Ncells);
+    cellNeighbors.resize(neighborOffsets[Ncells]);
+    neighIdxPosition.resize(neighborOffsets[Ncells],-1);
+    circumcenterPosition.resize(neighborOffsets[Ncells],-1);
+    circumcenterOwner.resize(circumcenters.getNumElements());
+
+    //...and patch the lists of the changed cells in place
+    vector<int> allStop(changedCells.size());
+    for (int cc = 0; cc < changedCells.size(); ++cc)
+        allStop[cc] = allStart[cc]+allNum[cc];
+    if(!setLocalNeighbors(changedCells,allNeighs,allStart,allStop))
+        return false;
+    resetLists();
+    if(neighMaxChange)
+        {
+        allDelSets();
+        neighMaxChange = false;
+        return true;
+        };
+    //the delSets of a cell depend on the neighbor lists of its neighbors, too
+    vector<int> delSetCells(changedCells);
+    delSetCells.insert(delSetCells.end(),allNeighs.begin(),allNeighs.end());
+    sort(delSetCells.begin(),delSetCells.end());
+    delSetCells.erase(unique(delSetCells.begin(),delSetCells.end()),delSetCells.end());
+    for (int cc = 0; cc < delSetCells.size(); ++cc)
+        if(!getDelSets(delSetCells[cc]))
+            return false;
+    return true;
     };
@@ -3,6 +3,8 @@
 #include "voronoiQuadraticEnergy.h"
 #include "voronoiQuadraticEnergy.cuh"
 #include "cuda_profiler_api.h"
+#include "parallelLoops.h"
+#include "batchedFunctions.h"
 /*! \file voronoiQuadraticEnergy.cpp */
 
 /*!
@@ -51,7 +53,8 @@ void VoronoiQuadraticEnergy::initializeVoronoiQuadraticEnergy(int n)
 
 /*!
 goes through the process of computing the forces on either the CPU or GPU, either with or without
-exclusions, as determined by the flags. Assumes the geometry has NOT yet been computed.
+exclusions, as determined by the flags. Assumes the geometry has NOT yet been computed. On the CPU
+this is a single call to computeGeometryAndForcesCPU, which also computes the energy.
 \post the geometry is computed, and force per cell is computed.
 */
 void VoronoiQuadraticEnergy::computeForces()
@@ -59,17 +62,14 @@ void VoronoiQuadraticEnergy::computeForces()
     if(forcesUpToDate)
        return; 
     forcesUpToDate = true;
-    computeGeometry();
     if (GPUcompute)
         {
+        computeGeometry();
         ComputeForceSetsGPU();
         SumForcesGPU();
         }
     else
-        {
-        for (int ii = 0; ii < Ncells; ++ii)
-            computeVoronoiForceCPU(ii);
-        };
+        computeGeometryAndForcesCPU();
     };
 
 /*!
@@ -166,13 +166,11 @@ void VoronoiQuadraticEnergy::computeVoronoiForceSetsGPU()
     };
 
 /*!
-\param i The particle index for which to compute the net force, assuming addition tension terms between unlike particles
+\param i The particle index for which to compute the net force
 \post the net force on cell i is computed
 */
 void VoronoiQuadraticEnergy::computeVoronoiForceCPU(int i)
     {
-    Dscalar Pthreshold = THRESHOLD;
-
     //read in all the data we'll need
     ArrayHandle<Dscalar2> h_p(cellPositions,access_location::host,access_mode::read);
     ArrayHandle<Dscalar2> h_f(cellForces,access_location::host,access_mode::readwrite);
@@ -183,216 +181,321 @@ void VoronoiQuadraticEnergy::computeVoronoiForceCPU(int i)
     ArrayHandle<int> h_nn(cellNeighborNum,access_location::host,access_mode::read);
     ArrayHandle<int> h_n(cellNeighbors,access_location::host,access_mode::read);
 
-    ArrayHandle<Dscalar2> h_external_forces(external_forces,access_location::host,access_mode::overwrite);
+    ArrayHandle<Dscalar2> h_external_forces(external_forces,access_location::host,access_mode::readwrite);
     ArrayHandle<int> h_exes(exclusions,access_location::host,access_mode::read);
 
-    //get Delaunay neighbors of the cell
-    int neigh = h_nn.data[i];
-    vector<int> ns(neigh);
-    for (int nn = 0; nn < neigh; ++nn)
-        {
-        ns[nn]=h_n.data[n_idx(nn,i)];
-        };
-
-    //compute base set of voronoi points, and the derivatives of those points w/r/t cell i's position
-    vector<Dscalar2> voro(neigh);
-    vector<Matrix2x2> dhdri(neigh);
-    Matrix2x2 Id;
-    Dscalar2 circumcent;
-    Dscalar2 rij,rik;
-    Dscalar2 nnextp,nlastp;
-    Dscalar2 rjk;
-    Dscalar2 pi = h_p.data[i];
-
-    nlastp = h_p.data[ns[ns.size()-1]];
-    Box->minDist(nlastp,pi,rij);
-    for (int nn = 0; nn < neigh;++nn)
-        {
-        int id = n_idx(nn,i);
-        nnextp = h_p.data[ns[nn]];
-        Box->minDist(nnextp,pi,rik);
-        voro[nn] = h_v.data[id];
-        rjk.x =rik.x-rij.x;
-        rjk.y =rik.y-rij.y;
+    computeVoronoiForceCPU(i,h_p.data,h_v.data,h_nn.data,h_n.data,h_f.data,h_external_forces.data,h_exes.data,
+                           quadraticAreaPerimeterEnergy(KA,KP,h_AP.data,h_APpref.data),noEdgeTension());
+    };
 
-        Dscalar2 dbDdri,dgDdri,dDdriOD,z;
-        Dscalar betaD = -dot(rik,rik)*dot(rij,rjk);
-        Dscalar gammaD = dot(rij,rij)*dot(rik,rjk);
-        Dscalar cp = rij.x*rjk.y - rij.y*rjk.x;
-        Dscalar D = 2*cp*cp;
+/*!
+Computes the geometry of every cell, the energy, and the net force on every cell on the CPU with the
+ArrayHandles acquired only once, and without any per-cell allocations. The force on a cell depends on
+the areas and perimeters of its neighbors, so the geometry of all cells is found first, and the
+energy is accumulated along with it. The results are identical to computeGeometryCPU followed by
+computeVoronoiForceCPU(i) for every cell and computeEnergy. Each sweep is split over nThreads
+threads; since every cell writes only its own entries the results do not depend on nThreads.
+\post the geometry, cellForces, and Energy are current
+*/
+void VoronoiQuadraticEnergy::computeGeometryAndForcesCPU()
+    {
+    ArrayHandle<Dscalar2> h_p(cellPositions,access_location::host,access_mode::read);
+    ArrayHandle<Dscalar2> h_AP(AreaPeri,access_location::host,access_mode::readwrite);
+    ArrayHandle<Dscalar2> h_APpref(AreaPeriPreferences,access_location::host,access_mode::read);
+    ArrayHandle<int> h_nn(cellNeighborNum,access_location::host,access_mode::read);
+    ArrayHandle<int> h_n(cellNeighbors,access_location::host,access_mode::read);
+    ArrayHandle<Dscalar2> h_v(voroCur,access_location::host,access_mode::overwrite);
+    ArrayHandle<Dscalar4> h_vln(voroLastNext,access_location::host,access_mode::overwrite);
 
-        z.x = betaD*rij.x+gammaD*rik.x;
-        z.y = betaD*rij.y+gammaD*rik.y;
+    ArrayHandle<Dscalar2> h_f(cellForces,access_location::host,access_mode::overwrite);
+    ArrayHandle<Dscalar2> h_external_forces(external_forces,access_location::host,access_mode::readwrite);
+    ArrayHandle<int> h_exes(exclusions,access_location::host,access_mode::read);
 
-        dbDdri.x = 2*dot(rij,rjk)*rik.x+dot(rik,rik)*rjk.x;
-        dbDdri.y = 2*dot(rij,rjk)*rik.y+dot(rik,rik)*rjk.y;
+    //every cell writes only its own entries, so both sweeps can be split over threads
+    parallelFor(Ncells,nThreads,[&](int i)
+        {
+        computeVoronoiGeometryCPU(i,h_p.data,h_nn.data,h_n.data,h_v.data,h_vln.data,h_AP.data);
+        });
 
-        dgDdri.x = -2*dot(rik,rjk)*rij.x-dot(rij,rij)*rjk.x;
-        dgDdri.y = -2*dot(rik,rjk)*rij.y-dot(rij,rij)*rjk.y;
+    //accumulate the energy in a fixed order, so that it does not depend on the number of threads
+    quadraticAreaPerimeterEnergy cellEnergy(KA,KP,h_AP.data,h_APpref.data);
+    Energy = cellEnergy.totalEnergy(Ncells,accumulation);
 
-        dDdriOD.x = (-2.0*rjk.y)/cp;
-        dDdriOD.y = (2.0*rjk.x)/cp;
+    parallelFor(Ncells,nThreads,[&](int i)
+        {
+        computeVoronoiForceCPU(i,h_p.data,h_v.data,h_nn.data,h_n.data,h_f.data,h_external_forces.data,h_exes.data,
+                               cellEnergy,noEdgeTension());
+        });
+    };
 
-        dhdri[nn] = Id+1.0/D*(dyad(rij,dbDdri)+dyad(rik,dgDdri)-(betaD+gammaD)*Id-dyad(z,dDdriOD));
+/*!
+The per-cell work of computeVoronoiForceCPU(i), acting on host pointers, for an energy described by
+the policies of energyPolicies.h. The derivatives of the voronoi vertices with respect to the position
+of cell i are computed as they are needed, a batch of vertices at a time, so no scratch space beyond a
+few stack arrays is required. Only entries of cell i are written. The VoronoiQuadraticEnergyWithTension
+forces are this routine with a uniformEdgeTension or a matrixEdgeTension.
+\param i The particle index for which to compute the net force
+\param h_p the cell positions
+\param h_v voroCur
+\param h_nn the number of neighbors of each cell
+\param h_n the neighbor lists, accessed via neigh_idx
+\param h_f the net forces
+\param h_external_forces the external force that keeps an excluded cell in place
+\param h_exes which cells are excluded
+\param energy supplies the derivatives of each cell's energy with respect to its area and perimeter
+\param tension supplies the line tension of the edge between two cells
+*/
+template<class CellEnergy, class EdgeTension>
+void VoronoiQuadraticEnergy::computeVoronoiForceCPU(int i, const Dscalar2 *h_p, const Dscalar2 *h_v,
+                    const int *h_nn, const int *h_n, Dscalar2 *h_f, Dscalar2 *h_external_forces, const int *h_exes,
+                    const CellEnergy &energy, const EdgeTension &tension)
+    {
+    Dscalar Pthreshold = THRESHOLD;
 
-        rij=rik;
-        };
+    int neigh = h_nn[i];
+    Dscalar2 pi = h_p[i];
 
     Dscalar2 vlast,vnext,vother;
 
     //start calculating forces
-    Dscalar2 forceSum;
+    Daccum2 forceSum;
     forceSum.x=0.0;forceSum.y=0.0;
 
-    Dscalar Adiff = KA*(h_AP.data[i].x - h_APpref.data[i].x);
-    Dscalar Pdiff = KP*(h_AP.data[i].y - h_APpref.data[i].y);
+    Dscalar2 dEidAP = energy.halfdEdAP(i);
+    Dscalar Adiff = dEidAP.x;
+    Dscalar Pdiff = dEidAP.y;
+
+    //the voronoi vertices are handled BATCHWIDTH at a time: first the relative positions of the
+    //three cells around the vertex shared with the next voronoi vertex are gathered, then the
+    //circumcenters and the derivatives of the vertex positions are computed by the batched routines
+    //in batchedFunctions.h, and finally the contributions are added up in neighbor order
+    Dscalar r1x[BATCHWIDTH],r1y[BATCHWIDTH],r2x[BATCHWIDTH],r2y[BATCHWIDTH],r3x[BATCHWIDTH],r3y[BATCHWIDTH];
+    Dscalar vox[BATCHWIDTH],voy[BATCHWIDTH];
+    Dscalar dh11[BATCHWIDTH],dh12[BATCHWIDTH],dh21[BATCHWIDTH],dh22[BATCHWIDTH];
+    int baseNeighs[BATCHWIDTH],otherNeighs[BATCHWIDTH];
 
     Dscalar2 vcur;
-    vlast = voro[neigh-1];
-    for(int nn = 0; nn < neigh; ++nn)
+    vlast = h_v[neigh_idx(neigh-1,i)];
+    for (int start = 0; start < neigh; start += BATCHWIDTH)
         {
-        //first, let's do the self-term, dE_i/dr_i
-        vcur = voro[nn];
-        vnext = voro[(nn+1)%neigh];
-        int baseNeigh = ns[nn];
-        int other_idx = nn - 1;
-        if (other_idx < 0) other_idx += neigh;
-        int otherNeigh = ns[other_idx];
-
-        Dscalar2 dAidv,dPidv;
-        dAidv.x = 0.5*(vlast.y-vnext.y);
-        dAidv.y = 0.5*(vnext.x-vlast.x);
-
-        Dscalar2 dlast,dnext;
-        dlast.x = vlast.x-vcur.x;
-        dlast.y=vlast.y-vcur.y;
-
-        Dscalar dlnorm = sqrt(dlast.x*dlast.x+dlast.y*dlast.y);
-
-        dnext.x = vcur.x-vnext.x;
-        dnext.y = vcur.y-vnext.y;
-        Dscalar dnnorm = sqrt(dnext.x*dnext.x+dnext.y*dnext.y);
-        if(dnnorm < Pthreshold)
-            dnnorm = Pthreshold;
-        if(dlnorm < Pthreshold)
-            dlnorm = Pthreshold;
-        dPidv.x = dlast.x/dlnorm - dnext.x/dnnorm;
-        dPidv.y = dlast.y/dlnorm - dnext.y/dnnorm;
-
-        //
-        //now let's compute the other terms...first we need to find the third voronoi
-        //position that v_cur is connected to
-        //
-        int neigh2 = h_nn.data[baseNeigh];
-        int DT_other_idx=-1;
-        for (int n2 = 0; n2 < neigh2; ++n2)
-            {
-            int testPoint = h_n.data[n_idx(n2,baseNeigh)];
-            if(testPoint == otherNeigh) DT_other_idx = h_n.data[n_idx((n2+1)%neigh2,baseNeigh)];
-            };
-        if(DT_other_idx == otherNeigh || DT_other_idx == baseNeigh || DT_other_idx == -1)
+        int lanes = min(BATCHWIDTH,neigh-start);
+        for (int l = 0; l < BATCHWIDTH; ++l)
             {
-            printf("Triangulation problem %i\n",DT_other_idx);
-            throw std::exception();
+            if (l >= lanes)
+                {
+                r1x[l] = r1x[0]; r1y[l] = r1y[0];
+                r2x[l] = r2x[0]; r2y[l] = r2y[0];
+                r3x[l] = r3x[0]; r3y[l] = r3y[0];
+                continue;
+                };
+            int nn = start+l;
+            int baseNeigh = h_n[neigh_idx(nn,i)];
+            int other_idx = nn - 1;
+            if (other_idx < 0) other_idx += neigh;
+            int otherNeigh = h_n[neigh_idx(other_idx,i)];
+            baseNeighs[l] = baseNeigh;
+            otherNeighs[l] = otherNeigh;
+
+            //find the third voronoi position that v_cur is connected to
+            int neigh2 = h_nn[baseNeigh];
+            int DT_other_idx=-1;
+            for (int n2 = 0; n2 < neigh2; ++n2)
+                {
+                int testPoint = h_n[neigh_idx(n2,baseNeigh)];
+                if(testPoint == otherNeigh) DT_other_idx = h_n[neigh_idx((n2+1)%neigh2,baseNeigh)];
+                };
+            if(DT_other_idx == otherNeigh || DT_other_idx == baseNeigh || DT_other_idx == -1)
+                {
+                printf("Triangulation problem %i\n",DT_other_idx);
+                throw std::exception();
+                };
+
+            Dscalar2 r1,r2,r3;
+            Box->minDist(h_p[otherNeigh],pi,r1);
+            Box->minDist(h_p[baseNeigh],pi,r2);
+            Box->minDist(h_p[DT_other_idx],pi,r3);
+            r1x[l] = r1.x; r1y[l] = r1.y;
+            r2x[l] = r2.x; r2y[l] = r2.y;
+            r3x[l] = r3.x; r3y[l] = r3.y;
             };
-        Dscalar2 nl1 = h_p.data[otherNeigh];
-        Dscalar2 nn1 = h_p.data[baseNeigh];
-        Dscalar2 no1 = h_p.data[DT_other_idx];
+        batchedCircumcenter<BATCHWIDTH>(r1x,r1y,r2x,r2y,r3x,r3y,vox,voy);
+        //the derivative of the voronoi vertex shared with otherNeigh and baseNeigh w/r/t cell i's position
+        batchedVoronoiVertexDerivative<BATCHWIDTH>(r1x,r1y,r2x,r2y,dh11,dh12,dh21,dh22);
 
-        Dscalar2 r1,r2,r3;
-        Box->minDist(nl1,pi,r1);
-        Box->minDist(nn1,pi,r2);
-        Box->minDist(no1,pi,r3);
+        for (int l = 0; l < lanes; ++l)
+            {
+            int nn = start+l;
+            int baseNeigh = baseNeighs[l];
+            int otherNeigh = otherNeighs[l];
+            vcur = h_v[neigh_idx(nn,i)];
+            vnext = h_v[neigh_idx((nn+1)%neigh,i)];
+            vother.x = vox[l];
+            vother.y = voy[l];
+
+            //first, let's do the self-term, dE_i/dr_i
+            Dscalar2 dAidv,dPidv;
+            dAidv.x = 0.5*(vlast.y-vnext.y);
+            dAidv.y = 0.5*(vnext.x-vlast.x);
 
-        Circumcenter(r1,r2,r3,vother);
+            Dscalar2 dlast,dnext;
+            dlast.x = vlast.x-vcur.x;
+            dlast.y=vlast.y-vcur.y;
 
-        Dscalar Akdiff = KA*(h_AP.data[baseNeigh].x  - h_APpref.data[baseNeigh].x);
-        Dscalar Pkdiff = KP*(h_AP.data[baseNeigh].y  - h_APpref.data[baseNeigh].y);
-        Dscalar Ajdiff = KA*(h_AP.data[otherNeigh].x - h_APpref.data[otherNeigh].x);
-        Dscalar Pjdiff = KP*(h_AP.data[otherNeigh].y - h_APpref.data[otherNeigh].y);
+            Dscalar dlnorm = sqrt(dlast.x*dlast.x+dlast.y*dlast.y);
 
-        Dscalar2 dAkdv,dPkdv;
-        dAkdv.x = 0.5*(vnext.y-vother.y);
-        dAkdv.y = 0.5*(vother.x-vnext.x);
+            dnext.x = vcur.x-vnext.x;
+            dnext.y = vcur.y-vnext.y;
+            Dscalar dnnorm = sqrt(dnext.x*dnext.x+dnext.y*dnext.y);
+            if(dnnorm < Pthreshold)
+                dnnorm = Pthreshold;
+            if(dlnorm < Pthreshold)
+                dlnorm = Pthreshold;
+            dPidv.x = dlast.x/dlnorm - dnext.x/dnnorm;
+            dPidv.y = dlast.y/dlnorm - dnext.y/dnnorm;
 
-        dlast.x = vnext.x-vcur.x;
-        dlast.y=vnext.y-vcur.y;
-        dlnorm = sqrt(dlast.x*dlast.x+dlast.y*dlast.y);
-        dnext.x = vcur.x-vother.x;
-        dnext.y = vcur.y-vother.y;
-        dnnorm = sqrt(dnext.x*dnext.x+dnext.y*dnext.y);
-        if(dnnorm < Pthreshold)
-            dnnorm = Pthreshold;
-        if(dlnorm < Pthreshold)
-            dlnorm = Pthreshold;
+            //line tensions of the edges ik (between vcur and vnext), ij (vlast-vcur), and kj (vcur-vother)
+            Dscalar tik = 0.0, tij = 0.0, tkj = 0.0;
+            Dscalar2 dTidv,dTkdv,dTjdv;
+            if (EdgeTension::active)
+                {
+                tik = tension(i,baseNeigh);
+                tij = tension(i,otherNeigh);
+                tkj = tension(baseNeigh,otherNeigh);
+                dTidv.x = 0.0;
+                dTidv.y = 0.0;
+                dTidv.x -= tik*dnext.x/dnnorm;
+                dTidv.y -= tik*dnext.y/dnnorm;
+                dTidv.x += tij*dlast.x/dlnorm;
+                dTidv.y += tij*dlast.y/dlnorm;
+                };
 
-        dPkdv.x = dlast.x/dlnorm - dnext.x/dnnorm;
-        dPkdv.y = dlast.y/dlnorm - dnext.y/dnnorm;
+            //now the terms from the two other cells that share vcur
+            Dscalar2 dEkdAP = energy.halfdEdAP(baseNeigh);
+            Dscalar2 dEjdAP = energy.halfdEdAP(otherNeigh);
+            Dscalar Akdiff = dEkdAP.x;
+            Dscalar Pkdiff = dEkdAP.y;
+            Dscalar Ajdiff = dEjdAP.x;
+            Dscalar Pjdiff = dEjdAP.y;
+
+            Dscalar2 dAkdv,dPkdv;
+            dAkdv.x = 0.5*(vnext.y-vother.y);
+            dAkdv.y = 0.5*(vother.x-vnext.x);
+
+            dlast.x = vnext.x-vcur.x;
+            dlast.y=vnext.y-vcur.y;
+            dlnorm = sqrt(dlast.x*dlast.x+dlast.y*dlast.y);
+            dnext.x = vcur.x-vother.x;
+            dnext.y = vcur.y-vother.y;
+            dnnorm = sqrt(dnext.x*dnext.x+dnext.y*dnext.y);
+            if(dnnorm < Pthreshold)
+                dnnorm = Pthreshold;
+            if(dlnorm < Pthreshold)
+                dlnorm = Pthreshold;
 
-        Dscalar2 dAjdv,dPjdv;
-        dAjdv.x = 0.5*(vother.y-vlast.y);
-        dAjdv.y = 0.5*(vlast.x-vother.x);
+            dPkdv.x = dlast.x/dlnorm - dnext.x/dnnorm;
+            dPkdv.y = dlast.y/dlnorm - dnext.y/dnnorm;
+            if (EdgeTension::active)
+                {
+                dTkdv.x = 0.0;
+                dTkdv.y = 0.0;
+                dTkdv.x += tik*dlast.x/dlnorm;
+                dTkdv.y += tik*dlast.y/dlnorm;
+                dTkdv.x -= tkj*dnext.x/dnnorm;
+                dTkdv.y -= tkj*dnext.y/dnnorm;
+                };
 
-        dlast.x = vother.x-vcur.x;
-        dlast.y=vother.y-vcur.y;
-        dlnorm = sqrt(dlast.x*dlast.x+dlast.y*dlast.y);
-        dnext.x = vcur.x-vlast.x;
-        dnext.y = vcur.y-vlast.y;
-        dnnorm = sqrt(dnext.x*dnext.x+dnext.y*dnext.y);
-        if(dnnorm < Pthreshold)
-            dnnorm = Pthreshold;
-        if(dlnorm < Pthreshold)
-            dlnorm = Pthreshold;
+            Dscalar2 dAjdv,dPjdv;
+            dAjdv.x = 0.5*(vother.y-vlast.y);
+            dAjdv.y = 0.5*(vlast.x-vother.x);
 
-        dPjdv.x = dlast.x/dlnorm - dnext.x/dnnorm;
-        dPjdv.y = dlast.y/dlnorm - dnext.y/dnnorm;
+            dlast.x = vother.x-vcur.x;
+            dlast.y=vother.y-vcur.y;
+            dlnorm = sqrt(dlast.x*dlast.x+dlast.y*dlast.y);
+            dnext.x = vcur.x-vlast.x;
+            dnext.y = vcur.y-vlast.y;
+            dnnorm = sqrt(dnext.x*dnext.x+dnext.y*dnext.y);
+            if(dnnorm < Pthreshold)
+                dnnorm = Pthreshold;
+            if(dlnorm < Pthreshold)
+                dlnorm = Pthreshold;
 
-        Dscalar2 dEdv;
+            dPjdv.x = dlast.x/dlnorm - dnext.x/dnnorm;
+            dPjdv.y = dlast.y/dlnorm - dnext.y/dnnorm;
+            if (EdgeTension::active)
+                {
+                dTjdv.x = 0.0;
+                dTjdv.y = 0.0;
+                dTjdv.x -= tij*dnext.x/dnnorm;
+                dTjdv.y -= tij*dnext.y/dnnorm;
+                dTjdv.x += tkj*dlast.x/dlnorm;
+                dTjdv.y += tkj*dlast.y/dlnorm;
+                };
 
-        dEdv.x = 2.0*Adiff*dAidv.x + 2.0*Pdiff*dPidv.x;
-        dEdv.y = 2.0*Adiff*dAidv.y + 2.0*Pdiff*dPidv.y;
-        dEdv.x += 2.0*Akdiff*dAkdv.x + 2.0*Pkdiff*dPkdv.x;
-        dEdv.y += 2.0*Akdiff*dAkdv.y + 2.0*Pkdiff*dPkdv.y;
-        dEdv.x += 2.0*Ajdiff*dAjdv.x + 2.0*Pjdiff*dPjdv.x;
-        dEdv.y += 2.0*Ajdiff*dAjdv.y + 2.0*Pjdiff*dPjdv.y;
+            //the contribution of each of the three cells, with its tension terms
+            Dscalar2 dEdv,dEkdv,dEjdv;
+            dEdv.x = 2.0*Adiff*dAidv.x + 2.0*Pdiff*dPidv.x;
+            dEdv.y = 2.0*Adiff*dAidv.y + 2.0*Pdiff*dPidv.y;
+            dEkdv.x = 2.0*Akdiff*dAkdv.x + 2.0*Pkdiff*dPkdv.x;
+            dEkdv.y = 2.0*Akdiff*dAkdv.y + 2.0*Pkdiff*dPkdv.y;
+            dEjdv.x = 2.0*Ajdiff*dAjdv.x + 2.0*Pjdiff*dPjdv.x;
+            dEjdv.y = 2.0*Ajdiff*dAjdv.y + 2.0*Pjdiff*dPjdv.y;
+            if (EdgeTension::active)
+                {
+                dEdv.x += dTidv.x;  dEdv.y += dTidv.y;
+                dEkdv.x += dTkdv.x; dEkdv.y += dTkdv.y;
+                dEjdv.x += dTjdv.x; dEjdv.y += dTjdv.y;
+                };
+            dEdv.x += dEkdv.x;
+            dEdv.y += dEkdv.y;
+            dEdv.x += dEjdv.x;
+            dEdv.y += dEjdv.y;
 
-        Dscalar2 temp = dEdv*dhdri[nn];
-        forceSum.x += temp.x;
-        forceSum.y += temp.y;
+            //dEdv*dhdri
+            forceSum.x += dEdv.x*dh11[l] + dEdv.y*dh21[l];
+            forceSum.y += dEdv.x*dh12[l] + dEdv.y*dh22[l];
 
-        vlast=vcur;
+            vlast=vcur;
+            };
         };
 
-    h_f.data[i].x=forceSum.x;
-    h_f.data[i].y=forceSum.y;
+    h_f[i].x=forceSum.x;
+    h_f[i].y=forceSum.y;
     if(particleExclusions)
         {
-        if(h_exes.data[i] != 0)
+        if(h_exes[i] != 0)
             {
-            h_f.data[i].x = 0.0;
-            h_f.data[i].y = 0.0;
-            h_external_forces.data[i].x=-forceSum.x;
-            h_external_forces.data[i].y=-forceSum.y;
+            h_f[i].x = 0.0;
+            h_f[i].y = 0.0;
+            h_external_forces[i].x=-forceSum.x;
+            h_external_forces[i].y=-forceSum.y;
             };
         }
     };
 
+//the energies for which the templated force routine is compiled
+template void VoronoiQuadraticEnergy::computeVoronoiForceCPU<quadraticAreaPerimeterEnergy,noEdgeTension>(int,
+        const Dscalar2*,const Dscalar2*,const int*,const int*,Dscalar2*,Dscalar2*,const int*,
+        const quadraticAreaPerimeterEnergy&,const noEdgeTension&);
+template void VoronoiQuadraticEnergy::computeVoronoiForceCPU<quadraticAreaPerimeterEnergy,uniformEdgeTension>(int,
+        const Dscalar2*,const Dscalar2*,const int*,const int*,Dscalar2*,Dscalar2*,const int*,
+        const quadraticAreaPerimeterEnergy&,const uniformEdgeTension&);
+template void VoronoiQuadraticEnergy::computeVoronoiForceCPU<quadraticAreaPerimeterEnergy,matrixEdgeTension>(int,
+        const Dscalar2*,const Dscalar2*,const int*,const int*,Dscalar2*,Dscalar2*,const int*,
+        const quadraticAreaPerimeterEnergy&,const matrixEdgeTension&);
+
 /*!
 Returns the quadratic energy functional:
 E = \sum_{cells} K_A(A_i-A_i,0)^2 + K_P(P_i-P_i,0)^2
 */
-Dscalar VoronoiQuadraticEnergy::computeEnergy()
+Daccum VoronoiQuadraticEnergy::computeEnergy()
     {
     if(!forcesUpToDate)
         computeForces();
+    //always re-sum from AreaPeri and AreaPeriPreferences, so that changes to the preferences or
+    //moduli since the last force computation are reflected in the energy
     ArrayHandle<Dscalar2> h_AP(AreaPeri,access_location::host,access_mode::read);
     ArrayHandle<Dscalar2> h_APP(AreaPeriPreferences,access_location::host,access_mode::read);
-    Energy = 0.0;
-    for (int nn = 0; nn  < Ncells; ++nn)
-        {
-        Energy += KA * (h_AP.data[nn].x-h_APP.data[nn].x)*(h_AP.data[nn].x-h_APP.data[nn].x);
-        Energy += KP * (h_AP.data[nn].y-h_APP.data[nn].y)*(h_AP.data[nn].y-h_APP.data[nn].y);
-        };
+    Energy = quadraticAreaPerimeterEnergy(KA,KP,h_AP.data,h_APP.data).totalEnergy(Ncells,accumulation);
     return Energy;
     };
 
@@ -437,8 +540,8 @@ Dscalar VoronoiQuadraticEnergy::getSigmaXY()
         vector<Dscalar2> voro(neigh);
         for (int nn = 0; nn < neigh; ++nn)
             {
-            ns[nn]=h_n.data[n_idx(nn,i)];
-            int id = n_idx(nn,i);
+            ns[nn]=h_n.data[neigh_idx(nn,i)];
+            int id = neigh_idx(nn,i);
             voro[nn] = h_v.data[id];
             };
         //loop through the Delaunay neighbors, computing dA/d\gamma and dP/d\gamma
@@ -541,7 +644,7 @@ void VoronoiQuadraticEnergy::getDynMatEntries(vector<int2> &rcs, vector<Dscalar>
         vector<int> ns(neigh);
         for (int nn = 0; nn < neigh; ++nn)
             {
-            ns[nn] = h_n.data[n_idx(nn,cell)];
+            ns[nn] = h_n.data[neigh_idx(nn,cell)];
             firstNeighs.push_back(ns[nn]);
             };
         //find the second neighbors
@@ -554,7 +657,7 @@ void VoronoiQuadraticEnergy::getDynMatEntries(vector<int2> &rcs, vector<Dscalar>
             int neigh2 = h_nn.data[curCell];
             for (int n2 = 0; n2 < neigh2; ++n2)
                 {
-                int potentialNeighbor = h_n.data[n_idx(n2,curCell)];
+                int potentialNeighbor = h_n.data[neigh_idx(n2,curCell)];
                 if (potentialNeighbor != cell && potentialNeighbor != lastCell && potentialNeighbor != nextCell)
                     secondNeighs.push_back(potentialNeighbor);
                 };
@@ -615,6 +718,173 @@ void VoronoiQuadraticEnergy::getDynMatEntries(vector<int2> &rcs, vector<Dscalar>
     printf("finished building dynamical Matrix\n");
     };
 
+//!The part of the gradient of a perimeter w/r/t vertex v from the edge (v,w), and its change when v and w move by dv and dw
+static inline void perimeterEdgeGradient(Dscalar2 v, Dscalar2 w, Dscalar2 dv, Dscalar2 dw, Dscalar2 &grad, Dscalar2 &dgrad)
+    {
+    Dscalar2 edge = v-w;
+    Dscalar norm = sqrt(dot(edge,edge));
+    if (norm < THRESHOLD)
+        norm = THRESHOLD;
+    Dscalar2 t = (1.0/norm)*edge;
+    Dscalar2 dedge = dv-dw;
+    grad = t;
+    dgrad = (1.0/norm)*(dedge - dot(t,dedge)*t);
+    };
+
+/*!
+Computes Hu, the product of the Hessian of the energy w/r/t the cell positions with a displacement u
+of every cell, without forming the matrix; at a force-balanced state the Hessian is the matrix whose
+entries getDynMatEntries reports. Hu is the change of the gradient of the energy along u. A first sweep
+finds the change of every voronoi vertex (via dHdri) and from those the change of every cell's area
+and perimeter; a second sweep then changes, vertex by vertex, the terms dE/dv . dv/dr_i of the force
+on each cell, using d2Hdridrj for the change of dv/dr_i. Both sweeps touch only the neighborhood of
+each cell and are split over nThreads threads, and the cost is a few force evaluations.
+\param u the displacement of each cell
+\param Hu on output, the product of the Hessian with u
+\pre Requires that computeGeometry is current
+*/
+void VoronoiQuadraticEnergy::computeHessianVectorProduct(GPUArray<Dscalar2> &u, GPUArray<Dscalar2> &Hu)
+    {
+    if (Hu.getNumElements() != Ncells)
+        Hu.resize(Ncells);
+    ArrayHandle<Dscalar2> h_u(u,access_location::host,access_mode::read);
+    ArrayHandle<Dscalar2> h_Hu(Hu,access_location::host,access_mode::overwrite);
+    ArrayHandle<Dscalar2> h_p(cellPositions,access_location::host,access_mode::read);
+    ArrayHandle<Dscalar2> h_AP(AreaPeri,access_location::host,access_mode::read);
+    ArrayHandle<Dscalar2> h_APpref(AreaPeriPreferences,access_location::host,access_mode::read);
+    ArrayHandle<Dscalar2> h_v(voroCur,access_location::host,access_mode::read);
+    ArrayHandle<int> h_nn(cellNeighborNum,access_location::host,access_mode::read);
+    ArrayHandle<int> h_n(cellNeighbors,access_location::host,access_mode::read);
+
+    //the change of each voronoi vertex, laid out like voroCur, and of each cell's area and perimeter
+    vector<Dscalar2> dv(neigh_idx.getNumElements());
+    vector<Dscalar2> dAP(Ncells);
+    parallelFor(Ncells,nThreads,[&](int i)
+        {
+        int neigh = h_nn.data[i];
+        //vertex vv is shared by cell i, cellB = ns[vv-1], and cellG = ns[vv]
+        int cellB = h_n.data[neigh_idx(neigh-1,i)];
+        for (int vv = 0; vv < neigh; ++vv)
+            {
+            int cellG = h_n.data[neigh_idx(vv,i)];
+            Dscalar2 pi = h_p.data[i];
+            Dscalar2 pB = h_p.data[cellB];
+            Dscalar2 pG = h_p.data[cellG];
+            dv[neigh_idx(vv,i)] = dHdri(pi,pB,pG)*h_u.data[i]
+                                 +dHdri(pB,pi,pG)*h_u.data[cellB]
+                                 +dHdri(pG,pi,pB)*h_u.data[cellG];
+            cellB = cellG;
+            };
+        Dscalar dA = 0.0;
+        Dscalar dP = 0.0;
+        Dscalar2 vlast = h_v.data[neigh_idx(neigh-1,i)];
+        Dscalar2 dvlast = dv[neigh_idx(neigh-1,i)];
+        for (int vv = 0; vv < neigh; ++vv)
+            {
+            Dscalar2 vcur = h_v.data[neigh_idx(vv,i)];
+            Dscalar2 vnext = h_v.data[neigh_idx((vv+1)%neigh,i)];
+            Dscalar2 dvcur = dv[neigh_idx(vv,i)];
+            Dscalar2 dvnext = dv[neigh_idx((vv+1)%neigh,i)];
+            Dscalar2 dAdv = make_Dscalar2(0.5*(vnext.y-vlast.y),0.5*(vlast.x-vnext.x));
+            Dscalar2 glast,gnext,unused;
+            perimeterEdgeGradient(vcur,vlast,dvcur,dvlast,glast,unused);
+            perimeterEdgeGradient(vcur,vnext,dvcur,dvnext,gnext,unused);
+            dA += dot(dAdv,dvcur);
+            dP += dot(glast+gnext,dvcur);
+            vlast = vcur;
+            dvlast = dvcur;
+            };
+        dAP[i] = make_Dscalar2(dA,dP);
+        });
+
+    parallelFor(Ncells,nThreads,[&](int i)
+        {
+        int neigh = h_nn.data[i];
+        Dscalar2 pi = h_p.data[i];
+        Daccum2 HuSum;
+        HuSum.x=0.0;HuSum.y=0.0;
+
+        int cellB = h_n.data[neigh_idx(neigh-1,i)];
+        Dscalar2 vlast = h_v.data[neigh_idx(neigh-1,i)];
+        Dscalar2 dvlast = dv[neigh_idx(neigh-1,i)];
+        for (int vv = 0; vv < neigh; ++vv)
+            {
+            int cellG = h_n.data[neigh_idx(vv,i)];
+            Dscalar2 vcur = h_v.data[neigh_idx(vv,i)];
+            Dscalar2 vnext = h_v.data[neigh_idx((vv+1)%neigh,i)];
+            Dscalar2 dvcur = dv[neigh_idx(vv,i)];
+            Dscalar2 dvnext = dv[neigh_idx((vv+1)%neigh,i)];
+
+            //vother, the vertex shared by cellB, cellG, and cellD, is the one after cellB in cellG's list
+            int neigh2 = h_nn.data[cellG];
+            int otherSlot = -1;
+            for (int n2 = 0; n2 < neigh2; ++n2)
+                if (h_n.data[neigh_idx(n2,cellG)] == cellB)
+                    otherSlot = (n2+1)%neigh2;
+            int cellD = otherSlot < 0 ? -1 : h_n.data[neigh_idx(otherSlot,cellG)];
+            if (cellD == cellB || cellD == cellG || cellD == -1)
+                {
+                printf("Triangulation problem %i\n",cellD);
+                throw std::exception();
+                };
+            Dscalar2 rB,rG,rD,vother;
+            Box->minDist(h_p.data[cellB],pi,rB);
+            Box->minDist(h_p.data[cellG],pi,rG);
+            Box->minDist(h_p.data[cellD],pi,rD);
+            Circumcenter(rB,rG,rD,vother);
+            Dscalar2 dvother = dv[neigh_idx(otherSlot,cellG)];
+
+            //dE/dv and its change, from the three cells around vcur, each given as (cell, previous vertex, next vertex)
+            int cells[3] = {i,cellG,cellB};
+            Dscalar2 prev[3] = {vlast,vnext,vother};
+            Dscalar2 next[3] = {vnext,vother,vlast};
+            Dscalar2 dprev[3] = {dvlast,dvnext,dvother};
+            Dscalar2 dnext[3] = {dvnext,dvother,dvlast};
+            Dscalar2 dEdv = make_Dscalar2(0.0,0.0);
+            Dscalar2 ddEdv = make_Dscalar2(0.0,0.0);
+            for (int cc = 0; cc < 3; ++cc)
+                {
+                int c = cells[cc];
+                Dscalar dEdA = 2.0*KA*(h_AP.data[c].x-h_APpref.data[c].x);
+                Dscalar dEdP = 2.0*KP*(h_AP.data[c].y-h_APpref.data[c].y);
+                Dscalar2 dAdv = make_Dscalar2(0.5*(next[cc].y-prev[cc].y),0.5*(prev[cc].x-next[cc].x));
+                Dscalar2 ddAdv = make_Dscalar2(0.5*(dnext[cc].y-dprev[cc].y),0.5*(dprev[cc].x-dnext[cc].x));
+                Dscalar2 gprev,dgprev,gnext,dgnext;
+                perimeterEdgeGradient(vcur,prev[cc],dvcur,dprev[cc],gprev,dgprev);
+                perimeterEdgeGradient(vcur,next[cc],dvcur,dnext[cc],gnext,dgnext);
+                Dscalar2 dPdv = gprev+gnext;
+                Dscalar2 ddPdv = dgprev+dgnext;
+                dEdv = dEdv + dEdA*dAdv + dEdP*dPdv;
+                ddEdv = ddEdv + (2.0*KA*dAP[c].x)*dAdv + dEdA*ddAdv + (2.0*KP*dAP[c].y)*dPdv + dEdP*ddPdv;
+                };
+
+            //dv/dr_i, and its change along u
+            Matrix2x2 dvdri = dHdri(pi,h_p.data[cellB],h_p.data[cellG]);
+            Dscalar d2vdri2[8], d2vdridrB[8], d2vdridrG[8];
+            d2Hdridrj(rB,rG,1,d2vdri2);
+            d2Hdridrj(rB,rG,2,d2vdridrB);
+            d2Hdridrj(rG,rB,2,d2vdridrG);
+            Dscalar2 ui = h_u.data[i];
+            Dscalar2 uB = h_u.data[cellB];
+            Dscalar2 uG = h_u.data[cellG];
+            //d2Hdridrj lays out d^2H_row/dr_{i,col}dr_{j,comp} by (col,comp) pairs
+            Matrix2x2 ddvdri;
+            ddvdri.x11 = d2vdri2[0]*ui.x+d2vdri2[4]*ui.y + d2vdridrB[0]*uB.x+d2vdridrB[4]*uB.y + d2vdridrG[0]*uG.x+d2vdridrG[4]*uG.y;
+            ddvdri.x21 = d2vdri2[1]*ui.x+d2vdri2[5]*ui.y + d2vdridrB[1]*uB.x+d2vdridrB[5]*uB.y + d2vdridrG[1]*uG.x+d2vdridrG[5]*uG.y;
+            ddvdri.x12 = d2vdri2[2]*ui.x+d2vdri2[6]*ui.y + d2vdridrB[2]*uB.x+d2vdridrB[6]*uB.y + d2vdridrG[2]*uG.x+d2vdridrG[6]*uG.y;
+            ddvdri.x22 = d2vdri2[3]*ui.x+d2vdri2[7]*ui.y + d2vdridrB[3]*uB.x+d2vdridrB[7]*uB.y + d2vdridrG[3]*uG.x+d2vdridrG[7]*uG.y;
+
+            HuSum.x += ddEdv.x*dvdri.x11 + ddEdv.y*dvdri.x21 + dEdv.x*ddvdri.x11 + dEdv.y*ddvdri.x21;
+            HuSum.y += ddEdv.x*dvdri.x12 + ddEdv.y*dvdri.x22 + dEdv.x*ddvdri.x12 + dEdv.y*ddvdri.x22;
+
+            cellB = cellG;
+            vlast = vcur;
+            dvlast = dvcur;
+            };
+        h_Hu.data[i] = make_Dscalar2(HuSum.x,HuSum.y);
+        });
+    };
+
 /*!
 \param i The index of cell i
 \param j The index of cell j
@@ -641,7 +911,7 @@ Matrix2x2 VoronoiQuadraticEnergy::d2Edridrj(int i, int j, neighborType neighbor,
     vector<int> ns(neigh);
     for (int nn = 0; nn < neigh; ++nn)
         {
-        ns[nn] = h_n.data[n_idx(nn,i)];
+        ns[nn] = h_n.data[neigh_idx(nn,i)];
         };
     //the saved voronoi positions
     Dscalar2 vlast, vcur,vnext;
@@ -650,7 +920,7 @@ Matrix2x2 VoronoiQuadraticEnergy::d2Edridrj(int i, int j, neighborType neighbor,
     int cellG, cellB,cellGp1,cellBm1;
     cellB = ns[neigh-1];
     cellBm1 = ns[neigh-2];
-    vlast = h_v.data[n_idx(neigh-1,i)];
+    vlast = h_v.data[neigh_idx(neigh-1,i)];
     Dscalar dEdA = 2*KA*(h_AP.data[i].x - h_APpref.data[i].x);
     Dscalar dEdP = 2*KP*(h_AP.data[i].y - h_APpref.data[i].y);
     Dscalar2 dAadrj = dAidrj(i,j);
@@ -675,8 +945,8 @@ Matrix2x2 VoronoiQuadraticEnergy::d2Edridrj(int i, int j, neighborType neighbor,
         int cellD=-1;
         for (int n2 = 0; n2 < neigh2; ++n2)
             {
-            int testPoint = h_n.data[n_idx(n2,cellG)];
-            if(testPoint == cellB) cellD = h_n.data[n_idx((n2+1)%neigh2,cellG)];
+            int testPoint = h_n.data[neigh_idx(n2,cellG)];
+            if(testPoint == cellB) cellD = h_n.data[neigh_idx((n2+1)%neigh2,cellG)];
             };
         if(cellD == cellB || cellD  == cellG || cellD == -1)
             {
@@ -692,8 +962,8 @@ Matrix2x2 VoronoiQuadraticEnergy::d2Edridrj(int i, int j, neighborType neighbor,
         Dscalar2 vother;
         Circumcenter(rB,rG,rD,vother);
 
-        vcur = h_v.data[n_idx(vv,i)];
-        vnext = h_v.data[n_idx((vv+1)%neigh,i)];
+        vcur = h_v.data[neigh_idx(vv,i)];
+        vnext = h_v.data[neigh_idx((vv+1)%neigh,i)];
 
         Matrix2x2 dvidri = dHdri(h_p.data[i],h_p.data[cellB],h_p.data[cellG]);
         Matrix2x2 dvidrj(0.0,0.0,0.0,0.0);
@@ -3,6 +3,7 @@
 #include "EnergyMinimizerFIRE2D.h"
 #include "EnergyMinimizerFIRE2D.cuh"
 #include "utilities.cuh"
+#include "vectorField.h"
 
 /*! \file EnergyMinimizerFIRE2D.cpp
  */
@@ -24,6 +25,7 @@ Initialize the minimizer with some default parameters. that do not depend on N
 void EnergyMinimizerFIRE::initializeParameters()
     {
     sumReductions.resize(3);
+    accumulation = accumulator_precision::extended;
     iterations = 0;
     Power = 0;
     NSinceNegativePower = 0;
@@ -124,15 +126,13 @@ void EnergyMinimizerFIRE::velocityVerletCPU()
         ArrayHandle<Dscalar2> h_f(force);
         ArrayHandle<Dscalar2> h_v(velocity);
         ArrayHandle<Dscalar2> h_d(displacement);
-        for (int i = 0; i < N; ++i)
-            {
-            //update displacement
-            h_d.data[i].x = deltaT*h_v.data[i].x+0.5*deltaT*deltaT*h_f.data[i].x;
-            h_d.data[i].y = deltaT*h_v.data[i].y+0.5*deltaT*deltaT*h_f.data[i].y;
-            //do first half of velocity update
-            h_v.data[i].x += 0.5*deltaT*h_f.data[i].x;
-            h_v.data[i].y += 0.5*deltaT*h_f.data[i].y;
-            };
+        constVectorField2D f(h_f.data,N);
+        vectorField2D v(h_v.data,N);
+        vectorField2D d(h_d.data,N);
+        //update displacement
+        d.setLinearCombination(deltaT,v,0.5*deltaT*deltaT,f);
+        //do first half of velocity update
+        v.addScaled(0.5*deltaT,f);
         };
     //move particles, then update the forces
     State->moveDegreesOfFreedom(displacement);
@@ -143,11 +143,7 @@ void EnergyMinimizerFIRE::velocityVerletCPU()
     //update second half of velocity vector based on new forces
     ArrayHandle<Dscalar2> h_f(force);
     ArrayHandle<Dscalar2> h_v(velocity);
-    for (int i = 0; i < N; ++i)
-        {
-        h_v.data[i].x += 0.5*deltaT*h_f.data[i].x;
-        h_v.data[i].y += 0.5*deltaT*h_f.data[i].y;
-        };
+    vectorField2D(h_v.data,N).addScaled(0.5*deltaT,constVectorField2D(h_f.data,N));
     };
 
 /*!
@@ -171,17 +167,17 @@ void EnergyMinimizerFIRE::fireStepGPU()
         //parallel reduction
         if (true)//scope for reduction arrays
             {
-            ArrayHandle<Dscalar> d_intermediate(sumReductionIntermediate,access_location::device,access_mode::overwrite);
-            ArrayHandle<Dscalar> d_assist(sumReductions,access_location::device,access_mode::overwrite);
-            gpu_parallel_reduction(d_ff.data,d_intermediate.data,d_assist.data,0,N);
-            gpu_parallel_reduction(d_fv.data,d_intermediate.data,d_assist.data,1,N);
-            gpu_parallel_reduction(d_vv.data,d_intermediate.data,d_assist.data,2,N);
+            ArrayHandle<Daccum> d_intermediate(sumReductionIntermediate,access_location::device,access_mode::overwrite);
+            ArrayHandle<Daccum> d_assist(sumReductions,access_location::device,access_mode::overwrite);
+            gpu_parallel_reduction(d_ff.data,d_intermediate.data,d_assist.data,0,N,accumulation);
+            gpu_parallel_reduction(d_fv.data,d_intermediate.data,d_assist.data,1,N,accumulation);
+            gpu_parallel_reduction(d_vv.data,d_intermediate.data,d_assist.data,2,N,accumulation);
             };
-        ArrayHandle<Dscalar> h_assist(sumReductions,access_location::host,access_mode::read);
-        Dscalar forceNorm = h_assist.data[0];
+        ArrayHandle<Daccum> h_assist(sumReductions,access_location::host,access_mode::read);
+        Daccum forceNorm = h_assist.data[0];
         Power = h_assist.data[1];
-        Dscalar velocityNorm = h_assist.data[2];
-        forceMax = forceNorm / (Dscalar)N;
+        Daccum velocityNorm = h_assist.data[2];
+        forceMax = forceNorm / (Daccum)N;
         Dscalar scaling = 0.0;
         if(forceNorm > 0.)
             scaling = sqrt(velocityNorm/forceNorm);
@@ -218,25 +214,17 @@ void EnergyMinimizerFIRE::fireStepCPU()
         //calculate the power, and precompute norms of vectors
         ArrayHandle<Dscalar2> h_f(force);
         ArrayHandle<Dscalar2> h_v(velocity);
-        Dscalar forceNorm = 0.0;
-        Dscalar velocityNorm = 0.0;
-        for (int i = 0; i < N; ++i)
-            {
-            Power += dot(h_f.data[i],h_v.data[i]);
-            Dscalar fdot = dot(h_f.data[i],h_f.data[i]);
-            if (fdot > forceMax) forceMax = fdot;
-            forceNorm += fdot;
-            velocityNorm += dot(h_v.data[i],h_v.data[i]);
-            };
+        constVectorField2D f(h_f.data,N);
+        vectorField2D v(h_v.data,N);
+        Power = f.dot(v,accumulation);
+        forceMax = f.maxNormSquared(accumulation);
+        Daccum forceNorm = f.dot(f,accumulation);
+        Daccum velocityNorm = v.dot(v,accumulation);
         Dscalar scaling = 0.0;
         if(forceNorm > 0.)
             scaling = sqrt(velocityNorm/forceNorm);
         //adjust the velocity according to the FIRE algorithm
-        for (int i = 0; i < N; ++i)
-            {
-            h_v.data[i].x = (1.0-alpha)*h_v.data[i].x + alpha*scaling*h_f.data[i].x;
-            h_v.data[i].y = (1.0-alpha)*h_v.data[i].y + alpha*scaling*h_f.data[i].y;
-            };
+        v.scaleAndAddScaled(1.0-alpha,alpha*scaling,f);
         };
 
     if (Power > 0)
@@ -255,11 +243,7 @@ void EnergyMinimizerFIRE::fireStepCPU()
         deltaT = max (deltaT,deltaTMin);
         alpha = alphaStart;
         ArrayHandle<Dscalar2> h_v(velocity);
-        for (int i = 0; i < N; ++i)
-            {
-            h_v.data[i].x = 0.0;
-            h_v.data[i].y = 0.0;
-            };
+        vectorField2D(h_v.data,N).zero();
         };
     };
 
@@ -301,13 +285,13 @@ void EnergyMinimizerFIRE::parallelReduce(GPUArray<Dscalar> &vec)
     if(true)
     {
     ArrayHandle<Dscalar> input(vec,access_location::device,access_mode::read);
-    ArrayHandle<Dscalar> intermediate(sumReductionIntermediate,access_location::device,access_mode::overwrite);
-    ArrayHandle<Dscalar> output(sumReductions,access_location::device,access_mode::overwrite);
+    ArrayHandle<Daccum> intermediate(sumReductionIntermediate,access_location::device,access_mode::overwrite);
+    ArrayHandle<Daccum> output(sumReductions,access_location::device,access_mode::overwrite);
     gpu_parallel_reduction(input.data,
             intermediate.data,
             output.data,
-            0,n);
+            0,n,accumulation);
     };
-    ArrayHandle<Dscalar> output(sumReductions);
+    ArrayHandle<Daccum> output(sumReductions);
     printf("GPU-based reduction: %f\n",output.data[0]);
     };
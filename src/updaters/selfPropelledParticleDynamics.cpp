@@ -2,6 +2,7 @@
 
 #include "selfPropelledParticleDynamics.h"
 #include "selfPropelledParticleDynamics.cuh"
+#include "vectorField.h"
 /*! \file selfPropelledParticleDynamics.cpp */
 
 /*!
@@ -74,19 +75,21 @@ void selfPropelledParticleDynamics::integrateEquationsOfMotionCPU()
     ArrayHandle<Dscalar2> h_disp(displacements,access_location::host,access_mode::overwrite);
     ArrayHandle<Dscalar2> h_motility(activeModel->Motility,access_location::host,access_mode::read);
 
+    //set the self-propulsion velocities from the current directors
     for (int ii = 0; ii < Ndof; ++ii)
         {
-        //displace according to current velocities and forces
         Dscalar v0i = h_motility.data[ii].x;
-        Dscalar Dri = h_motility.data[ii].y;
         h_v.data[ii].x =  v0i * cos(h_cd.data[ii]);
         h_v.data[ii].y =  v0i * sin(h_cd.data[ii]);
+        };
+    //displace according to current velocities and forces, as one component-wise (vectorizable) update
+    vectorField2D(h_disp.data,Ndof).setScaledSum(deltaT,constVectorField2D(h_v.data,Ndof),mu,constVectorField2D(h_f.data,Ndof));
+    //rotate the directors a bit; the random numbers are drawn in the same order as before
+    for (int ii = 0; ii < Ndof; ++ii)
+        {
+        Dscalar Dri = h_motility.data[ii].y;
         Dscalar2 Vcur = h_v.data[ii];
-        h_disp.data[ii].x = deltaT*(Vcur.x + mu * h_f.data[ii].x);
-        h_disp.data[ii].y = deltaT*(Vcur.y + mu * h_f.data[ii].y);
-
         Dscalar theta = h_cd.data[ii];
-        //rotate the velocity vector a bit
         if (!(Vcur.x == 0. && Vcur.y == 0.))
             {
             theta = atan2(Vcur.y,Vcur.x);
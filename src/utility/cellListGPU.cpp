@@ -17,6 +17,7 @@
 cellListGPU::cellListGPU(Dscalar a, vector<Dscalar> &points,gpubox &bx)
     {
     Nmax = 0;
+    binsTracked = false;
     setParticles(points);
     Box = make_shared<gpubox>();
     setGridSize(a);
@@ -28,15 +29,20 @@ cellListGPU::cellListGPU(Dscalar a, vector<Dscalar> &points,gpubox &bx)
 cellListGPU::cellListGPU(vector<Dscalar> &points)
     {
     Nmax = 0;
+    binsTracked = false;
     Box = make_shared<gpubox>();
     setParticles(points);
     }
 
 /*!
-\param nn the number of particles to sort
+\param nn the number of particles to sort. If particles are added, they are assumed to be appended
+to the end of the list (so the bins of the current particles are still tracked); if particles are
+removed, the next call to updateCPU rebuilds the list.
  */
 void cellListGPU::setNp(int nn)
     {
+    if (nn < Np)
+        binsTracked = false;
     Np = nn;
     };
 
@@ -122,6 +128,7 @@ all on the CPU (so that no expensive copies are needed)
  */
 void cellListGPU::resetCellSizesCPU()
     {
+    binsTracked = false;
     //set all cell sizes to zero
     totalCells=xsize*ysize;
     if(cell_sizes.getNumElements() != totalCells)
@@ -154,6 +161,7 @@ all on the GPU so that arrays don't need to be copied back to the host
 */
 void cellListGPU::resetCellSizes()
     {
+    binsTracked = false;
     //set all cell sizes to zero
     totalCells=xsize*ysize;
     if(cell_sizes.getNumElements() != totalCells)
@@ -333,6 +341,161 @@ void cellListGPU::compute(GPUArray<Dscalar2> &points)
     };
 
 
+/*!
+\param point a position in the box
+\param bin the bin the point was assigned to
+\return the distance the point has to move to leave the bin (through its boundary, or through the
+edge of the box where positions are wrapped), or zero if it is already outside of it
+*/
+Dscalar cellListGPU::binMargin(const Dscalar2 &point, int bin)
+    {
+    Dscalar b11,b12,b21,b22;
+    Box->getBoxDims(b11,b12,b21,b22);
+    int binx = bin % xsize;
+    int biny = bin / xsize;
+    Dscalar upperx = (binx == xsize-1) ? b11 : min((binx+1)*boxsize,b11);
+    Dscalar uppery = (biny == ysize-1) ? b22 : min((biny+1)*boxsize,b22);
+    Dscalar margin = min(min(point.x-binx*boxsize,upperx-point.x),min(point.y-biny*boxsize,uppery-point.y));
+    return max(margin,(Dscalar)0.0);
+    };
+
+/*!
+\param point the current position of particle nn
+\param nn the particle, which is already in its bin
+*/
+void cellListGPU::scheduleParticle(const Dscalar2 &point, int nn)
+    {
+    particleExpiry[nn] = displacementBound + binMargin(point,particleBin[nn]);
+    expiryQueue.push(make_pair(particleExpiry[nn],nn));
+    };
+
+/*!
+\param i the index of a particle that has been moved other than through the displacements reported
+to addDisplacement (e.g., a dividing cell)
+*/
+void cellListGPU::particleMoved(int i)
+    {
+    if (!binsTracked || i >= particleExpiry.size())
+        return;
+    particleExpiry[i] = displacementBound;
+    expiryQueue.push(make_pair(particleExpiry[i],i));
+    };
+
+/*!
+The first call (or the first call after the cell list has been computed by any other route) puts
+every point into a bin, and records the bin of every particle together with how far it may move
+before it could leave that bin. The caller then reports an upper bound on the displacement of every
+particle after each move (addDisplacement), and later calls only look at the particles that may have
+moved far enough to leave their bins (and at particles appended since the last call, or reported by
+particleMoved). Those that did are moved to their new bins, so when the particles move by small
+amounts the cost is proportional to the number of particles near a bin boundary, with no pass over
+all of the positions. If a bin overflows, the whole list is rebuilt.
+\param points host pointer to the Np positions to assign to cells
+ */
+void cellListGPU::updateCPU(const Dscalar2 *points)
+    {
+    if (binsTracked && particleBin.size() <= Np)
+        {
+        ArrayHandle<unsigned int> h_cell_sizes(cell_sizes,access_location::host,access_mode::readwrite);
+        ArrayHandle<int> h_idx(idxs,access_location::host,access_mode::readwrite);
+        //appended particles are not in any bin yet
+        int oldNp = particleBin.size();
+        particleBin.resize(Np,-1);
+        particleSlot.resize(Np,-1);
+        particleExpiry.resize(Np);
+        for (int nn = oldNp; nn < Np; ++nn)
+            particleMoved(nn);
+
+        vector<int> expired;
+        bool overflow = false;
+        while (!overflow && !expiryQueue.empty() && expiryQueue.top().first <= displacementBound)
+            {
+            pair<Dscalar,int> entry = expiryQueue.top();
+            expiryQueue.pop();
+            int nn = entry.second;
+            if (nn >= Np || entry.first != particleExpiry[nn])
+                continue;
+            expired.push_back(nn);
+            int bin = positionToCellIndex(points[nn].x,points[nn].y);
+            int oldBin = particleBin[nn];
+            if (bin == oldBin)
+                continue;
+            if (h_cell_sizes.data[bin] >= Nmax)
+                {
+                overflow = true;
+                continue;
+                };
+            //remove the particle from its old bin, filling the hole with the bin's last particle
+            if (oldBin >= 0)
+                {
+                int slot = particleSlot[nn];
+                int last = h_cell_sizes.data[oldBin]-1;
+                int moved = h_idx.data[cell_list_indexer(last,oldBin)];
+                h_idx.data[cell_list_indexer(slot,oldBin)] = moved;
+                particleSlot[moved] = slot;
+                h_cell_sizes.data[oldBin] = last;
+                };
+            //and add it to the end of its new bin
+            int offset = h_cell_sizes.data[bin];
+            h_idx.data[cell_list_indexer(offset,bin)] = nn;
+            particleSlot[nn] = offset;
+            particleBin[nn] = bin;
+            h_cell_sizes.data[bin] = offset+1;
+            };
+        if (!overflow)
+            {
+            for (int ee = 0; ee < expired.size(); ++ee)
+                scheduleParticle(points[expired[ee]],expired[ee]);
+            //every new expiry leaves a stale entry behind; drop them once they dominate the queue
+            if (expiryQueue.size() > 4*Np)
+                {
+                vector<pair<Dscalar,int> > entries(Np);
+                for (int nn = 0; nn < Np; ++nn)
+                    entries[nn] = make_pair(particleExpiry[nn],nn);
+                expiryQueue = priority_queue<pair<Dscalar,int>, vector<pair<Dscalar,int> >, greater<pair<Dscalar,int> > >(greater<pair<Dscalar,int> >(),entries);
+                };
+            return;
+            };
+        };
+
+    //(re)build the whole list, growing Nmax as needed
+    particleBin.resize(Np);
+    particleSlot.resize(Np);
+    bool recompute = true;
+    while (recompute)
+        {
+        resetCellSizesCPU();
+        ArrayHandle<unsigned int> h_cell_sizes(cell_sizes,access_location::host,access_mode::readwrite);
+        ArrayHandle<int> h_idx(idxs,access_location::host,access_mode::readwrite);
+        recompute=false;
+        for (int nn = 0; nn < Np; ++nn)
+            {
+            int bin = positionToCellIndex(points[nn].x,points[nn].y);
+            int offset = h_cell_sizes.data[bin];
+            if (offset >= Nmax)
+                {
+                Nmax = offset+1;
+                recompute=true;
+                break;
+                };
+            h_idx.data[cell_list_indexer(offset,bin)]=nn;
+            particleBin[nn] = bin;
+            particleSlot[nn] = offset;
+            h_cell_sizes.data[bin]++;
+            };
+        };
+    displacementBound = 0.0;
+    particleExpiry.resize(Np);
+    vector<pair<Dscalar,int> > entries(Np);
+    for (int nn = 0; nn < Np; ++nn)
+        {
+        particleExpiry[nn] = binMargin(points[nn],particleBin[nn]);
+        entries[nn] = make_pair(particleExpiry[nn],nn);
+        };
+    expiryQueue = priority_queue<pair<Dscalar,int>, vector<pair<Dscalar,int> >, greater<pair<Dscalar,int> > >(greater<pair<Dscalar,int> >(),entries);
+    binsTracked = true;
+    };
+
 /*!
 Assign known points to cells on the GPU
  */
@@ -1,4 +1,5 @@
 #include "eigenMatrixInterface.h"
+#include "parallelLoops.h"
 
 /*! \file eigenMatrixInterface.cpp */
 
@@ -56,3 +57,234 @@ void EigMat::getEvec(int i, vector<Dscalar> &vec)
         };
     };
 
+/*!
+Each thread first counts the entries of its (contiguous) block of rcs that land in every row, which
+fixes where in each row those entries go; the entries are then scattered in parallel, keeping their
+original order within each row. Finally every row is sorted by column, and of repeated (row,col)
+entries only the last is kept.
+\param n the size of the matrix
+\param rcs the (row,col) locations of the entries of one triangle of the matrix
+\param vals the corresponding values
+\param nThreads the number of threads to split the assembly over
+*/
+void EigSparseMat::setFromEntries(int n, const vector<int2> &rcs, const vector<Dscalar> &vals, int nThreads)
+    {
+    int nEntries = rcs.size();
+    if (nThreads < 1) nThreads = 1;
+    if (nThreads > nEntries) nThreads = max(1,nEntries);
+
+    //how many (row,col) and (col,row) placements each thread makes in each row
+    vector< vector<int> > counts(nThreads,vector<int>(n,0));
+    parallelBlocks(nEntries,nThreads,[&](int begin, int end, int t)
+        {
+        vector<int> &count = counts[t];
+        for (int e = begin; e < end; ++e)
+            {
+            count[rcs[e].x] += 1;
+            if (rcs[e].x != rcs[e].y)
+                count[rcs[e].y] += 1;
+            };
+        });
+
+    //the start of each row, and the position at which each thread starts writing in each row
+    vector<int> rowStart(n+1,0);
+    for (int row = 0; row < n; ++row)
+        {
+        int position = rowStart[row];
+        for (int t = 0; t < nThreads; ++t)
+            {
+            int c = counts[t][row];
+            counts[t][row] = position;
+            position += c;
+            };
+        rowStart[row+1] = position;
+        };
+
+    vector<int> columns(rowStart[n]);
+    vector<double> values(rowStart[n]);
+    parallelBlocks(nEntries,nThreads,[&](int begin, int end, int t)
+        {
+        vector<int> &cursor = counts[t];
+        for (int e = begin; e < end; ++e)
+            {
+            int row = rcs[e].x;
+            int col = rcs[e].y;
+            columns[cursor[row]] = col;
+            values[cursor[row]] = vals[e];
+            cursor[row] += 1;
+            if (row != col)
+                {
+                columns[cursor[col]] = row;
+                values[cursor[col]] = vals[e];
+                cursor[col] += 1;
+                };
+            };
+        });
+    counts.clear();
+
+    //sort each row by column, keeping the last of any repeated entries
+    vector<int> rowLength(n);
+    parallelFor(n,nThreads,[&](int row)
+        {
+        int start = rowStart[row];
+        int length = rowStart[row+1]-start;
+        vector< pair<int,int> > order(length);
+        for (int ii = 0; ii < length; ++ii)
+            order[ii] = make_pair(columns[start+ii],ii);
+        sort(order.begin(),order.end());
+        vector<int> rowColumns;
+        vector<double> rowValues;
+        rowColumns.reserve(length);
+        rowValues.reserve(length);
+        for (int ii = 0; ii < length; ++ii)
+            {
+            if (ii+1 < length && order[ii+1].first == order[ii].first)
+                continue;
+            rowColumns.push_back(order[ii].first);
+            rowValues.push_back(values[start+order[ii].second]);
+            };
+        for (int ii = 0; ii < rowColumns.size(); ++ii)
+            {
+            columns[start+ii] = rowColumns[ii];
+            values[start+ii] = rowValues[ii];
+            };
+        rowLength[row] = rowColumns.size();
+        });
+
+    //compact the rows into the compressed storage of the Eigen matrix
+    mat.resize(n,n);
+    int nonZeros = 0;
+    for (int row = 0; row < n; ++row)
+        nonZeros += rowLength[row];
+    mat.resizeNonZeros(nonZeros);
+    int *outer = mat.outerIndexPtr();
+    outer[0] = 0;
+    for (int row = 0; row < n; ++row)
+        outer[row+1] = outer[row]+rowLength[row];
+    int *inner = mat.innerIndexPtr();
+    double *matValues = mat.valuePtr();
+    parallelFor(n,nThreads,[&](int row)
+        {
+        for (int ii = 0; ii < rowLength[row]; ++ii)
+            {
+            inner[outer[row]+ii] = columns[rowStart[row]+ii];
+            matValues[outer[row]+ii] = values[rowStart[row]+ii];
+            };
+        });
+    };
+
+/*!
+The Lanczos vectors are kept (and fully reorthogonalized against) until the k Ritz values of largest
+magnitude of (M - sigma I)^{-1} have converged, i.e. until the residual bound of each is below
+tolerance times the Ritz value, or until maxKrylov vectors have been built. The starting vector is
+generated from a fixed seed, so the results are reproducible.
+\param k the number of eigenpairs to find
+\param sigma the shift; it should not be an eigenvalue of the matrix
+\param tolerance the relative accuracy of the eigenvalues of the inverted problem
+\param maxKrylov the largest number of Lanczos vectors to build; if zero, min(n,max(4k,k+40)) is used
+\post the eigenvalues closest to sigma, in increasing order, and their eigenvectors are stored
+*/
+int EigSparseMat::shiftInvertSolve(int k, Dscalar sigma, Dscalar tolerance, int maxKrylov)
+    {
+    int n = mat.rows();
+    if (k > n) k = n;
+    if (maxKrylov <= 0)
+        maxKrylov = min(n,max(4*k,k+40));
+    maxKrylov = min(max(maxKrylov,k),n);
+
+    //factor M - sigma I
+    Eigen::SparseMatrix<double> shifted(mat);
+    Eigen::SparseMatrix<double> identity(n,n);
+    identity.setIdentity();
+    shifted -= sigma*identity;
+    Eigen::SimplicialLDLT<Eigen::SparseMatrix<double> > factorization(shifted);
+    if (factorization.info() != Eigen::Success)
+        {
+        printf("Factorization of the shifted matrix failed; is the shift an eigenvalue?\n");
+        throw std::exception();
+        };
+
+    Eigen::MatrixXd V(n,maxKrylov);
+    vector<double> alphas,betas;
+    Eigen::VectorXd w(n);
+    mt19937 gen(1);
+    normal_distribution<double> normal(0.0,1.0);
+    for (int ii = 0; ii < n; ++ii)
+        w[ii] = normal(gen);
+    V.col(0) = w/w.norm();
+
+    Eigen::SelfAdjointEigenSolver<Eigen::MatrixXd> tridiagonalSolver;
+    vector<int> wanted;
+    int converged = 0;
+    int steps = 0;
+    for (int j = 0; j < maxKrylov; ++j)
+        {
+        w = factorization.solve(V.col(j));
+        double alpha = V.col(j).dot(w);
+        //full reorthogonalization, done twice
+        for (int pass = 0; pass < 2; ++pass)
+            w -= V.leftCols(j+1)*(V.leftCols(j+1).transpose()*w);
+        double beta = w.norm();
+        alphas.push_back(alpha);
+        betas.push_back(beta);
+        steps = j+1;
+
+        //stop at an invariant subspace, in which case fewer than k eigenpairs may be available
+        bool lastStep = (steps == maxKrylov) || (beta <= 1e-14*fabs(alpha));
+        if (lastStep)
+            k = min(k,steps);
+        if (steps >= k && (lastStep || steps % 5 == 0))
+            {
+            //Ritz values and vectors of the tridiagonal matrix
+            Eigen::VectorXd diagonal(steps), subdiagonal(max(steps-1,1));
+            for (int ii = 0; ii < steps; ++ii)
+                diagonal[ii] = alphas[ii];
+            for (int ii = 0; ii+1 < steps; ++ii)
+                subdiagonal[ii] = betas[ii];
+            tridiagonalSolver.computeFromTridiagonal(diagonal,subdiagonal.head(steps-1),Eigen::ComputeEigenvectors);
+            //the k Ritz values of largest magnitude correspond to the eigenvalues closest to sigma
+            vector< pair<double,int> > magnitudes(steps);
+            for (int ii = 0; ii < steps; ++ii)
+                magnitudes[ii] = make_pair(-fabs(tridiagonalSolver.eigenvalues()[ii]),ii);
+            sort(magnitudes.begin(),magnitudes.end());
+            wanted.resize(k);
+            converged = 0;
+            for (int ii = 0; ii < k; ++ii)
+                {
+                wanted[ii] = magnitudes[ii].second;
+                double theta = tridiagonalSolver.eigenvalues()[wanted[ii]];
+                double residual = fabs(beta*tridiagonalSolver.eigenvectors()(steps-1,wanted[ii]));
+                if (residual <= tolerance*fabs(theta))
+                    converged += 1;
+                };
+            if (converged == k || lastStep)
+                break;
+            };
+        V.col(j+1) = w/beta;
+        };
+    if (converged < k)
+        printf("shiftInvertSolve: only %i of %i eigenpairs converged after %i Lanczos steps\n",converged,k,steps);
+
+    //transform back, and order by eigenvalue
+    vector< pair<double,int> > lambdas(k);
+    for (int ii = 0; ii < k; ++ii)
+        lambdas[ii] = make_pair(sigma + 1.0/tridiagonalSolver.eigenvalues()[wanted[ii]],wanted[ii]);
+    sort(lambdas.begin(),lambdas.end());
+    eigenvalues.resize(k);
+    eigenvectors.resize(k);
+    for (int ii = 0; ii < k; ++ii)
+        {
+        eigenvalues[ii] = lambdas[ii].first;
+        Eigen::VectorXd evec = V.leftCols(steps)*tridiagonalSolver.eigenvectors().col(lambdas[ii].second);
+        evec /= evec.norm();
+        eigenvectors[ii].resize(n);
+        for (int vv = 0; vv < n; ++vv)
+            eigenvectors[ii][vv] = evec[vv];
+        };
+    return converged;
+    };
+
+void EigSparseMat::getEvec(int i, vector<Dscalar> &vec)
+    {
+    vec = eigenvectors[i];
+    };
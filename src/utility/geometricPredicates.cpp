@@ -0,0 +1,150 @@
+#include "geometricPredicates.h"
+
+/*! \file geometricPredicates.cpp */
+/*
+The exact stage of the predicates. Numbers are represented as floating-point expansions: sums of
+doubles, ordered by increasing magnitude, whose components do not overlap, so that the sign of the
+expansion is the sign of its last (largest) component. The routines below follow J.R. Shewchuk,
+"Adaptive Precision Floating-Point Arithmetic and Fast Robust Geometric Predicates" (1997), with
+products split via fma. They allocate, but are only reached for nearly degenerate inputs.
+*/
+typedef vector<double> expansion;
+
+//!x+y = a+b exactly, with x = fl(a+b)
+inline void twoSum(double a, double b, double &x, double &y)
+    {
+    x = a+b;
+    double bv = x-a;
+    double av = x-bv;
+    y = (a-av)+(b-bv);
+    };
+
+//!x+y = a+b exactly, provided |a| >= |b|
+inline void fastTwoSum(double a, double b, double &x, double &y)
+    {
+    x = a+b;
+    y = b-(x-a);
+    };
+
+//!x+y = a*b exactly, with x = fl(a*b)
+inline void twoProduct(double a, double b, double &x, double &y)
+    {
+    x = a*b;
+    y = fma(a,b,-x);
+    };
+
+//!The exact difference a-b as an expansion
+static expansion exactDifference(double a, double b)
+    {
+    double x,y;
+    twoSum(a,-b,x,y);
+    expansion e;
+    if (y != 0) e.push_back(y);
+    if (x != 0 || e.empty()) e.push_back(x);
+    return e;
+    };
+
+//!e+f, with zero components removed
+static expansion expansionSum(const expansion &e, const expansion &f)
+    {
+    expansion h(e);
+    expansion grown;
+    for (int jj = 0; jj < f.size(); ++jj)
+        {
+        grown.clear();
+        double Q = f[jj];
+        double Qnew,hh;
+        for (int ii = 0; ii < h.size(); ++ii)
+            {
+            twoSum(Q,h[ii],Qnew,hh);
+            Q = Qnew;
+            if (hh != 0) grown.push_back(hh);
+            };
+        if (Q != 0 || grown.empty()) grown.push_back(Q);
+        h.swap(grown);
+        };
+    return h;
+    };
+
+//!e*b, with zero components removed
+static expansion expansionScale(const expansion &e, double b)
+    {
+    expansion h;
+    double Q,hh,product1,product0,sumTerm;
+    twoProduct(e[0],b,Q,hh);
+    if (hh != 0) h.push_back(hh);
+    for (int ii = 1; ii < e.size(); ++ii)
+        {
+        twoProduct(e[ii],b,product1,product0);
+        twoSum(Q,product0,sumTerm,hh);
+        if (hh != 0) h.push_back(hh);
+        fastTwoSum(product1,sumTerm,Q,hh);
+        if (hh != 0) h.push_back(hh);
+        };
+    if (Q != 0 || h.empty()) h.push_back(Q);
+    return h;
+    };
+
+//!e*f
+static expansion expansionProduct(const expansion &e, const expansion &f)
+    {
+    expansion h(1,0.0);
+    for (int jj = 0; jj < f.size(); ++jj)
+        h = expansionSum(h,expansionScale(e,f[jj]));
+    return h;
+    };
+
+//!-e
+static expansion expansionNegate(const expansion &e)
+    {
+    expansion h(e);
+    for (int ii = 0; ii < h.size(); ++ii)
+        h[ii] = -h[ii];
+    return h;
+    };
+
+//!The sign of an expansion
+static int expansionSign(const expansion &e)
+    {
+    double largest = e.back();
+    if (largest > 0) return 1;
+    if (largest < 0) return -1;
+    return 0;
+    };
+
+/*!
+\param ax,ay,bx,by,cx,cy the coordinates of the three points
+\return the exact sign of (a-c) x (b-c)
+*/
+int orientationExact(double ax, double ay, double bx, double by, double cx, double cy)
+    {
+    expansion acx = exactDifference(ax,cx);
+    expansion acy = exactDifference(ay,cy);
+    expansion bcx = exactDifference(bx,cx);
+    expansion bcy = exactDifference(by,cy);
+    return expansionSign(expansionSum(expansionProduct(acx,bcy),expansionNegate(expansionProduct(acy,bcx))));
+    };
+
+/*!
+\param ax,ay,bx,by,cx,cy,dx,dy the coordinates of the four points
+\return the exact sign of the in-circle determinant, positive if d is inside the circle through the CCW triangle (a,b,c)
+*/
+int inCircleExact(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy)
+    {
+    expansion adx = exactDifference(ax,dx);
+    expansion ady = exactDifference(ay,dy);
+    expansion bdx = exactDifference(bx,dx);
+    expansion bdy = exactDifference(by,dy);
+    expansion cdx = exactDifference(cx,dx);
+    expansion cdy = exactDifference(cy,dy);
+
+    expansion alift = expansionSum(expansionProduct(adx,adx),expansionProduct(ady,ady));
+    expansion blift = expansionSum(expansionProduct(bdx,bdx),expansionProduct(bdy,bdy));
+    expansion clift = expansionSum(expansionProduct(cdx,cdx),expansionProduct(cdy,cdy));
+    expansion bc = expansionSum(expansionProduct(bdx,cdy),expansionNegate(expansionProduct(cdx,bdy)));
+    expansion ca = expansionSum(expansionProduct(cdx,ady),expansionNegate(expansionProduct(adx,cdy)));
+    expansion ab = expansionSum(expansionProduct(adx,bdy),expansionNegate(expansionProduct(bdx,ady)));
+
+    expansion det = expansionSum(expansionSum(expansionProduct(alift,bc),expansionProduct(blift,ca)),expansionProduct(clift,ab));
+    return expansionSign(det);
+    };
@@ -248,6 +248,90 @@ bool gpu_parallel_reduction(Dscalar2 *input, Dscalar2 *intermediate, Dscalar2 *o
     return cudaSuccess;
     };
 
+/*!
+add the first N block sums and put the total in output[helperIdx], accumulating as Accumulators
+*/
+template<typename Accumulator>
+__global__ void gpu_accumulated_serial_reduction_kernel(Daccum *array, Daccum *output, int helperIdx,int N)
+    {
+    Accumulator ans = 0.0;
+    for (int i = 0; i < N; ++i)
+        ans += (Accumulator)array[i];
+    output[helperIdx] = ans;
+    return;
+    };
+
+/*!
+block reduction of a Dscalar array in which the partial sums are held as Accumulators, c.f. M. Harris
+presentation
+*/
+template<typename Accumulator>
+__global__ void gpu_accumulated_block_reduction_kernel(Dscalar *input, Daccum *output,int N)
+    {
+    extern __shared__ unsigned char sharedBytes[];
+    Accumulator *sharedArray = reinterpret_cast<Accumulator *>(sharedBytes);
+
+    unsigned int tidx = threadIdx.x;
+    unsigned int i = 2*blockDim.x * blockIdx.x + threadIdx.x;
+
+    Accumulator sum;
+    //load into shared memory and synchronize
+    if(i < N)
+        sum = input[i];
+    else
+        sum = 0.0;
+    if(i + blockDim.x < N)
+        sum += (Accumulator)input[i+blockDim.x];
+
+    sharedArray[tidx] = sum;
+    __syncthreads();
+
+    //reduce
+    for (int s = blockDim.x/2; s>0; s>>=1)
+        {
+        if (tidx < s)
+            sharedArray[tidx] = sum = sum+sharedArray[tidx+s];
+        __syncthreads();
+        };
+    //write to the correct block of the output array
+    if (tidx==0)
+        output[blockIdx.x] = sum;
+    };
+
+/*!
+The two-step parallel reduction of a Dscalar array with the partial sums held in the requested
+precision; the result is always returned as a Daccum
+\param input the input array to sum
+\param intermediate an array that input is block-reduced to
+\param output the intermediate array will be sum reduced and stored in one of the components of output
+\param helperIdx the location in output to store the answer
+\param N the size of the input and  intermediate arrays
+\param precision accumulate in Dscalar (storage) or Daccum (extended)
+*/
+bool gpu_parallel_reduction(Dscalar *input, Daccum *intermediate, Daccum *output, int helperIdx, int N,
+                            accumulator_precision::Enum precision)
+    {
+    unsigned int block_size = 256;
+    unsigned int nblocks  = N/block_size + 1;
+    if (precision == accumulator_precision::storage)
+        {
+        unsigned int smem = block_size*sizeof(Dscalar);
+        gpu_accumulated_block_reduction_kernel<Dscalar><<<nblocks,block_size,smem>>>(input,intermediate, N);
+        HANDLE_ERROR(cudaGetLastError());
+        gpu_accumulated_serial_reduction_kernel<Dscalar><<<1,1>>>(intermediate,output,helperIdx,nblocks);
+        HANDLE_ERROR(cudaGetLastError());
+        }
+    else
+        {
+        unsigned int smem = block_size*sizeof(Daccum);
+        gpu_accumulated_block_reduction_kernel<Daccum><<<nblocks,block_size,smem>>>(input,intermediate, N);
+        HANDLE_ERROR(cudaGetLastError());
+        gpu_accumulated_serial_reduction_kernel<Daccum><<<1,1>>>(intermediate,output,helperIdx,nblocks);
+        HANDLE_ERROR(cudaGetLastError());
+        };
+    return cudaSuccess;
+    };
+
 /*!
 This serial reduction routine should probably never be called. It provides an interface to the
 gpu_serial_reduction_kernel above that may be useful for testing